@@ -20,8 +20,7 @@
 //
 // must align to 2-byte boundaries so it doesn't alter the memory image when 
 // bytes are read from the file system into this footprint.
-#pragma push
-#pragma pack(2)
+#pragma pack(push, 2)
 
 /// Bitmap file header
 typedef struct                    /**** BMP file header structure ****/
@@ -48,7 +47,7 @@ typedef struct                    /**** BMP file info structure ****/
     uint32_t    biClrUsed;        ///< Number of colors used 
     uint32_t    biClrImportant;   ///< Number of important colors 
     } BITMAPINFOHEADER;           // Size: 40B
-#pragma pop
+#pragma pack(pop)
 
 #define BF_TYPE 0x4D42            /* "MB" */
 
@@ -77,8 +76,7 @@ typedef struct                       /**** Colormap entry structure ****/
 //    } BITMAPINFO;
 
 
-#pragma push
-#pragma pack(2)
+#pragma pack(push, 2)
 
 /// Icon file type file header.
 typedef struct                  /**** ICO file header structure ****/
@@ -100,7 +98,7 @@ typedef struct                  /**** ICO file Directory Entry structure (1 or m
     uint32_t    biSizeImage;    ///< Size of image data 
     uint32_t    bfOffBits;      ///< Offset into file for the bitmap data 
     } ICODIRENTRY;
-#pragma pop
+#pragma pack(pop)
 
 #define IC_TYPE 0x0001            /* 1 = ICO (icon), 2 = CUR (cursor) */
 
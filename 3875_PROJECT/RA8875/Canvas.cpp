@@ -0,0 +1,559 @@
+// Off-screen Canvas.
+//
+// See the Canvas.h file for full details.
+//
+#include "Canvas.h"
+
+//#include "Utility.h"            // private memory manager
+#ifndef UTILITY_H
+#define swMalloc malloc         // use the standard
+#define swFree free
+#endif
+
+//#define DEBUG "CNVS"
+// ...
+// INFO("Stuff to show %d", var); // new-line is automatically appended
+//
+#if (defined(DEBUG) && !defined(TARGET_LPC11U24))
+#define INFO(x, ...) std::printf("[INF %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define WARN(x, ...) std::printf("[WRN %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define ERR(x, ...)  std::printf("[ERR %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#else
+#define INFO(x, ...)
+#define WARN(x, ...)
+#define ERR(x, ...)
+#endif
+
+
+Canvas::Canvas(GraphicsDisplay & _target, dim_t w, dim_t h, loc_t x, loc_t y, const char * name)
+    : GraphicsDisplay(name), target(_target)
+{
+    pixels = (color_t *)swMalloc((uint32_t)w * h * sizeof(color_t));
+    if (pixels) {
+        memset(pixels, 0, (uint32_t)w * h * sizeof(color_t));
+        canvasWidth = w;
+        canvasHeight = h;
+    } else {
+        ERR("Canvas(%d x %d) not enough ram", w, h);
+        canvasWidth = 0;        // so that the area is empty, and all is clipped
+        canvasHeight = 0;
+    }
+    SetOrigin(x, y);
+    windowrect = area;
+    _x = x;
+    _y = y;
+    streamStart.x = x;
+    streamStart.y = y;
+    streamCount = 0;
+    cursor_x = x;
+    cursor_y = y;
+    extFontWidth = 0;
+    extFontHeight = 0;
+    fontScaleX = fontScaleY = 1;
+    _foreground = 0xFFFF;       // White
+    _background = 0x0000;       // Black
+}
+
+
+Canvas::~Canvas()
+{
+    if (pixels)
+        swFree(pixels);
+}
+
+
+RetCode_t Canvas::SetOrigin(loc_t x, loc_t y)
+{
+    area.p1.x = x;
+    area.p1.y = y;
+    area.p2.x = x + canvasWidth - 1;
+    area.p2.y = y + canvasHeight - 1;
+    dirty.Clear();
+    return noerror;
+}
+
+
+RetCode_t Canvas::Invalidate(rect_t r)
+{
+    if (r.p1.x > r.p2.x) {
+        loc_t t = r.p1.x; r.p1.x = r.p2.x; r.p2.x = t;
+    }
+    if (r.p1.y > r.p2.y) {
+        loc_t t = r.p1.y; r.p1.y = r.p2.y; r.p2.y = t;
+    }
+    _markDirty(r);
+    return noerror;
+}
+
+
+RetCode_t Canvas::Send(bool inPlace)
+{
+    RetCode_t ret = noerror;
+    rect_t r[DIRTY_REGION_RECTS];
+    int n;
+    int i;
+
+    if (pixels == NULL)
+        return not_enough_ram;
+    n = dirty.Take(r, DIRTY_REGION_RECTS);
+    INFO("Send %d rects", n);
+    for (i=0; i<n && ret == noerror; i++)
+        ret = _send(r[i], inPlace);
+    if (ret != noerror) {
+        for (i--; i<n; i++)     // they are sent again on the next flush
+            dirty.Invalidate(r[i]);
+    }
+    return ret;
+}
+
+
+RetCode_t Canvas::flush(void)
+{
+    RetCode_t ret = Send();
+    RetCode_t done;
+
+    target.WindowMax();
+    done = target.flush();
+    return (ret == noerror) ? done : ret;
+}
+
+
+RetCode_t Canvas::_send(rect_t r, bool inPlace)
+{
+    dim_t w = r.p2.x - r.p1.x + 1;
+    uint32_t count = DirtyRegion::Area(r);
+    color_t stage[CANVAS_STAGE_PIXELS];
+    RetCode_t ret;
+
+    ret = target.window(r);
+    if (ret != noerror)
+        return ret;
+    if (w == canvasWidth) {
+        // the rows are contiguous in the buffer
+        if (inPlace)
+            return target.pixelStreamInPlace(_at(r.p1.x, r.p1.y), count, r.p1.x, r.p1.y);
+        return target.pixelStreamAsync(_at(r.p1.x, r.p1.y), count, r.p1.x, r.p1.y);
+    }
+    // Gather the rows, so a narrow rectangle still goes in long streams,
+    // which wrap within the window on the target.
+    for (uint32_t i=0; i<count && ret == noerror; ) {
+        loc_t x = r.p1.x + i % w;
+        loc_t y = r.p1.y + i / w;
+        uint32_t n = 0;
+
+        while (n < CANVAS_STAGE_PIXELS && i < count) {
+            uint32_t col = i % w;
+            uint32_t run = w - col;
+
+            if (run > CANVAS_STAGE_PIXELS - n)
+                run = CANVAS_STAGE_PIXELS - n;
+            memcpy(stage + n, _at(r.p1.x + col, r.p1.y + i / w), run * sizeof(color_t));
+            n += run;
+            i += run;
+        }
+        ret = target.pixelStreamAsync(stage, n, x, y);
+    }
+    return ret;
+}
+
+
+void Canvas::_markDirty(rect_t r)
+{
+    if (r.p1.x < area.p1.x)
+        r.p1.x = area.p1.x;
+    if (r.p1.y < area.p1.y)
+        r.p1.y = area.p1.y;
+    if (r.p2.x > area.p2.x)
+        r.p2.x = area.p2.x;
+    if (r.p2.y > area.p2.y)
+        r.p2.y = area.p2.y;
+    if (r.p2.x >= width())          // a strip may hang off the screen
+        r.p2.x = width() - 1;
+    if (r.p2.y >= height())
+        r.p2.y = height() - 1;
+    if (r.p1.x > r.p2.x || r.p1.y > r.p2.y)
+        return;
+    dirty.Invalidate(r);
+}
+
+
+// Mark what a stream of count pixels from (x,y) wrote, as it wraps within
+// the window.
+void Canvas::_markStream(loc_t x, loc_t y, uint32_t count)
+{
+    rect_t r = windowrect;
+    uint32_t ww = windowrect.p2.x - windowrect.p1.x + 1;
+
+    if (count == 0)
+        return;
+    if (x < windowrect.p1.x || x > windowrect.p2.x || y < windowrect.p1.y || y > windowrect.p2.y) {
+        // begun outside the window, it is captured at the right edge
+        rect_t first = { { x, y }, { (x > windowrect.p2.x) ? x : windowrect.p2.x, y } };
+
+        _markDirty(first);
+    } else {
+        uint32_t rows = (x - windowrect.p1.x + count - 1) / ww;
+
+        if (rows == 0) {
+            r.p1.x = x;
+            r.p2.x = x + count - 1;
+            r.p1.y = r.p2.y = y;
+        } else if (rows <= (uint32_t)(windowrect.p2.y - y)) {
+            r.p1.y = y;
+            r.p2.y = y + rows;
+        }
+        // else it wrapped from the bottom to the top; all the window
+    }
+    _markDirty(r);
+}
+
+
+void Canvas::_fill(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color)
+{
+    rect_t r;
+
+    if (x1 < area.p1.x)
+        x1 = area.p1.x;
+    if (y1 < area.p1.y)
+        y1 = area.p1.y;
+    if (x2 > area.p2.x)
+        x2 = area.p2.x;
+    if (y2 > area.p2.y)
+        y2 = area.p2.y;
+    if (x1 > x2 || y1 > y2)
+        return;
+    for (loc_t y=y1; y<=y2; y++) {
+        color_t * p = _at(x1, y);
+
+        for (loc_t x=x1; x<=x2; x++)
+            *p++ = color;
+    }
+    r.p1.x = x1;
+    r.p1.y = y1;
+    r.p2.x = x2;
+    r.p2.y = y2;
+    _markDirty(r);
+}
+
+
+RetCode_t Canvas::SetTextCursor(loc_t x, loc_t y)
+{
+    cursor_x = x;
+    cursor_y = y;
+    return noerror;
+}
+
+
+void Canvas::puts(const char * string)
+{
+    while (*string)
+        _putc(*string++);
+}
+
+
+void Canvas::puts(loc_t x, loc_t y, const char * string)
+{
+    SetTextCursor(x, y);
+    puts(string);
+}
+
+
+RetCode_t Canvas::SelectUserFont(const uint8_t * _font)
+{
+    if (_font) {
+        uint32_t totalWidth = 0;
+        uint16_t firstChar = _font[3] * 256 + _font[2];
+        uint16_t lastChar  = _font[5] * 256 + _font[4];
+
+        extFontHeight = _font[6];
+        for (uint16_t i=firstChar; i<=lastChar; i++) {
+            // 8 bytes of preamble to the first level lookup table
+            uint16_t offsetToCharLookup = 8 + 4 * (i - firstChar);    // 4-bytes: width(pixels), 16-bit offset from table start, 0
+            totalWidth += _font[offsetToCharLookup];
+        }
+        extFontWidth = totalWidth / (lastChar - firstChar);
+    }
+    return GraphicsDisplay::SelectUserFont(_font);
+}
+
+
+RetCode_t Canvas::locate(textloc_t column, textloc_t row)
+{
+    return SetTextCursor(column * extFontWidth, row * extFontHeight);
+}
+
+
+RetCode_t Canvas::cls(uint16_t layers)
+{
+    (void)layers;
+    _fill(area.p1.x, area.p1.y, area.p2.x, area.p2.y, _background);
+    return noerror;
+}
+
+
+RetCode_t Canvas::pixel(loc_t x, loc_t y, color_t color)
+{
+    if (_inside(x, y)) {
+        rect_t r = { { x, y }, { x, y } };
+
+        *_at(x, y) = color;
+        _markDirty(r);
+    }
+    return noerror;
+}
+
+
+RetCode_t Canvas::pixelStream(color_t * p, uint32_t count, loc_t x, loc_t y)
+{
+    SetGraphicsCursor(x, y);
+    _StartGraphicsStream();
+    while (count--) {
+        _putp(*p++);
+    }
+    _EndGraphicsStream();
+    return noerror;
+}
+
+
+color_t Canvas::getPixel(loc_t x, loc_t y)
+{
+    if (_inside(x, y))
+        return *_at(x, y);
+    return 0x0000;              // Black
+}
+
+
+RetCode_t Canvas::getPixelStream(color_t * p, uint32_t count, loc_t x, loc_t y)
+{
+    while (count--) {
+        *p++ = getPixel(x, y);
+        x++;
+        if (x > windowrect.p2.x) {
+            x = windowrect.p1.x;
+            y++;
+            if (y > windowrect.p2.y) {
+                y = windowrect.p1.y;
+            }
+        }
+    }
+    return noerror;
+}
+
+
+RetCode_t Canvas::SetGraphicsCursor(loc_t x, loc_t y)
+{
+    _x = x;
+    _y = y;
+    return noerror;
+}
+
+
+point_t Canvas::GetGraphicsCursor(void)
+{
+    point_t p;
+
+    p.x = _x;
+    p.y = _y;
+    return p;
+}
+
+
+RetCode_t Canvas::SetGraphicsCursorRead(loc_t x, loc_t y)
+{
+    (void)x;
+    (void)y;
+    return noerror;
+}
+
+
+RetCode_t Canvas::fillrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
+                           color_t color, fill_t fillit)
+{
+    foreground(color);
+    if (x1 > x2) {
+        loc_t t = x1; x1 = x2; x2 = t;
+    }
+    if (y1 > y2) {
+        loc_t t = y1; y1 = y2; y2 = t;
+    }
+    if (fillit == FILL) {
+        _fill(x1, y1, x2, y2, color);
+    } else {
+        _fill(x1, y1, x2, y1, color);
+        _fill(x1, y2, x2, y2, color);
+        _fill(x1, y1, x1, y2, color);
+        _fill(x2, y1, x2, y2, color);
+    }
+    return noerror;
+}
+
+
+RetCode_t Canvas::blendrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color, uint8_t alpha)
+{
+    uint16_t a = alpha;
+    uint16_t r = (color >> 11) * a;     // the share of each channel from color
+    uint16_t g = ((color >> 5) & 0x3F) * a;
+    uint16_t b = (color & 0x1F) * a;
+    rect_t dr;
+
+    if (x1 > x2) {
+        loc_t t = x1; x1 = x2; x2 = t;
+    }
+    if (y1 > y2) {
+        loc_t t = y1; y1 = y2; y2 = t;
+    }
+    if (x1 < area.p1.x)
+        x1 = area.p1.x;
+    if (y1 < area.p1.y)
+        y1 = area.p1.y;
+    if (x2 > area.p2.x)
+        x2 = area.p2.x;
+    if (y2 > area.p2.y)
+        y2 = area.p2.y;
+    if (x1 > x2 || y1 > y2)
+        return noerror;
+    a = 255 - a;
+    for (loc_t y=y1; y<=y2; y++) {
+        color_t * p = _at(x1, y);
+
+        for (loc_t x=x1; x<=x2; x++, p++) {
+            color_t d = *p;
+
+            *p = (((r + (d >> 11) * a) / 255) << 11)
+               | (((g + ((d >> 5) & 0x3F) * a) / 255) << 5)
+               | ((b + (d & 0x1F) * a) / 255);
+        }
+    }
+    dr.p1.x = x1;
+    dr.p1.y = y1;
+    dr.p2.x = x2;
+    dr.p2.y = y2;
+    _markDirty(dr);
+    return noerror;
+}
+
+
+RetCode_t Canvas::SelectDrawingLayer(uint16_t layer, uint16_t * prevLayer)
+{
+    if (prevLayer)
+        *prevLayer = 0;
+    return (layer == 0) ? noerror : bad_parameter;
+}
+
+
+RetCode_t Canvas::WriteCommand(unsigned char command, unsigned int data)
+{
+    (void)command;
+    (void)data;
+    return not_supported_format;
+}
+
+
+RetCode_t Canvas::WriteData(unsigned char data)
+{
+    (void)data;
+    return not_supported_format;
+}
+
+
+RetCode_t Canvas::_putp(color_t color)
+{
+    if (_inside(_x, _y))
+        *_at(_x, _y) = color;
+    streamCount++;
+    // update pixel location based on window settings
+    _x++;
+    if (_x > windowrect.p2.x) {
+        _x = windowrect.p1.x;
+        _y++;
+        if (_y > windowrect.p2.y) {
+            _y = windowrect.p1.y;
+        }
+    }
+    return noerror;
+}
+
+
+RetCode_t Canvas::_StartGraphicsStream(void)
+{
+    streamStart.x = _x;
+    streamStart.y = _y;
+    streamCount = 0;
+    return noerror;
+}
+
+
+RetCode_t Canvas::_EndGraphicsStream(void)
+{
+    _markStream(streamStart.x, streamStart.y, streamCount);
+    streamCount = 0;
+    return noerror;
+}
+
+
+// As for the RA8875, with a font scale X = 2, a pixel stream is
+// "aabbccdd...", and with a font scale Y = 2, each row is sent twice.
+//
+RetCode_t Canvas::booleanStream(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_t * boolStream)
+{
+    const uint8_t * rowStream;
+    rect_t restore = windowrect;
+
+    window(x, y, w * fontScaleX, h * fontScaleY);       // Scale from font scale factors
+    SetGraphicsCursor(x, y);
+    _StartGraphicsStream();
+    while (h--) {
+        for (int dy=0; dy<fontScaleY; dy++) {           // Vertical Font Scale Factor
+            uint8_t bits = w;
+            uint8_t bitmask = 0x01;
+            rowStream = boolStream;
+            while (bits) {
+                uint8_t byte = *rowStream;
+                color_t c = (byte & bitmask) ? _foreground : _background;
+
+                for (int dx=0; dx<fontScaleX; dx++) {   // Horizontal Font Scale Factor
+                    _putp(c);
+                }
+                bitmask <<= 1;
+                if (bits > 1 && bitmask == 0) {
+                    bitmask = 0x01;
+                    rowStream++;
+                }
+                bits--;
+            }
+        }
+        boolStream += (rowStream - boolStream + 1);
+    }
+    _EndGraphicsStream();
+    window(restore);
+    return noerror;
+}
+
+
+int Canvas::_putc(int c)
+{
+    if (c && font) {
+        if (c == '\r') {
+            cursor_x = windowrect.p1.x;
+        } else if (c == '\n') {
+            cursor_y += extFontHeight;
+        } else {
+            dim_t charWidth, charHeight;
+            const uint8_t * charRecord;
+
+            charRecord = getCharMetrics(c, &charWidth, &charHeight);
+            if (charRecord) {
+                if (cursor_x + charWidth >= windowrect.p2.x) {
+                    cursor_x = windowrect.p1.x;
+                    cursor_y += charHeight;
+                }
+                if (cursor_y + charHeight >= windowrect.p2.y) {
+                    cursor_y = windowrect.p1.y;
+                }
+                (void)character(cursor_x, cursor_y, c);
+                cursor_x += charWidth * fontScaleX;
+            }
+        }
+    }
+    return c;
+}
@@ -0,0 +1,409 @@
+/// @page Canvas_Page Off-screen Canvas
+///
+/// A Canvas is a GraphicsDisplay whose pixels are held in RAM, as RGB565,
+/// rather than in a display controller. Text, widgets and images may be
+/// composed on it at the speed of the CPU, and then sent to a real display
+/// with @ref Canvas::flush, in a few large windowed pixel streams.
+///
+/// The canvas covers a rectangle of the screen of its target display, which
+/// may be the whole screen, or a strip of it when there is not the RAM for
+/// the whole. It is drawn on in screen coordinates, and what falls outside
+/// the rectangle is clipped.
+///
+/// Each change marks a dirty rectangle, in a @ref DirtyRegion, which merges
+/// overlapping and nearby rectangles as they are marked. Only the dirty
+/// rectangles, within the screen of the target, are sent on flush.
+///
+/// @code
+///     RA8875 lcd(p5, p6, p7, p12, NC, "tft");
+///     Canvas panel(lcd, 200, 100, 20, 20);    // 200 x 100, at (20,20)
+///
+///     lcd.init(480, 272, 16);
+///     panel.SelectUserFont(BPG_Arial08x08);
+///     panel.background(Blue);
+///     panel.cls();
+///     panel.fillrect(30,30, 120,50, Yellow);
+///     panel.SetTextCursor(30, 60);
+///     panel.printf("Speed %d", speed);
+///     panel.flush();                          // sends only what changed
+/// @endcode
+///
+/// The canvas has a single layer, and no internal font; text is drawn with
+/// the font set by @ref SelectUserFont, and none is drawn without one.
+///
+#ifndef CANVAS_H
+#define CANVAS_H
+#include <mbed.h>
+#include "GraphicsDisplay.h"
+#include "DirtyRegion.h"
+
+#ifndef CANVAS_STAGE_PIXELS
+#define CANVAS_STAGE_PIXELS 128     ///< pixels gathered for each stream of a narrow rectangle
+#endif
+
+/// A GraphicsDisplay held in RAM, which is sent to a display on flush.
+///
+class Canvas : public GraphicsDisplay
+{
+public:
+    /// Constructor, which allocates the pixel buffer.
+    ///
+    /// The buffer is cleared to Black, and nothing is marked dirty.
+    ///
+    /// @param[in] target is the display the canvas is sent to.
+    /// @param[in] w is the width of the canvas in pixels.
+    /// @param[in] h is the height of the canvas in pixels.
+    /// @param[in] x is the left edge of the canvas on the target.
+    /// @param[in] y is the top edge of the canvas on the target.
+    /// @param[in] name is the optional name for the stdio stream.
+    ///
+    Canvas(GraphicsDisplay & target, dim_t w, dim_t h, loc_t x = 0, loc_t y = 0, const char * name = NULL);
+
+    /// Destructor, which frees the pixel buffer.
+    ///
+    ~Canvas();
+
+    /// Move the canvas on the target, as to draw the next strip of the screen.
+    ///
+    /// The content is kept, and the list of dirty rectangles is cleared, so
+    /// flush before moving it.
+    ///
+    /// @param[in] x is the left edge of the canvas on the target.
+    /// @param[in] y is the top edge of the canvas on the target.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t SetOrigin(loc_t x, loc_t y);
+
+    /// Get the rectangle of the target that the canvas covers.
+    ///
+    /// @returns the rectangle, in screen coordinates.
+    ///
+    rect_t GetArea(void) { return area; }
+
+    /// Mark a rectangle as changed, so it is sent on the next flush.
+    ///
+    /// Drawing through the APIs marks what it changes. This is for when
+    /// the target was changed by other means, and must be restored.
+    ///
+    /// @param[in] r is the rectangle, in screen coordinates.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Invalidate(rect_t r);
+
+    /// Mark the whole canvas as changed.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Invalidate(void) { return Invalidate(area); }
+
+    /// Mark the whole canvas as unchanged, so nothing is sent until more
+    /// is drawn or invalidated.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Validate(void) { dirty.Clear(); return noerror; }
+
+    /// Get the number of dirty rectangles waiting for the next flush.
+    ///
+    /// @returns the count.
+    ///
+    int DirtyCount(void) { return dirty.Count(); }
+
+    /// Get the dirty region, as for its statistics.
+    ///
+    /// @returns a reference to the dirty region.
+    ///
+    DirtyRegion & GetDirtyRegion(void) { return dirty; }
+
+    /// Start sending the dirty rectangles to the target, without waiting
+    /// for the transfer to complete.
+    ///
+    /// Each rectangle is set as the window of the target, and sent with
+    /// pixelStreamAsync; as one stream when it is the full width of the
+    /// canvas, or else in streams of CANVAS_STAGE_PIXELS. The window of the
+    /// target is left at the last rectangle. Drawing may go on at once, as
+    /// what is still in flight has been copied out of the canvas.
+    ///
+    /// In place, a rectangle of the full width is sent with
+    /// pixelStreamInPlace, straight from the canvas, and then the canvas
+    /// must not be drawn on until the target is flushed, or used otherwise;
+    /// so another canvas is drawn meanwhile, as by the @ref StripRenderer.
+    ///
+    /// @param[in] inPlace is true to send from the canvas, rather than to
+    ///     copy out of it. default is false.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Send(bool inPlace = false);
+
+    /// Send the dirty rectangles to the target, and wait for them to go.
+    ///
+    /// This is @ref Send, and then the window of the target is set to the
+    /// full screen, and the target is flushed.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t flush(void);
+
+    /// Set the text cursor, for text in the font set by @ref SelectUserFont.
+    ///
+    /// @param[in] x is the horizontal position in pixels.
+    /// @param[in] y is the vertical position in pixels.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t SetTextCursor(loc_t x, loc_t y);
+
+    /// Write a string of text at the text cursor.
+    ///
+    /// @param[in] string is the null terminated string.
+    ///
+    void puts(const char * string);
+
+    /// Write a string of text at the specified location.
+    ///
+    /// @param[in] x is the horizontal position in pixels.
+    /// @param[in] y is the vertical position in pixels.
+    /// @param[in] string is the null terminated string.
+    ///
+    void puts(loc_t x, loc_t y, const char * string);
+
+    /// Select a User Font for all subsequent text.
+    ///
+    /// @param[in] font is a pointer to a specially formed font resource.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t SelectUserFont(const uint8_t * font = NULL);
+
+    /// Locate the text cursor at a character position, of the average
+    /// width of the font.
+    ///
+    /// @param[in] column is the horizontal offset from the left side.
+    /// @param[in] row is the vertical offset from the top.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t locate(textloc_t column, textloc_t row);
+
+    /// Set the foreground color.
+    ///
+    /// @param[in] color is color to use for foreground drawing.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t foreground(color_t color) { return TextDisplay::foreground(color); }
+
+    /// Set the background color.
+    ///
+    /// @param[in] color is color to use for background drawing.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t background(color_t color) { return TextDisplay::background(color); }
+
+    /// Clear the canvas to the background color.
+    ///
+    /// @param[in] layers is ignored, as the canvas has one layer.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t cls(uint16_t layers = 0);
+
+    /// Draw a pixel in the specified color.
+    ///
+    /// @param[in] x is the horizontal offset to this pixel.
+    /// @param[in] y is the vertical offset to this pixel.
+    /// @param[in] color defines the color for the pixel.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t pixel(loc_t x, loc_t y, color_t color);
+
+    /// Write a stream of pixels, which wraps within the window, as on the
+    /// controller.
+    ///
+    /// @param[in] p is a pointer to a color_t array to write.
+    /// @param[in] count is the number of pixels to write.
+    /// @param[in] x is the horizontal position.
+    /// @param[in] y is the vertical position.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t pixelStream(color_t * p, uint32_t count, loc_t x, loc_t y);
+
+    /// Get a pixel. Pixels outside the canvas read as Black.
+    ///
+    /// @param[in] x is the horizontal offset to this pixel.
+    /// @param[in] y is the vertical offset to this pixel.
+    /// @returns the pixel.
+    ///
+    virtual color_t getPixel(loc_t x, loc_t y);
+
+    /// Get a stream of pixels, which wraps within the window.
+    ///
+    /// @param[out] p is a pointer to a color_t array to accept the stream.
+    /// @param[in] count is the number of pixels to read.
+    /// @param[in] x is the horizontal position.
+    /// @param[in] y is the vertical position.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t getPixelStream(color_t * p, uint32_t count, loc_t x, loc_t y);
+
+    /// Get the width of the target, which is the range of x.
+    ///
+    /// @returns the width in pixels.
+    ///
+    virtual uint16_t width() { return target.width(); }
+
+    /// Get the height of the target, which is the range of y.
+    ///
+    /// @returns the height in pixels.
+    ///
+    virtual uint16_t height() { return target.height(); }
+
+    /// Set the graphics cursor, for the next stream of pixels.
+    ///
+    /// @param[in] x is the horizontal position in pixels.
+    /// @param[in] y is the vertical position in pixels.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t SetGraphicsCursor(loc_t x, loc_t y);
+
+    /// Set the graphics cursor, for the next stream of pixels.
+    ///
+    /// @param[in] p is the point representing the cursor position to set.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t SetGraphicsCursor(point_t p) { return SetGraphicsCursor(p.x, p.y); }
+
+    /// Get the graphics cursor.
+    ///
+    /// @returns the graphics cursor as a point.
+    ///
+    virtual point_t GetGraphicsCursor(void);
+
+    /// Set the graphics read cursor. As @ref getPixelStream is given its
+    /// position, this has no other effect.
+    ///
+    /// @param[in] x is the horizontal position in pixels.
+    /// @param[in] y is the vertical position in pixels.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t SetGraphicsCursorRead(loc_t x, loc_t y);
+
+    /// Draw a rectangle in the specified color.
+    ///
+    /// @note As a side effect, this changes the current foreground color.
+    ///
+    /// @param[in] x1 is the horizontal start of the rectangle.
+    /// @param[in] y1 is the vertical start of the rectangle.
+    /// @param[in] x2 is the horizontal end of the rectangle.
+    /// @param[in] y2 is the vertical end of the rectangle.
+    /// @param[in] color defines the foreground color.
+    /// @param[in] fillit is optional to NOFILL the rectangle. default is FILL.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t fillrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
+        color_t color, fill_t fillit = FILL);
+
+    /// Blend a color over a filled rectangle, for translucent panels and
+    /// the edges of anti-aliased shapes.
+    ///
+    /// Each pixel becomes (color * alpha + pixel * (255 - alpha)) / 255, by
+    /// channel. This reads only the canvas, never the display.
+    ///
+    /// @param[in] x1 is the horizontal start of the rectangle.
+    /// @param[in] y1 is the vertical start of the rectangle.
+    /// @param[in] x2 is the horizontal end of the rectangle.
+    /// @param[in] y2 is the vertical end of the rectangle.
+    /// @param[in] color is the color to blend.
+    /// @param[in] alpha is its opacity, from 0 (none) to 255 (opaque).
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t blendrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color, uint8_t alpha);
+
+    /// Select the drawing layer. The canvas has only layer 0.
+    ///
+    /// @param[in] layer is 0.
+    /// @param[out] prevLayer is an optional pointer to where 0 is written.
+    /// @returns @ref RetCode_t value; bad_parameter for any other layer.
+    ///
+    virtual RetCode_t SelectDrawingLayer(uint16_t layer, uint16_t * prevLayer = NULL);
+
+    /// Get the drawing layer.
+    ///
+    /// @returns 0.
+    ///
+    virtual uint16_t GetDrawingLayer(void) { return 0; }
+
+    /// The canvas has no controller, so commands are not supported.
+    ///
+    /// @param command is ignored.
+    /// @param data is ignored.
+    /// @returns not_supported_format.
+    ///
+    virtual RetCode_t WriteCommand(unsigned char command, unsigned int data = 0xFFFF);
+
+    /// The canvas has no controller, so data writes are not supported.
+    ///
+    /// @param data is ignored.
+    /// @returns not_supported_format.
+    ///
+    virtual RetCode_t WriteData(unsigned char data);
+
+    /// Put a pixel at the graphics cursor, and advance it within the window.
+    ///
+    /// @param[in] pixel is the color.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t _putp(color_t pixel);
+
+protected:
+    /// Begin a stream of pixels at the graphics cursor.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t _StartGraphicsStream(void);
+
+    /// End a stream of pixels, marking what it wrote as dirty.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t _EndGraphicsStream(void);
+
+    /// Write a boolean stream, in the foreground and background colors,
+    /// scaled by the font scale.
+    ///
+    /// @param[in] x is the horizontal position.
+    /// @param[in] y is the vertical position.
+    /// @param[in] w is the width of the region.
+    /// @param[in] h is the height of the region.
+    /// @param[in] boolStream is the bit image.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t booleanStream(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_t * boolStream);
+
+    /// Put a character at the text cursor, in the font set by @ref SelectUserFont.
+    ///
+    /// @param[in] c is the character.
+    /// @returns the character.
+    ///
+    virtual int _putc(int c);
+
+private:
+    bool _inside(loc_t x, loc_t y) {
+        return x >= area.p1.x && x <= area.p2.x && y >= area.p1.y && y <= area.p2.y;
+    }
+    color_t * _at(loc_t x, loc_t y) { return &pixels[(y - area.p1.y) * canvasWidth + (x - area.p1.x)]; }
+    void _fill(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color);
+    void _markStream(loc_t x, loc_t y, uint32_t count);
+    void _markDirty(rect_t r);
+    RetCode_t _send(rect_t r, bool inPlace);
+
+    GraphicsDisplay & target;       ///< the display the canvas is sent to
+    color_t * pixels;               ///< the pixel buffer, canvasWidth x canvasHeight
+    dim_t canvasWidth;              ///< width of the canvas
+    dim_t canvasHeight;             ///< height of the canvas
+    rect_t area;                    ///< rectangle of the target that the canvas covers
+    DirtyRegion dirty;              ///< the dirty rectangles, in screen coordinates
+    point_t streamStart;            ///< graphics cursor when the present stream began
+    uint32_t streamCount;           ///< pixels put in the present stream
+    loc_t cursor_x;                 ///< text cursor
+    loc_t cursor_y;                 ///< text cursor
+    dim_t extFontWidth;             ///< average width of the user font
+    dim_t extFontHeight;            ///< height of the user font
+};
+
+#endif // CANVAS_H
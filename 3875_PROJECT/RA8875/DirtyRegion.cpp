@@ -0,0 +1,168 @@
+// Dirty Region Manager.
+//
+// See the DirtyRegion.h file for full details.
+//
+#include "DirtyRegion.h"
+
+
+uint32_t DirtyRegion::Area(rect_t r)
+{
+    return (uint32_t)(r.p2.x - r.p1.x + 1) * (r.p2.y - r.p1.y + 1);
+}
+
+
+rect_t DirtyRegion::Union(rect_t a, rect_t b)
+{
+    rect_t u;
+
+    u.p1.x = (a.p1.x < b.p1.x) ? a.p1.x : b.p1.x;
+    u.p1.y = (a.p1.y < b.p1.y) ? a.p1.y : b.p1.y;
+    u.p2.x = (a.p2.x > b.p2.x) ? a.p2.x : b.p2.x;
+    u.p2.y = (a.p2.y > b.p2.y) ? a.p2.y : b.p2.y;
+    return u;
+}
+
+
+uint32_t DirtyRegion::Overlap(rect_t a, rect_t b)
+{
+    rect_t i;
+
+    i.p1.x = (a.p1.x > b.p1.x) ? a.p1.x : b.p1.x;
+    i.p1.y = (a.p1.y > b.p1.y) ? a.p1.y : b.p1.y;
+    i.p2.x = (a.p2.x < b.p2.x) ? a.p2.x : b.p2.x;
+    i.p2.y = (a.p2.y < b.p2.y) ? a.p2.y : b.p2.y;
+    if (i.p1.x > i.p2.x || i.p1.y > i.p2.y)
+        return 0;
+    return Area(i);
+}
+
+
+DirtyRegion::DirtyRegion(uint32_t _setupCost)
+{
+    count = 0;
+    setupCost = _setupCost;
+    clipping = false;
+    ClearStats();
+}
+
+
+void DirtyRegion::SetClip(rect_t _clip)
+{
+    clip = _clip;
+    clipping = true;
+}
+
+
+RetCode_t DirtyRegion::Invalidate(loc_t x1, loc_t y1, loc_t x2, loc_t y2)
+{
+    rect_t r = { { x1, y1 }, { x2, y2 } };
+
+    return Invalidate(r);
+}
+
+
+RetCode_t DirtyRegion::Invalidate(rect_t r)
+{
+    if (r.p1.x > r.p2.x) {
+        loc_t t = r.p1.x; r.p1.x = r.p2.x; r.p2.x = t;
+    }
+    if (r.p1.y > r.p2.y) {
+        loc_t t = r.p1.y; r.p1.y = r.p2.y; r.p2.y = t;
+    }
+    if (clipping) {
+        if (r.p1.x < clip.p1.x)
+            r.p1.x = clip.p1.x;
+        if (r.p1.y < clip.p1.y)
+            r.p1.y = clip.p1.y;
+        if (r.p2.x > clip.p2.x)
+            r.p2.x = clip.p2.x;
+        if (r.p2.y > clip.p2.y)
+            r.p2.y = clip.p2.y;
+        if (r.p1.x > r.p2.x || r.p1.y > r.p2.y)
+            return noerror;
+    }
+    stats.invalidated++;
+    stats.invalidPixels += Area(r);
+    // Merge with any rectangle it overlaps, or joins for less than a setup,
+    // and look again, as the union may now reach others.
+    for (int i=0; i<count; ) {
+        rect_t u = Union(r, rects[i]);
+
+        if (Overlap(r, rects[i]) || Area(u) <= Area(r) + Area(rects[i]) + setupCost) {
+            _account(r, rects[i], u);
+            r = u;
+            rects[i] = rects[--count];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    if (count < DIRTY_REGION_RECTS) {
+        rects[count++] = r;
+    } else {
+        int best = 0;
+        uint32_t bestGrowth = 0xFFFFFFFF;
+
+        for (int i=0; i<count; i++) {
+            uint32_t growth = Area(Union(r, rects[i])) - Area(rects[i]);
+
+            if (growth < bestGrowth) {
+                bestGrowth = growth;
+                best = i;
+            }
+        }
+        rect_t u = Union(r, rects[best]);
+        _account(r, rects[best], u);
+        rects[best] = u;
+    }
+    return noerror;
+}
+
+
+// Count a merge of a and b into u.
+void DirtyRegion::_account(rect_t a, rect_t b, rect_t u)
+{
+    uint32_t overlap = Overlap(a, b);
+
+    stats.merges++;
+    stats.savedPixels += overlap;
+    stats.overdrawPixels += Area(u) - (Area(a) + Area(b) - overlap);
+}
+
+
+int DirtyRegion::Take(rect_t * out, int max)
+{
+    int n = (count < max) ? count : max;
+
+    for (int i=0; i<n; i++) {
+        out[i] = rects[i];
+        stats.repaintPixels += Area(rects[i]);
+    }
+    for (int i=n; i<count; i++)
+        rects[i - n] = rects[i];
+    count -= n;
+    if (n) {
+        stats.takes++;
+        stats.repaints += n;
+    }
+    return n;
+}
+
+
+void DirtyRegion::ClearStats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+void DirtyRegion::ReportStats(Serial & pc)
+{
+    uint32_t invalid = stats.invalidPixels ? stats.invalidPixels : 1;
+
+    pc.printf("DirtyRegion: %u invalidated, %u merged, %u repainted in %u takes\r\n",
+        stats.invalidated, stats.merges, stats.repaints, stats.takes);
+    pc.printf("  pixels invalidated %u, repainted %u, overdraw %u (%u%%), saved %u (%u%%)\r\n",
+        stats.invalidPixels, stats.repaintPixels,
+        stats.overdrawPixels, (uint32_t)((uint64_t)stats.overdrawPixels * 100 / invalid),
+        stats.savedPixels, (uint32_t)((uint64_t)stats.savedPixels * 100 / invalid));
+}
@@ -0,0 +1,178 @@
+/// @page DirtyRegion_Page Dirty Region Manager
+///
+/// A DirtyRegion collects the rectangles of the screen that need to be
+/// repainted, and gives back a short list of rectangles that cover them,
+/// so that a UI redraws only what changed, rather than whole panels.
+///
+/// Each repaint rectangle costs a setup on the bus - the window and the
+/// cursor, about a dozen register writes - besides its pixels. So as each
+/// rectangle is added, it is merged with any that it overlaps, as the
+/// overlap would otherwise be sent twice, however much the union adds, and
+/// with any that it may join for less than that setup cost in extra pixels.
+/// The list holds
+/// DIRTY_REGION_RECTS entries, and when it is full, a new rectangle is
+/// merged into the one it grows least.
+///
+/// @code
+///     DirtyRegion region;
+///
+///     region.Invalidate(speedRect);       // as values change
+///     region.Invalidate(rpmRect);
+///     ...
+///     rect_t r[DIRTY_REGION_RECTS];
+///     int n = region.Take(r, DIRTY_REGION_RECTS);
+///     for (int i=0; i<n; i++)
+///         RepaintPanel(r[i]);
+///     region.ReportStats(pc);
+/// @endcode
+///
+/// The statistics count what was invalidated and what was repainted, with
+/// the pixels repainted only because rectangles were merged (overdraw), and
+/// the overlapping pixels not repainted twice (saved). Overdraw and saved
+/// are reckoned for each pair as it merges, so they are close, not exact,
+/// where three or more rectangles overlap.
+///
+#ifndef DIRTYREGION_H
+#define DIRTYREGION_H
+#include <mbed.h>
+#include "DisplayDefs.h"
+
+#ifndef DIRTY_REGION_RECTS
+#define DIRTY_REGION_RECTS 8        ///< rectangles held before they are forced to merge
+#endif
+
+#ifndef DIRTY_SETUP_COST
+#define DIRTY_SETUP_COST 32         ///< the setup of a rectangle, in pixels; ~64 bytes at 16 bpp
+#endif
+
+/// The statistics of a DirtyRegion.
+///
+typedef struct {
+    uint32_t invalidated;           ///< rectangles given to Invalidate
+    uint32_t merges;                ///< merges, each of which saves a setup
+    uint32_t takes;                 ///< calls to Take that returned rectangles
+    uint32_t repaints;              ///< rectangles returned by Take
+    uint32_t invalidPixels;         ///< pixels given to Invalidate, summed
+    uint32_t repaintPixels;         ///< pixels returned by Take, summed
+    uint32_t overdrawPixels;        ///< pixels repainted only because of a merge
+    uint32_t savedPixels;           ///< overlapping pixels not repainted twice
+} DirtyRegionStats_T;
+
+/// Tracks the parts of the screen which need repainting.
+///
+class DirtyRegion
+{
+public:
+    /// Constructor.
+    ///
+    /// @param[in] setupCost is the cost of the setup of a rectangle, in pixels.
+    ///
+    DirtyRegion(uint32_t setupCost = DIRTY_SETUP_COST);
+
+    /// Set the cost of the setup of a rectangle, which is how many extra
+    /// pixels may be repainted to save one.
+    ///
+    /// @param[in] setupCost is the cost in pixels.
+    ///
+    void SetSetupCost(uint32_t setupCost) { this->setupCost = setupCost; }
+
+    /// Set a rectangle to clip what is invalidated to, such as the screen.
+    ///
+    /// @param[in] clip is the rectangle.
+    ///
+    void SetClip(rect_t clip);
+
+    /// Mark a rectangle as needing repaint.
+    ///
+    /// @param[in] r is the rectangle. The corners may be given in any order.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Invalidate(rect_t r);
+
+    /// Mark a rectangle as needing repaint.
+    ///
+    /// @param[in] x1 is the horizontal start of the rectangle.
+    /// @param[in] y1 is the vertical start of the rectangle.
+    /// @param[in] x2 is the horizontal end of the rectangle.
+    /// @param[in] y2 is the vertical end of the rectangle.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Invalidate(loc_t x1, loc_t y1, loc_t x2, loc_t y2);
+
+    /// Forget the rectangles, without counting them as repainted.
+    ///
+    void Clear(void) { count = 0; }
+
+    /// Get the number of rectangles that need repaint.
+    ///
+    /// @returns the count.
+    ///
+    int Count(void) { return count; }
+
+    /// Get the rectangles that need repaint, without taking them.
+    ///
+    /// @returns a pointer to Count() rectangles.
+    ///
+    const rect_t * Rects(void) { return rects; }
+
+    /// Take the rectangles that need repaint, which leaves the region
+    /// empty, unless there was not room for them all.
+    ///
+    /// @param[out] out is where to put the rectangles.
+    /// @param[in] max is the most that out can hold; DIRTY_REGION_RECTS
+    ///     always holds all of them.
+    /// @returns the number of rectangles put in out.
+    ///
+    int Take(rect_t * out, int max);
+
+    /// Get the statistics.
+    ///
+    /// @returns the statistics since they were last cleared.
+    ///
+    DirtyRegionStats_T GetStats(void) { return stats; }
+
+    /// Clear the statistics.
+    ///
+    void ClearStats(void);
+
+    /// Report the statistics.
+    ///
+    /// @param[in,out] pc is the serial channel to report on.
+    ///
+    void ReportStats(Serial & pc);
+
+    /// Get the number of pixels in a rectangle.
+    ///
+    /// @param[in] r is the rectangle, with p1 the top left corner.
+    /// @returns the number of pixels.
+    ///
+    static uint32_t Area(rect_t r);
+
+    /// Get the smallest rectangle that holds two others.
+    ///
+    /// @param[in] a is one rectangle.
+    /// @param[in] b is the other.
+    /// @returns the union.
+    ///
+    static rect_t Union(rect_t a, rect_t b);
+
+    /// Get the number of pixels two rectangles share.
+    ///
+    /// @param[in] a is one rectangle.
+    /// @param[in] b is the other.
+    /// @returns the number of pixels, which is zero if they do not overlap.
+    ///
+    static uint32_t Overlap(rect_t a, rect_t b);
+
+private:
+    void _account(rect_t a, rect_t b, rect_t u);
+
+    rect_t rects[DIRTY_REGION_RECTS];   ///< the rectangles that need repaint
+    int count;                      ///< entries of rects in use
+    uint32_t setupCost;             ///< the cost of a setup, in pixels
+    rect_t clip;                    ///< what is invalidated is clipped to this
+    bool clipping;                  ///< a clip is set
+    DirtyRegionStats_T stats;       ///< the statistics
+};
+
+#endif // DIRTYREGION_H
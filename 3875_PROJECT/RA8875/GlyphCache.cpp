@@ -0,0 +1,167 @@
+// Glyph Cache.
+//
+// See the GlyphCache.h file for full details.
+//
+#include "GlyphCache.h"
+
+//#include "Utility.h"            // private memory manager
+#ifndef UTILITY_H
+#define swMalloc malloc         // use the standard
+#define swFree free
+#endif
+
+//#define DEBUG "GLYC"
+// ...
+// INFO("Stuff to show %d", var); // new-line is automatically appended
+//
+#if (defined(DEBUG) && !defined(TARGET_LPC11U24))
+#define INFO(x, ...) std::printf("[INF %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define WARN(x, ...) std::printf("[WRN %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define ERR(x, ...)  std::printf("[ERR %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#else
+#define INFO(x, ...)
+#define WARN(x, ...)
+#define ERR(x, ...)
+#endif
+
+
+static bool SameKey(const GlyphKey_T & a, const GlyphKey_T & b)
+{
+    return a.bits == b.bits && a.w == b.w && a.h == b.h && a.scaleX == b.scaleX && a.scaleY == b.scaleY;
+}
+
+
+GlyphCache::GlyphCache(uint32_t _budget)
+{
+    for (int i=0; i<GLYPH_CACHE_ENTRIES; i++) {
+        entry[i].data = NULL;
+        entry[i].pinned = false;
+    }
+    budget = _budget;
+    useCount = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+GlyphCache::~GlyphCache()
+{
+    Clear();
+}
+
+
+void GlyphCache::SetBudget(uint32_t _budget)
+{
+    Clear();
+    budget = _budget;
+}
+
+
+const uint8_t * GlyphCache::Find(const GlyphKey_T & key, uint32_t * size, bool pin)
+{
+    for (int i=0; i<GLYPH_CACHE_ENTRIES; i++) {
+        if (entry[i].data && SameKey(entry[i].key, key)) {
+            entry[i].lastUse = ++useCount;
+            entry[i].pinned |= pin;
+            stats.hits++;
+            *size = entry[i].size;
+            return entry[i].data;
+        }
+    }
+    stats.misses++;
+    return NULL;
+}
+
+
+uint8_t * GlyphCache::Insert(const GlyphKey_T & key, uint32_t size, bool pin)
+{
+    int slot = -1;
+
+    if (size == 0 || size > budget) {
+        stats.rejects++;
+        return NULL;
+    }
+    for (;;) {
+        int oldest = -1;
+
+        slot = -1;
+        for (int i=0; i<GLYPH_CACHE_ENTRIES; i++) {
+            if (entry[i].data == NULL) {
+                if (slot < 0)
+                    slot = i;
+            } else if (!entry[i].pinned && (oldest < 0 || entry[i].lastUse < entry[oldest].lastUse)) {
+                oldest = i;
+            }
+        }
+        if (slot >= 0 && stats.bytesUsed + size <= budget)
+            break;
+        if (oldest < 0) {           // the rest are pinned
+            stats.rejects++;
+            return NULL;
+        }
+        _evict(oldest);
+    }
+    entry[slot].data = (uint8_t *)swMalloc(size);
+    if (entry[slot].data == NULL) {
+        ERR("no RAM for a %u byte glyph", size);
+        stats.rejects++;
+        return NULL;
+    }
+    entry[slot].key = key;
+    entry[slot].size = size;
+    entry[slot].lastUse = ++useCount;
+    entry[slot].pinned = pin;
+    stats.bytesUsed += size;
+    stats.entries++;
+    return entry[slot].data;
+}
+
+
+void GlyphCache::UnpinAll(void)
+{
+    for (int i=0; i<GLYPH_CACHE_ENTRIES; i++)
+        entry[i].pinned = false;
+}
+
+
+void GlyphCache::_evict(int i)
+{
+    INFO("evict %p, %u bytes", entry[i].key.bits, entry[i].size);
+    swFree(entry[i].data);
+    entry[i].data = NULL;
+    stats.bytesUsed -= entry[i].size;
+    stats.entries--;
+    stats.evictions++;
+}
+
+
+void GlyphCache::Clear(void)
+{
+    for (int i=0; i<GLYPH_CACHE_ENTRIES; i++) {
+        if (entry[i].data) {
+            swFree(entry[i].data);
+            entry[i].data = NULL;
+        }
+    }
+    stats.bytesUsed = 0;
+    stats.entries = 0;
+}
+
+
+void GlyphCache::ClearStats(void)
+{
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.evictions = 0;
+    stats.rejects = 0;
+}
+
+
+void GlyphCache::ReportStats(Serial & pc)
+{
+    uint32_t lookups = stats.hits + stats.misses;
+
+    pc.printf("GlyphCache: %u hits, %u misses (%u%% hit), %u evicted, %u not held\r\n",
+        stats.hits, stats.misses, (lookups) ? (uint32_t)((uint64_t)stats.hits * 100 / lookups) : 0,
+        stats.evictions, stats.rejects);
+    pc.printf("  %u glyphs in %u of %u bytes\r\n", stats.entries, stats.bytesUsed, budget);
+}
@@ -0,0 +1,147 @@
+/// @page GlyphCache_Page Glyph Cache
+///
+/// A GlyphCache holds the ready-to-send data of the glyphs drawn most
+/// recently, so that a glyph drawn again is sent as it is, rather than
+/// being prepared once more from the font. A numeric readout, which redraws
+/// the same dozen digits many times a second, then prepares each digit only
+/// once.
+///
+/// The RA8875 draws the user font glyphs with the BTE color expansion (see
+/// @ref RA8875::fontblit), so what is sent is the glyph at one bit a
+/// pixel, with the bits in the order the BTE takes them, and each pixel and
+/// row repeated for the font scale. The colors are applied by the
+/// controller, so they are not a part of the key, and a glyph is found
+/// whatever colors it is drawn in.
+///
+/// The entries are allocated as they are added, up to a budget of bytes,
+/// and when an entry does not fit, the least recently used are evicted
+/// until it does. An entry that is pinned, as those of a run of glyphs being
+/// sent together, is not evicted until it is unpinned.
+///
+/// @code
+///     lcd.SelectUserFont(BPG_Arial20x20);
+///     lcd.SetGlyphCache(4096);                // the default is GLYPH_CACHE_BYTES
+///     ...
+///     lcd.GetGlyphCache().ReportStats(pc);
+/// @endcode
+///
+#ifndef GLYPHCACHE_H
+#define GLYPHCACHE_H
+#include <mbed.h>
+#include "DisplayDefs.h"
+
+#ifndef GLYPH_CACHE_BYTES
+#define GLYPH_CACHE_BYTES 2048      ///< the default budget, in bytes
+#endif
+
+#ifndef GLYPH_CACHE_ENTRIES
+#define GLYPH_CACHE_ENTRIES 32      ///< the most glyphs held, whatever their size
+#endif
+
+/// What identifies a glyph in a @ref GlyphCache.
+///
+typedef struct {
+    const uint8_t * bits;           ///< the glyph in the font, which stands for the font and the character
+    dim_t w;                        ///< its width
+    dim_t h;                        ///< its height
+    uint8_t scaleX;                 ///< the horizontal scale it is prepared for
+    uint8_t scaleY;                 ///< the vertical scale it is prepared for
+} GlyphKey_T;
+
+/// The statistics of a GlyphCache.
+///
+typedef struct {
+    uint32_t hits;                  ///< glyphs found
+    uint32_t misses;                ///< glyphs not found
+    uint32_t evictions;             ///< entries evicted to make room
+    uint32_t rejects;               ///< glyphs larger than the budget, which were not held
+    uint32_t bytesUsed;             ///< bytes held now
+    uint32_t entries;               ///< entries held now
+} GlyphCacheStats_T;
+
+/// A least recently used cache of prepared glyphs.
+///
+class GlyphCache
+{
+public:
+    /// Constructor.
+    ///
+    /// @param[in] budget is the most bytes of glyph data to hold.
+    ///
+    GlyphCache(uint32_t budget = GLYPH_CACHE_BYTES);
+
+    /// Destructor, which frees the entries.
+    ///
+    ~GlyphCache();
+
+    /// Set the budget, which empties the cache.
+    ///
+    /// @param[in] budget is the most bytes of glyph data to hold; 0 turns
+    ///     the cache off.
+    ///
+    void SetBudget(uint32_t budget);
+
+    /// Find a glyph.
+    ///
+    /// @param[in] key identifies the glyph.
+    /// @param[out] size is where the number of bytes of the data is written.
+    /// @param[in] pin is true to keep the entry until @ref UnpinAll, so that
+    ///     the data stays valid while other glyphs are inserted.
+    /// @returns the data, or NULL if it is not held.
+    ///
+    const uint8_t * Find(const GlyphKey_T & key, uint32_t * size, bool pin = false);
+
+    /// Make room for a glyph, which is then filled in by the caller.
+    ///
+    /// Only the entries that are not pinned are evicted for it.
+    ///
+    /// @param[in] key identifies the glyph.
+    /// @param[in] size is the number of bytes of the data.
+    /// @param[in] pin is true to keep the entry until @ref UnpinAll.
+    /// @returns where to put the data, or NULL if it is not to be held.
+    ///
+    uint8_t * Insert(const GlyphKey_T & key, uint32_t size, bool pin = false);
+
+    /// Let all of the pinned entries be evicted again.
+    ///
+    void UnpinAll(void);
+
+    /// Forget all of the glyphs, as when a font is no longer in memory.
+    ///
+    void Clear(void);
+
+    /// Get the statistics.
+    ///
+    /// @returns the statistics, with the hits and misses since they were cleared.
+    ///
+    GlyphCacheStats_T GetStats(void) { return stats; }
+
+    /// Clear the hit, miss, eviction and reject counts.
+    ///
+    void ClearStats(void);
+
+    /// Report the statistics.
+    ///
+    /// @param[in,out] pc is the serial channel to report on.
+    ///
+    void ReportStats(Serial & pc);
+
+private:
+    /// One glyph.
+    typedef struct {
+        GlyphKey_T key;             ///< what it is
+        uint8_t * data;             ///< the prepared data, or NULL when the entry is free
+        uint32_t size;              ///< bytes of data
+        uint32_t lastUse;           ///< when it was last found or added
+        bool pinned;                ///< not to be evicted, see UnpinAll
+    } GlyphEntry_T;
+
+    void _evict(int i);
+
+    GlyphEntry_T entry[GLYPH_CACHE_ENTRIES];    ///< the glyphs
+    uint32_t budget;                ///< the most bytes to hold
+    uint32_t useCount;              ///< a clock for the least recently used
+    GlyphCacheStats_T stats;        ///< the statistics
+};
+
+#endif // GLYPHCACHE_H
@@ -154,6 +154,21 @@ RetCode_t GraphicsDisplay::_putp(color_t color)
     return noerror;
 }
 
+RetCode_t GraphicsDisplay::pixelStreamAsync(const color_t * p, uint32_t count, loc_t x, loc_t y)
+{
+    return pixelStream((color_t *)p, count, x, y);
+}
+
+RetCode_t GraphicsDisplay::pixelStreamInPlace(const color_t * p, uint32_t count, loc_t x, loc_t y)
+{
+    return pixelStreamAsync(p, count, x, y);
+}
+
+RetCode_t GraphicsDisplay::flush(void)
+{
+    return noerror;
+}
+
 RetCode_t GraphicsDisplay::fill(loc_t x, loc_t y, dim_t w, dim_t h, color_t color)
 {
     return fillrect(x,y, x+w, y+h, color);
@@ -280,6 +295,7 @@ RGBQUAD GraphicsDisplay::RGB16ToRGBQuad(color_t c)
 
 RetCode_t GraphicsDisplay::_RenderBitmap(loc_t x, loc_t y, uint32_t fileOffset, FILE * Image)
 {
+    SPAN("_RenderBitmap");
     BITMAPINFOHEADER BMP_Info;
     RGBQUAD * colorPalette = NULL;
     int colorCount;
@@ -358,6 +374,7 @@ RetCode_t GraphicsDisplay::_RenderBitmap(loc_t x, loc_t y, uint32_t fileOffset,
     //HexDump("Raw Data", (uint8_t *)&start_data, 32);
     INFO("(%d,%d) (%d,%d), [%d,%d]", x,y, PixelWidth,PixelHeight, lineBufSize, padd);
     for (j = PixelHeight - 1; j >= 0; j--) {                //Lines bottom up
+        SPAN("_RenderBitmap row");
         offset = fileOffset + j * (lineBufSize + padd);     // start of line
         fseek(Image, offset, SEEK_SET);
         fread(lineBuffer, 1, lineBufSize, Image);           // read a line - slow !
@@ -385,9 +402,10 @@ RetCode_t GraphicsDisplay::_RenderBitmap(loc_t x, loc_t y, uint32_t fileOffset,
                 pixelBuffer[i] = color;
             }
         }
-        pixelStream(pixelBuffer, PixelWidth, x, y++);
+        pixelStreamAsync(pixelBuffer, PixelWidth, x, y++);   // sends while the next line is read
     }
 //    _EndGraphicsStream();
+    flush();
     window(restore);
     swFree(pixelBuffer);      // don't leak memory
     swFree(lineBuffer);
@@ -399,6 +417,7 @@ RetCode_t GraphicsDisplay::_RenderBitmap(loc_t x, loc_t y, uint32_t fileOffset,
 
 RetCode_t GraphicsDisplay::RenderImageFile(loc_t x, loc_t y, const char *FileName)
 {
+    SPAN("RenderImageFile");
     if (mystrnicmp(FileName + strlen(FileName) - 4, ".bmp", 4) == 0) {
         return RenderBitmapFile(x,y,FileName);
     } else if (mystrnicmp(FileName + strlen(FileName) - 4, ".jpg", 4) == 0) {
@@ -414,6 +433,7 @@ RetCode_t GraphicsDisplay::RenderImageFile(loc_t x, loc_t y, const char *FileNam
 
 RetCode_t GraphicsDisplay::RenderJpegFile(loc_t x, loc_t y, const char *Name_JPG)
 {
+    SPAN("RenderJpegFile");
     #define JPEG_WORK_SPACE_SIZE 3100   // Worst case requirements for the decompression
     JDEC * jdec;
     uint16_t * work;
@@ -436,6 +456,8 @@ RetCode_t GraphicsDisplay::RenderJpegFile(loc_t x, loc_t y, const char *Name_JPG
                 img_x = x;  // save the origin for the privOutput function
                 img_y = y;
                 r = (RetCode_t)jd_decomp(jdec, NULL, 0);
+                flush();
+                window();
             } else {
                 r = not_supported_format;   // error("jd_prepare error:%d", r);
             }
@@ -455,6 +477,7 @@ RetCode_t GraphicsDisplay::RenderJpegFile(loc_t x, loc_t y, const char *Name_JPG
 
 RetCode_t GraphicsDisplay::RenderBitmapFile(loc_t x, loc_t y, const char *Name_BMP)
 {
+    SPAN("RenderBitmapFile");
     BITMAPFILEHEADER BMP_Header;
 
     INFO("Opening {%s}", Name_BMP);
@@ -482,6 +505,7 @@ RetCode_t GraphicsDisplay::RenderBitmapFile(loc_t x, loc_t y, const char *Name_B
 
 RetCode_t GraphicsDisplay::RenderIconFile(loc_t x, loc_t y, const char *Name_ICO)
 {
+    SPAN("RenderIconFile");
     ICOFILEHEADER ICO_Header;
     ICODIRENTRY ICO_DirEntry;
 
@@ -16,6 +16,7 @@
 #define MBED_GRAPHICSDISPLAY_H
 #include "Bitmap.h"
 #include "TextDisplay.h"
+#include "SpanTrace.h"
 #include "GraphicsDisplayJPEG.h"
 #include "GraphicsDisplayGIF.h"
 
@@ -58,6 +59,49 @@ public:
     ///
     virtual RetCode_t pixelStream(color_t * p, uint32_t count, loc_t x, loc_t y) = 0;
 
+    /// Write a stream of pixels to the display, without waiting for the
+    /// transfer to complete.
+    ///
+    /// The caller may reuse the pixel buffer as soon as this returns.
+    ///
+    /// @note this method may be overridden in a derived class that can
+    ///     overlap the transfer with other work. The default simply calls
+    ///     pixelStream.
+    ///
+    /// @param[in] p is a pointer to a color_t array to write.
+    /// @param[in] count is the number of pixels to write.
+    /// @param[in] x is the horizontal position on the display.
+    /// @param[in] y is the vertical position on the display.
+    /// @returns success/failure code. @see RetCode_t.
+    ///
+    virtual RetCode_t pixelStreamAsync(const color_t * p, uint32_t count, loc_t x, loc_t y);
+
+    /// Write a stream of pixels to the display from where they are, without
+    /// waiting for the transfer to complete.
+    ///
+    /// Unlike @ref pixelStreamAsync, the pixels are not copied, so the
+    /// caller must not change them until the stream is finished, which
+    /// @ref flush, and any other access to the display, waits for.
+    ///
+    /// @note this method may be overridden in a derived class that can send
+    ///     from the buffer. The default simply calls pixelStreamAsync.
+    ///
+    /// @param[in] p is a pointer to a color_t array to write.
+    /// @param[in] count is the number of pixels to write.
+    /// @param[in] x is the horizontal position on the display.
+    /// @param[in] y is the vertical position on the display.
+    /// @returns success/failure code. @see RetCode_t.
+    ///
+    virtual RetCode_t pixelStreamInPlace(const color_t * p, uint32_t count, loc_t x, loc_t y);
+
+    /// Wait for any stream started with pixelStreamAsync to finish.
+    ///
+    /// @note this method may be overridden in a derived class.
+    ///
+    /// @returns success/failure code. @see RetCode_t.
+    ///
+    virtual RetCode_t flush(void);
+
     /// Get a pixel from the display.
     ///
     /// @note this method must be supported in the derived class.
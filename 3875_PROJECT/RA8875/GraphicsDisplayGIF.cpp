@@ -115,6 +115,7 @@ size_t GraphicsDisplay::read_filesystem_bytes(void * buffer, int numBytes, FILE
 /// @return noerror on success, or failure code
 ///
 RetCode_t GraphicsDisplay::uncompress_gif(int code_length, const unsigned char *input, int input_length, unsigned char *out) {
+    SPAN("uncompress_gif");
     int i, bit;
     int code, prev = -1;
     dictionary_entry_t * dictionary;
@@ -410,6 +411,7 @@ int GraphicsDisplay::process_gif_extension(FILE * fh) {
 
 
 RetCode_t GraphicsDisplay::_RenderGIF(loc_t ScreenX, loc_t ScreenY, FILE * fh) {
+    SPAN("_RenderGIF");
     //int color_resolution_bits;
     global_color_table_size = 0;
     local_color_table_size = 0;
@@ -470,15 +472,15 @@ RetCode_t GraphicsDisplay::_RenderGIF(loc_t ScreenX, loc_t ScreenY, FILE * fh) {
                             INFO("\r\n");
                         }
                         #else
-                        rect_t restore = windowrect;
+                        // The caller restores the window, so the stream can drain
+                        // while the next block is decoded.
                         window(ScreenX + gif_image_descriptor.image_left_position,
                             ScreenY + gif_image_descriptor.image_top_position,
                             gif_image_descriptor.image_width,
                             gif_image_descriptor.image_height);
-                        pixelStream(cbmp, screen_descriptor.width * screen_descriptor.height,
+                        pixelStreamAsync(cbmp, screen_descriptor.width * screen_descriptor.height,
                             ScreenX + gif_image_descriptor.image_left_position,
                             ScreenY + gif_image_descriptor.image_top_position);
-                        window(restore);
                         #endif
                         // end write
                         free(cbmp);
@@ -561,6 +563,7 @@ RetCode_t GraphicsDisplay::GetGIFMetrics(gif_screen_descriptor_t * imageDescript
 
 
 RetCode_t GraphicsDisplay::RenderGIFFile(loc_t x, loc_t y, const char *Name_GIF) {
+    SPAN("RenderGIFFile");
     RetCode_t rt = file_not_found;
 
     INFO("Opening {%s}", Name_GIF);
@@ -568,7 +571,10 @@ RetCode_t GraphicsDisplay::RenderGIFFile(loc_t x, loc_t y, const char *Name_GIF)
     FILE *fh = fopen(Name_GIF, "rb");
     if (fh) {
         if (hasGIFHeader(fh)) {
+            rect_t restore = windowrect;
             rt = _RenderGIF(x, y, fh);
+            flush();
+            window(restore);
         }
         fclose(fh);
         if (global_color_table)
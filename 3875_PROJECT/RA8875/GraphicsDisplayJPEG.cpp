@@ -516,6 +516,7 @@ JRESULT GraphicsDisplay::mcu_load (
     JDEC * jd        /* Pointer to the decompressor object */
 )
 {
+    SPAN("mcu_load");
     int32_t *tmp = (int32_t *)jd->workbuf; /* Block working buffer for de-quantize and IDCT */
     uint16_t blk, nby, nbc, i, z, id, cmp;
     int16_t b, d, e;
@@ -603,6 +604,7 @@ JRESULT GraphicsDisplay::mcu_output (
     uint16_t y      /* MCU position in the image (top of the MCU) */
 )
 {
+    SPAN("mcu_output");
     const int16_t CVACC = (sizeof (int16_t) > 2) ? 1024 : 128;
     uint16_t ix, iy, mx, my, rx, ry;
     int16_t yy, cb, cr;
@@ -856,8 +858,8 @@ uint16_t GraphicsDisplay::privOutFunc(JDEC * jd, void * bitmap, JRECT * rect)
     //
     window(x0+img_x, y0+img_y, w, y1 - y0 + 2);
     uint16_t *src = (uint16_t *)bitmap;     // pointer to RGB565 format
-    pixelStream(src, pixelCount, x0+img_x, y0+img_y);
-    window();
+    pixelStreamAsync(src, pixelCount, x0+img_x, y0+img_y);   // sends while the next MCU decodes
+    // The window is restored by RenderJpegFile, so the stream is not held up here.
 #else
     for (int y= y0; y <= y1; y++) {
         SetGraphicsCursor(x0+img_x, y+img_y);
@@ -889,6 +891,7 @@ JRESULT GraphicsDisplay::jd_prepare (
     void* dev           /* I/O device identifier for the session */
 )
 {
+    SPAN("jd_prepare");
     uint8_t *seg, b;
     uint16_t marker;
     uint32_t ofs;
@@ -1158,6 +1161,7 @@ JRESULT GraphicsDisplay::jd_decomp (
     uint8_t scale                              /* Output de-scaling factor (0 to 3) */
 )
 {
+    SPAN("jd_decomp");
     uint16_t x, y, mx, my;
     uint16_t rst, rsc;
     JRESULT rc;
@@ -59,7 +59,7 @@ static void HexDump(const char * title, const uint8_t * p, int count)
 #define RA8875_COLORDEPTH_BPP 16    /* Not an API */
 
 #ifdef PERF_METRICS
-#define PERFORMANCE_RESET performance.reset()
+#define PERFORMANCE_RESET MarkPerformance()
 #define REGISTERPERFORMANCE(a) RegisterPerformance(a)
 #define COUNTIDLETIME(a) CountIdleTime(a)
 static const char *metricsName[] = {
@@ -67,19 +67,68 @@ static const char *metricsName[] = {
     "Read Pixel", "Read Pixel Stream",
     "Line",
     "Rectangle", "Rounded Rectangle",
-    "Triangle", "Circle", "Ellipse"
+    "Triangle", "Circle", "Ellipse",
+    "BlockMove"
 };
 uint16_t commandsUsed[256];  // track which commands are used with simple counter of number of hits.
+uint16_t commandsSaved[256]; // and how many of them were answered from the register shadow.
+#define COUNTCOMMAND(a) if (commandsUsed[a] < 65535) commandsUsed[a]++
+#define COUNTSAVED(a) if (commandsSaved[a] < 65535) commandsSaved[a]++
 #else
 #define PERFORMANCE_RESET
 #define REGISTERPERFORMANCE(a)
 #define COUNTIDLETIME(a)
+#define COUNTCOMMAND(a)
+#define COUNTSAVED(a)
+#endif
+
+#ifdef RA8875_TRACE
+#define TRACEOPEN() _traceOpen()
+#define TRACEBYTES(d, n) _traceBytes(d, n)
+#define TRACECLOSE() _traceClose()
+#else
+#define TRACEOPEN() ((void)0)
+#define TRACEBYTES(d, n) ((void)0)
+#define TRACECLOSE() ((void)0)
 #endif
 
 // When it is going to poll a register for completion, how many
 // uSec should it wait between each polling activity.
 #define POLLWAITuSec 10
 
+// Event flags set by the INT and WAIT pin interrupts.
+#define COMPLETION_INT  0x01
+#define COMPLETION_WAIT 0x02
+#define COMPLETION_VSYNC 0x04
+#define COMPLETION_TIMEOUT 0x08     // and by the timeout, without the RTOS
+
+// A BTE block move is a dozen register writes, during which the controller
+// could have copied this many more pixels. Used to merge the frame copies.
+#define FRAME_COPY_SETUP_COST 512
+
+/// Identify the registers that the RA8875 changes on its own.
+///
+/// These are never held in the register shadow, so they are always
+/// written to, and read from, the display controller. The status register
+/// is read by its own command, and is never shadowed either.
+///
+static bool IsVolatileRegister(uint8_t reg)
+{
+    return (reg == 0x01)                    // PWRR - software reset self-clears
+        || (reg == 0x02)                    // MRWC - the display memory data port
+        || (reg >= 0x2A && reg <= 0x2D)     // text cursor - advances with the text
+        || (reg >= 0x46 && reg <= 0x4D)     // memory write and read cursors - advance with the data
+        || (reg == 0x50)                    // BECR0 - BTE busy
+        || (reg >= 0x70 && reg <= 0x74)     // touch panel control and data
+        || (reg == 0x8E)                    // MCLR - clear busy
+        || (reg == 0x90)                    // DCR - draw busy
+        || (reg == 0xA0)                    // DCR - ellipse and curve draw busy
+        || (reg == 0xBF)                    // DMACR - DMA busy
+        || (reg >= 0xC0 && reg <= 0xC7)     // keypad scan and GPIO
+        || (reg >= 0xE0 && reg <= 0xE4)     // serial flash and memory access
+        || (reg == 0xF1);                   // INTC2 - interrupt flags
+}
+
 // Private RawKeyMap for the Keyboard interface
 static const uint8_t DefaultKeyMap[22] = {
     0,
@@ -183,13 +232,56 @@ static int FindNearestWebColor(uint8_t r, uint8_t g, uint8_t b) {
     return bestNdx;
 }
 
+// The state that is the same for each constructor.
+void RA8875::_init(void)
+{
+    c_callback = NULL;
+    obj_callback = NULL;
+    method_callback = NULL;
+    idle_callback = NULL;
+    stream_callback = NULL;
+    fontScaleX = fontScaleY = 1;
+    spiBlockCount = 0;
+    regSelected = 0x02;
+    spiActiveFreq = 0;
+    _shadowClear();
+    m_intPin = NULL;
+    m_waitPin = NULL;
+    m_vsyncPin = NULL;
+    frameActive = false;
+    frameSynced = false;
+    frameLayer = 0;
+    frameDirty.SetSetupCost(FRAME_COPY_SETUP_COST);
+    textScroll = NoScroll;
+    scrollRolled = false;
+    textCursorKnown = false;
+    memset(userGlyph, 0, sizeof(userGlyph));
+    deferWait = false;
+    #ifdef RA8875_IRQ_WAIT
+    completionFlags = 0;
+    #endif
+    deferMask = 0;
+    deferFailed = false;
+    #ifdef RA8875_TRACE
+    traceHead = 0;
+    traceOpen = false;
+    traceEnabled = false;
+    traceApi = NULL;
+    #endif
+    #ifdef RA8875_ASYNC_SPI
+    asyncFill = 0;
+    asyncBusy = false;
+    asyncFrames16 = false;
+    #endif
+}
+
+
 // Non-Touch, or Resistive Touch when later initialized that way
 //
 RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName reset, 
     const char *name)
     : GraphicsDisplay(name)
-    , spi(mosi, miso, sclk)
-    , cs(csel)
+    , bus(mosi, miso, sclk, csel)
     , res(reset)
 {
     useTouchPanel = TP_NONE;
@@ -199,11 +291,7 @@ RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName r
     m_irq = NULL;
     m_i2c = NULL;
     m_wake = NULL;
-    c_callback = NULL;
-    obj_callback = NULL;
-    method_callback = NULL;
-    idle_callback = NULL;
-    fontScaleX = fontScaleY = 1;
+    _init();
 }
 
 // Touch, based on FT5206 Controller Chip
@@ -211,8 +299,7 @@ RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName r
 RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName reset, 
     PinName sda, PinName scl, PinName irq, const char * name) 
     : GraphicsDisplay(name)
-    , spi(mosi, miso, sclk)
-    , cs(csel)
+    , bus(mosi, miso, sclk, csel)
     , res(reset)
 {
     tpFQFN = NULL;
@@ -230,11 +317,7 @@ RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName r
     m_i2c->frequency(FT5206_I2C_FREQUENCY);
     m_wake = NULL;      // not used for FT5206
     
-    c_callback = NULL;
-    obj_callback = NULL;
-    method_callback = NULL;
-    idle_callback = NULL;
-    fontScaleX = fontScaleY = 1;
+    _init();
 
     // Interrupt
     m_irq->mode(PullUp);
@@ -256,8 +339,7 @@ RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName r
 RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName reset, 
     PinName sda, PinName scl, PinName wake, PinName irq, const char * name) 
     : GraphicsDisplay(name)
-    , spi(mosi, miso, sclk)
-    , cs(csel)
+    , bus(mosi, miso, sclk, csel)
     , res(reset)
 {
     tpFQFN = NULL;
@@ -275,11 +357,7 @@ RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName r
     m_i2c->frequency(GSL1680_I2C_FREQUENCY);
     m_wake = new DigitalOut(wake);
 
-    c_callback = NULL;
-    obj_callback = NULL;
-    method_callback = NULL;
-    idle_callback = NULL;
-    fontScaleX = fontScaleY = 1;
+    _init();
 
     // Interrupt
     m_irq->mode(PullUp);
@@ -304,6 +382,7 @@ RA8875::RA8875(PinName mosi, PinName miso, PinName sclk, PinName csel, PinName r
 
 RetCode_t RA8875::init(int width, int height, int color_bpp, uint8_t poweron, bool keypadon, bool touchscreenon)
 {
+    TRACEAPI("init");
     font = NULL;                                // no external font, use internal.
     pKeyMap = DefaultKeyMap;                    // set default key map
     _select(false);                             // deselect the display
@@ -373,6 +452,10 @@ RetCode_t RA8875::init(int width, int height, int color_bpp, uint8_t poweron, bo
     }
 
     portraitmode = false;
+    frameActive = false;
+    frameSynced = false;
+    textCursorKnown = false;
+    memset(userGlyph, 0, sizeof(userGlyph));   // the reset leaves CGRAM undefined
 
     if (width >= 800 && height >= 480 && color_bpp > 8) {
         WriteCommand(0x20, 0x00);               // DPCR - 1-layer mode when the resolution is too high
@@ -398,6 +481,7 @@ RetCode_t RA8875::init(int width, int height, int color_bpp, uint8_t poweron, bo
     }
 #ifdef PERF_METRICS
     performance.start();
+    deferTimer.start();
     ClearPerformance();
 #endif
     return noerror;
@@ -421,6 +505,7 @@ RetCode_t RA8875::Reset(void)
         ret = WriteCommand(0x01, 0x00);     // Display off, Remove reset
         wait_ms(2);                         // no idea if I need to wait, or how long
     }
+    _shadowClear();                         // the registers are back to their defaults
     return ret;
 }
 
@@ -441,6 +526,7 @@ uint16_t RA8875::GetDrawingLayer(void)
 
 RetCode_t RA8875::SelectDrawingLayer(uint16_t layer, uint16_t * prevLayer)
 {
+    TRACEAPI("SelectDrawingLayer");
     unsigned char mwcr1 = ReadCommand(0x41); // retain all but the currently selected layer
     
     if (prevLayer)
@@ -464,6 +550,7 @@ RA8875::LayerMode_T RA8875::GetLayerMode(void)
 
 RetCode_t RA8875::SetLayerMode(LayerMode_T mode)
 {
+    TRACEAPI("SetLayerMode");
     unsigned char ltpr0 = ReadCommand(0x52) & ~0x7; // retain all but the display layer mode
     
     if (mode <= (LayerMode_T)6) {
@@ -503,6 +590,94 @@ color_t RA8875::GetBackgroundTransparencyColor(void)
 }
 
 
+RetCode_t RA8875::BeginFrame(bool allow8bpp)
+{
+    TRACEAPI("BeginFrame");
+    if (screenwidth >= 800 && screenheight >= 480 && screenbpp > 8) {
+        if (!allow8bpp)
+            return not_supported_format;        // one layer, so there is nothing to flip to
+        screenbpp = 8;
+        WriteCommand(0x10, 0x00);               // SYSR - 8-bpp (256 colors)
+        WriteCommand(0x20, ReadCommand(0x20) | 0x80);   // DPCR - 2-layer mode
+        foreground(_foreground);                // the color registers are in the new format
+        background(_background);
+        SetLayerMode(ShowLayer0);
+        cls(3);
+        frameSynced = true;
+    }
+    if (!frameSynced) {
+        point_t origin = { 0, 0 };
+        uint8_t front = (GetLayerMode() == ShowLayer1) ? 1 : 0;
+
+        SetLayerMode(front ? ShowLayer1 : ShowLayer0);  // and not a mix of the two
+        if (BlockMove(front ^ 1, 0, origin, front, 0, origin, screenwidth, screenheight, 0x2, 0xC) != noerror)
+            return external_abort;
+        frameSynced = true;
+    }
+    if (!frameActive) {
+        frameLayer = (GetLayerMode() == ShowLayer1) ? 0 : 1;
+        frameDirty.Clear();
+        frameActive = true;
+    }
+    return SelectDrawingLayer(frameLayer);
+}
+
+
+RetCode_t RA8875::FrameInvalidate(rect_t r)
+{
+    return frameDirty.Invalidate(r);
+}
+
+
+RetCode_t RA8875::Present(bool vsync)
+{
+    TRACEAPI("Present");
+    RetCode_t ret;
+    rect_t r[DIRTY_REGION_RECTS];
+    int n;
+
+    if (!frameActive)
+        return bad_parameter;
+    ret = flush();                              // all of the frame is drawn before it is seen
+    if (ret != noerror)
+        return ret;
+    if (vsync && m_vsyncPin) {
+        if (_WaitForPin(m_vsyncPin, 0, COMPLETION_VSYNC, vsync_wait) == external_abort)
+            return external_abort;
+    }
+    SetLayerMode(frameLayer ? ShowLayer1 : ShowLayer0);
+    frameActive = false;
+    // The layer that was on show is now a frame behind, so bring it up to
+    // date where the frame changed it.
+    n = frameDirty.Take(r, DIRTY_REGION_RECTS);
+    for (int i=0; i<n && ret == noerror; i++) {
+        ret = BlockMove(frameLayer ^ 1, 0, r[i].p1, frameLayer, 0, r[i].p1,
+            r[i].p2.x - r[i].p1.x + 1, r[i].p2.y - r[i].p1.y + 1, 0x2, 0xC);
+    }
+    SelectDrawingLayer(frameLayer);
+    return ret;
+}
+
+
+RetCode_t RA8875::FrameSyncInit(PinName vsyncPin)
+{
+    if (m_vsyncPin) {
+        delete m_vsyncPin;
+        m_vsyncPin = NULL;
+    }
+    if (vsyncPin != NC) {
+        m_vsyncPin = new CompletionPin_T(vsyncPin);
+        if (!m_vsyncPin)
+            return not_enough_ram;
+        m_vsyncPin->mode(PullUp);
+        #if defined(RA8875_RTOS_WAIT) || defined(RA8875_IRQ_WAIT)
+        m_vsyncPin->fall(callback(this, &RA8875::_vsyncPinISR));
+        #endif
+    }
+    return noerror;
+}
+
+
 RetCode_t RA8875::KeypadInit(bool scanEnable, bool longDetect, uint8_t sampleTime, uint8_t scanFrequency,
                              uint8_t longTimeAdjustment, bool interruptEnable, bool wakeupEnable)
 {
@@ -625,11 +800,63 @@ void RA8875::ClearPerformance()
 {
     int i;
     
-    for (i=0; i<METRICCOUNT; i++)
-        metrics[i] = 0;
+    memset(perfHistogram, 0, sizeof(perfHistogram));
     idletime_usec = 0;
-    for (i=0; i<256; i++)
+    deferredWaits = 0;
+    deferredOverlap_usec = 0;
+    deferredWait_usec = 0;
+    for (i=0; i<256; i++) {
         commandsUsed[i] = 0;
+        commandsSaved[i] = 0;
+    }
+    #ifdef RA8875_SIMULATED_SPI
+    for (i=0; i<METRICCOUNT; i++)
+        methodPredicted_ns[i] = 0;
+    #endif
+}
+
+
+// The bytes and transactions of each method are counted from the bus counts
+// at the start and end of the method. A non-blocking stream still in flight
+// when a method returns is counted by the next method.
+void RA8875::MarkPerformance(void)
+{
+    performance.reset();
+    markBytes = bus.Bytes();
+    markTransactions = bus.Transactions();
+    #ifdef RA8875_SIMULATED_SPI
+    markPredicted_ns = bus.PredictedTime_ns();
+    #endif
+}
+
+
+// The histogram bucket of a time, 4 to an octave, as described at
+// PerformanceSnapshot.
+static int PerfBucket(uint32_t usec)
+{
+    int msb;
+
+    if (usec < 4)
+        return usec;
+    #if defined(__GNUC__)
+    msb = 31 - __builtin_clz(usec);
+    #elif defined(__CC_ARM)
+    msb = 31 - __clz(usec);
+    #else
+    for (msb = 2; (usec >> msb) > 1; msb++)
+        ;
+    #endif
+    int b = (msb - 1) * 4 + ((usec >> (msb - 2)) & 3);
+    return (b < PERF_BUCKETS) ? b : PERF_BUCKETS - 1;
+}
+
+
+// The lowest time counted by a bucket.
+static uint32_t PerfBucketFloor(int b)
+{
+    if (b < 4)
+        return b;
+    return (uint32_t)(4 + b % 4) << (b / 4 - 1);
 }
 
 
@@ -637,8 +864,34 @@ void RA8875::RegisterPerformance(method_e method)
 {
     unsigned long elapsed = performance.read_us();
 
-    if (method < METRICCOUNT && elapsed > metrics[method])
-        metrics[method] = elapsed;
+    if (method < METRICCOUNT) {
+        PerfHistogram_T * h = &perfHistogram[method];
+
+        h->calls++;
+        if (elapsed > h->max_usec)
+            h->max_usec = elapsed;
+        h->bytes += bus.Bytes() - markBytes;
+        h->transactions += bus.Transactions() - markTransactions;
+        h->buckets[PerfBucket(elapsed)]++;
+        #ifdef RA8875_SIMULATED_SPI
+        methodPredicted_ns[method] += bus.PredictedTime_ns() - markPredicted_ns;
+        #endif
+    }
+}
+
+
+// The time at the given percentile, as the top of the bucket it falls in.
+static uint32_t PerfPercentile(const uint32_t * buckets, uint32_t calls, int percent)
+{
+    uint32_t rank = ((uint64_t)calls * percent + 99) / 100;     // nearest rank
+    uint32_t seen = 0;
+
+    for (int b=0; b<PERF_BUCKETS-1; b++) {
+        seen += buckets[b];
+        if (seen >= rank)
+            return PerfBucketFloor(b + 1) - 1;
+    }
+    return PerfBucketFloor(PERF_BUCKETS - 1);
 }
 
 
@@ -653,14 +906,243 @@ void RA8875::ReportPerformance(Serial & pc)
     int i;
     
     pc.printf("\r\nPerformance Metrics\r\n");
+    pc.printf("     calls    p50 uS    p90 uS    p99 uS    max uS bytes/call trans/call\r\n");
     for (i=0; i<METRICCOUNT; i++) {
-        pc.printf("%10d uS %s\r\n", metrics[i], metricsName[i]);
+        PerfHistogram_T * h = &perfHistogram[i];
+
+        if (h->calls)
+            pc.printf("%10d%10d%10d%10d%10d%11d%11d %s\r\n", h->calls,
+                PerfPercentile(h->buckets, h->calls, 50), PerfPercentile(h->buckets, h->calls, 90),
+                PerfPercentile(h->buckets, h->calls, 99), h->max_usec,
+                h->bytes / h->calls, h->transactions / h->calls, metricsName[i]);
     }
     pc.printf("%10d uS Idle time polling display for ready.\r\n", idletime_usec);
+    pc.printf("%10d uS Run on after %d deferred waits, %d uS engine time still waited for.\r\n",
+        deferredOverlap_usec, deferredWaits, deferredWait_usec);
+    #ifdef RA8875_SIMULATED_SPI
+    for (i=0; i<METRICCOUNT; i++) {
+        if (perfHistogram[i].calls)
+            pc.printf("%10d uS predicted on the target for %s.\r\n",
+                (uint32_t)(methodPredicted_ns[i] / 1000), metricsName[i]);
+    }
+    #endif
     for (i=0; i<256; i++) {
         if (commandsUsed[i])
-            pc.printf("Command %02X used %5d times.\r\n", i, commandsUsed[i]);
+            pc.printf("Command %02X used %5d times, %5d saved by the register shadow.\r\n", 
+                i, commandsUsed[i], commandsSaved[i]);
+    }
+}
+
+
+static void PutU16(FILE * fh, uint16_t v)
+{
+    fputc(v & 0xFF, fh);
+    fputc(v >> 8, fh);
+}
+
+
+static void PutU32(FILE * fh, uint32_t v)
+{
+    PutU16(fh, v & 0xFFFF);
+    PutU16(fh, v >> 16);
+}
+
+
+static void PutText(FILE * fh, const char * text, int size)
+{
+    for (int i=0; i<size; i++) {
+        fputc(*text, fh);
+        if (*text)
+            text++;
+    }
+}
+
+
+RetCode_t RA8875::PerformanceSnapshot(const char * name)
+{
+    FILE * fh = fopen(name, "wb");
+
+    if (!fh)
+        return file_not_found;
+    fwrite("R8PH", 1, 4, fh);
+    PutU16(fh, 1);                  // version
+    PutU16(fh, METRICCOUNT);
+    PutU16(fh, PERF_BUCKETS);
+    PutU16(fh, 4);                  // sub-buckets per octave
+    PutText(fh, __DATE__ " " __TIME__, 32);
+    for (int i=0; i<METRICCOUNT; i++) {
+        PerfHistogram_T * h = &perfHistogram[i];
+
+        PutText(fh, metricsName[i], 24);
+        PutU32(fh, h->calls);
+        PutU32(fh, h->max_usec);
+        PutU32(fh, h->bytes);
+        PutU32(fh, h->transactions);
+        for (int b=0; b<PERF_BUCKETS; b++)
+            PutU32(fh, h->buckets[b]);
+    }
+    fclose(fh);
+    return noerror;
+}
+#endif
+
+
+#ifdef RA8875_TRACE
+void RA8875::TraceEnable(bool enable)
+{
+    traceEnabled = false;
+    if (enable) {
+        traceOpen = false;
+        traceHead = 0;
+        traceTimer.reset();
+        traceTimer.start();
+        traceEnabled = true;
+    } else {
+        traceTimer.stop();
+    }
+}
+
+
+// The entry at traceHead is filled while its transaction is in progress,
+// and is published by advancing traceHead when the chip select is released,
+// which may be from the interrupt context for a non-blocking stream. There
+// is one transaction at a time, so there is one writer at a time.
+void RA8875::_traceOpen(void)
+{
+    if (traceEnabled) {
+        TraceEntry_T * e = &traceBuf[traceHead % RA8875_TRACE_SIZE];
+
+        e->usec = traceTimer.read_us();
+        e->api = traceApi;
+        e->bytes = 0;
+        e->duration = 0;
+        e->type = 0xFF;
+        e->reg = 0;
+        traceOpen = true;
+    }
+}
+
+
+// The type and register are taken from the first two bytes, and the reads,
+// which have no data to pass here, always follow a data read cycle byte.
+void RA8875::_traceBytes(const uint8_t * data, int count)
+{
+    if (traceOpen) {
+        TraceEntry_T * e = &traceBuf[traceHead % RA8875_TRACE_SIZE];
+
+        for (int i=0; data && i<count && e->bytes+i < 2; i++) {
+            if (e->bytes + i == 0) {
+                e->type = data[i] & 0xC0;
+                e->reg = (e->type == 0xC0) ? 0 : regSelected;
+            } else if (e->type == 0x80) {
+                e->reg = data[i];
+            }
+        }
+        e->bytes += count;
+    }
+}
+
+
+void RA8875::_traceClose(void)
+{
+    if (traceOpen) {
+        TraceEntry_T * e = &traceBuf[traceHead % RA8875_TRACE_SIZE];
+
+        e->duration = traceTimer.read_us() - e->usec;
+        traceOpen = false;
+        traceHead = traceHead + 1;
+    }
+}
+
+
+uint32_t RA8875::TraceRead(TraceEntry_T * entries, uint32_t count)
+{
+    uint32_t head = traceHead;
+    uint32_t first = (head >= RA8875_TRACE_SIZE) ? head - RA8875_TRACE_SIZE + 1 : 0;
+    uint32_t n = 0;
+
+    if (head - first > count)
+        first = head - count;
+    for (uint32_t i=first; i<head; i++)
+        entries[n++] = traceBuf[i % RA8875_TRACE_SIZE];
+    // The writer fills the slot of the oldest entry, so drop any it reached.
+    head = traceHead;
+    uint32_t valid = (head >= RA8875_TRACE_SIZE) ? head - RA8875_TRACE_SIZE + 1 : 0;
+    if (valid > first) {
+        uint32_t drop = (valid - first < n) ? valid - first : n;
+        memmove(entries, entries + drop, (n - drop) * sizeof(TraceEntry_T));
+        n -= drop;
+    }
+    return n;
+}
+
+
+void RA8875::TraceReport(Serial & pc)
+{
+    const int maxApis = 32;
+    struct {
+        const char * api;
+        uint32_t transactions;
+        uint32_t bytes;
+        uint32_t usec;
+    } sum[maxApis];
+    int apis = 0;
+    TraceEntry_T * trace = (TraceEntry_T *)swMalloc(RA8875_TRACE_SIZE * sizeof(TraceEntry_T));
+
+    if (trace == NULL) {
+        pc.printf("Trace report - not enough RAM\r\n");
+        return;
+    }
+    uint32_t n = TraceRead(trace, RA8875_TRACE_SIZE);
+    for (uint32_t i=0; i<n; i++) {
+        int a;
+        for (a=0; a<apis && sum[a].api != trace[i].api; a++)
+            ;
+        if (a == apis) {
+            if (apis == maxApis)
+                continue;           // not enough room to report it
+            sum[a].api = trace[i].api;
+            sum[a].transactions = sum[a].bytes = sum[a].usec = 0;
+            apis++;
+        }
+        sum[a].transactions++;
+        sum[a].bytes += trace[i].bytes;
+        sum[a].usec += trace[i].duration;
+    }
+    pc.printf("\r\nSPI Trace of %d transactions over %d uS\r\n", n,
+        (n) ? trace[n-1].usec + trace[n-1].duration - trace[0].usec : 0);
+    for (int a=0; a<apis; a++) {
+        pc.printf("%10d uS %8d bytes %6d transactions %s\r\n", sum[a].usec, sum[a].bytes,
+            sum[a].transactions, (sum[a].api) ? sum[a].api : "(none)");
+    }
+    swFree(trace);
+}
+
+
+void RA8875::TraceDump(Serial & pc)
+{
+    TraceEntry_T * trace = (TraceEntry_T *)swMalloc(RA8875_TRACE_SIZE * sizeof(TraceEntry_T));
+
+    if (trace == NULL) {
+        pc.printf("Trace dump - not enough RAM\r\n");
+        return;
     }
+    uint32_t n = TraceRead(trace, RA8875_TRACE_SIZE);
+    pc.printf("usec,api,type,reg,bytes,duration_us\r\n");
+    for (uint32_t i=0; i<n; i++) {
+        const char * type;
+
+        switch (trace[i].type) {
+            case 0x80: type = "cmd"; break;
+            case 0x00: type = "write"; break;
+            case 0x40: type = "read"; break;
+            case 0xC0: type = "status"; break;
+            default:   type = "none"; break;
+        }
+        pc.printf("%u,%s,%s,%02X,%u,%u\r\n", trace[i].usec, (trace[i].api) ? trace[i].api : "",
+            type, trace[i].reg, trace[i].bytes, trace[i].duration);
+    }
+    swFree(trace);
 }
 #endif
 
@@ -729,24 +1211,30 @@ RetCode_t RA8875::WriteCommandW(uint8_t command, uint16_t data)
 
 RetCode_t RA8875::WriteCommand(unsigned char command, unsigned int data)
 {
-#ifdef PERF_METRICS
-    if (commandsUsed[command] < 65535)
-        commandsUsed[command]++;
-#endif
+    COUNTCOMMAND(command);
+    if (data <= 0xFF && _shadowHas(command) && regShadow[command] == data) {
+        COUNTSAVED(command);
+        return noerror;         // the controller already has this value
+    }
+    if (spiBlockCount)
+        _flushPixelBlock();     // keep staged pixels ahead of the command
     _select(true);
     _spiwrite(0x80);            // RS:1 (Cmd/Status), RW:0 (Write)
     _spiwrite(command);
     if (data <= 0xFF) {   // only if in the valid range
         _spiwrite(0x00);
         _spiwrite(data);
+        _shadowStore(command, data);
     }
     _select(false);
+    regSelected = command;
     return noerror;
 }
 
 
 RetCode_t RA8875::WriteDataW(uint16_t data)
 {
+    _shadowForget(regSelected);
     _select(true);
     _spiwrite(0x00);            // RS:0 (Data), RW:0 (Write)
     _spiwrite(data & 0xFF);
@@ -762,12 +1250,18 @@ RetCode_t RA8875::WriteData(unsigned char data)
     _spiwrite(0x00);            // RS:0 (Data), RW:0 (Write)
     _spiwrite(data);
     _select(false);
+    _shadowStore(regSelected, data);
     return noerror;
 }
 
 
 unsigned char RA8875::ReadCommand(unsigned char command)
 {
+    if (_shadowHas(command)) {
+        COUNTCOMMAND(command);
+        COUNTSAVED(command);
+        return regShadow[command];
+    }
     WriteCommand(command);
     return ReadData();
 }
@@ -782,10 +1276,8 @@ unsigned char RA8875::ReadData(void)
 {
     unsigned char data;
 
-    _select(true);
-    _spiwrite(0x40);            // RS:0 (Data), RW:1 (Read)
-    data = _spiread();
-    _select(false);
+    data = _spiReadCycle(0x40); // RS:0 (Data), RW:1 (Read)
+    _shadowStore(regSelected, data);
     return data;
 }
 
@@ -805,13 +1297,7 @@ uint16_t RA8875::ReadDataW(void)
 
 unsigned char RA8875::ReadStatus(void)
 {
-    unsigned char data;
-
-    _select(true);
-    _spiwrite(0xC0);            // RS:1 (Cmd/Status), RW:1 (Read) (Read STSR)
-    data = _spiread();
-    _select(false);
-    return data;
+    return _spiReadCycle(0xC0); // RS:1 (Cmd/Status), RW:1 (Read) (Read STSR)
 }
 
 
@@ -820,7 +1306,15 @@ unsigned char RA8875::ReadStatus(void)
 bool RA8875::_WaitWhileBusy(uint8_t mask)
 {
     int i = 20000/POLLWAITuSec; // 20 msec max
+    RetCode_t r = noerror;
 
+    if (m_intPin && (mask & 0x40))
+        r = _WaitForPin(m_intPin, 0, COMPLETION_INT, status_wait);     // BTE complete interrupt
+    else if (m_waitPin)
+        r = _WaitForPin(m_waitPin, 1, COMPLETION_WAIT, status_wait);
+    if (r == external_abort)
+        return false;
+    _setWriteSpeed(false);      // each poll is made at the read speed, see _spiReadCycle
     while (i-- && ReadStatus() & mask) {
         wait_us(POLLWAITuSec);
         COUNTIDLETIME(POLLWAITuSec);
@@ -830,6 +1324,8 @@ bool RA8875::_WaitWhileBusy(uint8_t mask)
             }
         }
     }
+    if (m_intPin && (mask & 0x40))
+        WriteCommand(INTC2, RA8875_INT_BTE);    // clear it, which releases the INT pin
     if (i)
         return true;
     else
@@ -843,7 +1339,12 @@ bool RA8875::_WaitWhileReg(uint8_t reg, uint8_t mask)
 {
     int i = 20000/POLLWAITuSec; // 20 msec max
 
-    while (i-- && ReadCommand(reg) & mask) {
+    if (m_waitPin && _WaitForPin(m_waitPin, 1, COMPLETION_WAIT, command_wait) == external_abort)
+        return false;
+    if (regSelected != reg)
+        WriteCommand(reg);      // select it once, so each poll is a data read alone
+    _setWriteSpeed(false);      // at the read speed, see _spiReadCycle
+    while (i-- && ReadData() & mask) {
         wait_us(POLLWAITuSec);
         COUNTIDLETIME(POLLWAITuSec);
         if (idle_callback) {
@@ -858,74 +1359,267 @@ bool RA8875::_WaitWhileReg(uint8_t reg, uint8_t mask)
         return false;
 }
 
-// RRRR RGGG GGGB BBBB
-// 4321 0543 2104 3210
-//           RRRG GGBB
-//           2102 1010
-uint8_t RA8875::_cvt16to8(color_t c16)
-{
-    return ((c16 >> 8) & 0xE0)
-        | ((c16 >> 6) & 0x1C)
-        | ((c16 >> 3) & 0x03);
-}
 
-//           RRRG GGBB
-//           2102 1010
-// RRRR RGGG GGGB BBBB
-// 2101 0543 2104 3210
-color_t RA8875::_cvt8to16(uint8_t c8)
+RetCode_t RA8875::CompletionInterruptInit(PinName intPin, PinName waitPin)
 {
-    color_t c16;
-    color_t temp = (color_t)c8;
-    
-    c16 = ((temp & 0xE0) << 8)
-        | ((temp & 0xC0) << 5)
-        | ((temp & 0x1C) << 6)
-        | ((temp & 0x1C) << 3)
-        | ((temp & 0x03) << 3)
-        | ((temp & 0x03) << 1)
-        | ((temp & 0x03) >> 1);
-    c16 = (c16 << 8) | (c16 >> 8);
-    return c16;
-}
+    uint8_t intc1;
 
-RetCode_t RA8875::_writeColorTrio(uint8_t regAddr, color_t color)
-{
-    RetCode_t rt = noerror;
-    
-    if (screenbpp == 16) {
-        WriteCommand(regAddr+0, (color>>11));                  // BGCR0
-        WriteCommand(regAddr+1, (unsigned char)(color>>5));    // BGCR1
-        rt = WriteCommand(regAddr+2, (unsigned char)(color));       // BGCR2
-    } else {
-        uint8_t r, g, b;
-        
-        // RRRR RGGG GGGB BBBB      RGB
-        // RRR   GGG    B B
-        r = (uint8_t)((color) >> 13);
-        g = (uint8_t)((color) >> 8);
-        b = (uint8_t)((color) >> 3);
-        WriteCommand(regAddr+0, r);  // BGCR0
-        WriteCommand(regAddr+1, g);  // BGCR1
-        rt = WriteCommand(regAddr+2, b);  // BGCR2
+    if (m_intPin) {
+        delete m_intPin;
+        m_intPin = NULL;
     }
-    return rt;
+    if (m_waitPin) {
+        delete m_waitPin;
+        m_waitPin = NULL;
+    }
+    intc1 = ReadCommand(INTC1) & ~RA8875_INT_BTE;
+    if (intPin != NC) {
+        m_intPin = new CompletionPin_T(intPin);
+        if (!m_intPin)
+            return not_enough_ram;
+        m_intPin->mode(PullUp);
+        #if defined(RA8875_RTOS_WAIT) || defined(RA8875_IRQ_WAIT)
+        m_intPin->fall(callback(this, &RA8875::_intPinISR));
+        #endif
+        WriteCommand(INTC2, RA8875_INT_BTE);    // discard any stale status
+        intc1 |= RA8875_INT_BTE;
+    }
+    WriteCommand(INTC1, intc1);
+    if (waitPin != NC) {
+        m_waitPin = new CompletionPin_T(waitPin);
+        if (!m_waitPin)
+            return not_enough_ram;
+        m_waitPin->mode(PullUp);
+        #if defined(RA8875_RTOS_WAIT) || defined(RA8875_IRQ_WAIT)
+        m_waitPin->rise(callback(this, &RA8875::_waitPinISR));
+        #endif
+    }
+    return noerror;
 }
 
-color_t RA8875::_readColorTrio(uint8_t regAddr)
+
+RetCode_t RA8875::_WaitForPin(CompletionPin_T * pin, int readyLevel, uint32_t flag, IdleReason_T reason)
 {
-    color_t color;
-    uint8_t r, g, b;
-    
-    r = ReadCommand(regAddr+0);
-    g = ReadCommand(regAddr+1);
-    b = ReadCommand(regAddr+2);
-    if (screenbpp == 16) {
-        // 000R RRRR 00GG GGGG 000B BBBB
-        // RRRR RGGG GGGB BBBB
-        color  = (r & 0x1F) << 11;
-        color |= (g & 0x3F) << 5;
-        color |= (b & 0x1F);
+#ifdef RA8875_RTOS_WAIT
+    (void)reason;
+    #ifdef PERF_METRICS
+    Timer t;
+    t.start();
+    #endif
+    completionFlags.clear(flag);        // before the pin is read, so the edge cannot be missed
+    if (pin->read() != readyLevel)
+        completionFlags.wait_any(flag, 20); // 20 msec max, then the polled wait takes over
+    #ifdef PERF_METRICS
+    COUNTIDLETIME(t.read_us());
+    #endif
+#else
+    int i = 20000/POLLWAITuSec; // 20 msec max
+
+    #ifdef RA8875_IRQ_WAIT
+    // Asleep, the idle callback would not be called, so then the pin is polled.
+    // The interrupts are masked from the check of the flags to the WFI, which
+    // a pending interrupt still ends, so an edge between them is not missed.
+    // sleep() is not used, as it ends the semihosting of the LocalFileSystem.
+    if (!idle_callback) {
+        #ifdef PERF_METRICS
+        Timer t;
+        t.start();
+        #endif
+        __disable_irq();
+        completionFlags &= ~(flag | COMPLETION_TIMEOUT);  // before the pin is read
+        __enable_irq();
+        if (pin->read() != readyLevel) {
+            completionTimeout.attach_us(callback(this, &RA8875::_pinTimeoutISR), 20000);
+            __disable_irq();
+            while (!(completionFlags & (flag | COMPLETION_TIMEOUT))) {
+                __WFI();
+                __enable_irq();         // the interrupt that woke it is taken here
+                __disable_irq();
+            }
+            __enable_irq();
+            completionTimeout.detach();
+        }
+        #ifdef PERF_METRICS
+        COUNTIDLETIME(t.read_us());
+        #endif
+        return noerror;
+    }
+    #endif
+    (void)flag;
+    while (i-- && pin->read() != readyLevel) {  // the pin, not the bus, is polled
+        wait_us(POLLWAITuSec);
+        COUNTIDLETIME(POLLWAITuSec);
+        if (idle_callback) {
+            if (external_abort == (*idle_callback)(reason, 0)) {
+                return external_abort;
+            }
+        }
+    }
+#endif
+    return noerror;
+}
+
+
+#ifdef RA8875_RTOS_WAIT
+void RA8875::_intPinISR(void)
+{
+    completionFlags.set(COMPLETION_INT);
+}
+
+
+void RA8875::_waitPinISR(void)
+{
+    completionFlags.set(COMPLETION_WAIT);
+}
+
+
+void RA8875::_vsyncPinISR(void)
+{
+    completionFlags.set(COMPLETION_VSYNC);
+}
+#endif
+
+
+#ifdef RA8875_IRQ_WAIT
+void RA8875::_intPinISR(void)
+{
+    completionFlags |= COMPLETION_INT;
+}
+
+
+void RA8875::_waitPinISR(void)
+{
+    completionFlags |= COMPLETION_WAIT;
+}
+
+
+void RA8875::_vsyncPinISR(void)
+{
+    completionFlags |= COMPLETION_VSYNC;
+}
+
+
+void RA8875::_pinTimeoutISR(void)
+{
+    completionFlags |= COMPLETION_TIMEOUT;
+}
+#endif
+
+
+RetCode_t RA8875::SetDeferredWait(bool defer)
+{
+    bool ok = _WaitDeferred();
+
+    deferWait = defer;
+    return (ok) ? noerror : external_abort;
+}
+
+
+bool RA8875::_WaitForEngine(uint8_t reg, uint8_t mask)
+{
+    if (deferWait) {
+        deferReg = reg;
+        deferMask = mask;
+        #ifdef PERF_METRICS
+        deferTimer.reset();
+        deferredWaits++;
+        #endif
+        return true;
+    }
+    return (reg) ? _WaitWhileReg(reg, mask) : _WaitWhileBusy(mask);
+}
+
+
+bool RA8875::_WaitDeferred(void)
+{
+    uint8_t mask = deferMask;
+    bool ok;
+
+    if (!mask)
+        return true;
+    deferMask = 0;              // first, since the wait itself selects the chip
+    #ifdef PERF_METRICS
+    unsigned long overlap = deferTimer.read_us();   // the engine may have finished well before
+    #endif
+    ok = (deferReg) ? _WaitWhileReg(deferReg, mask) : _WaitWhileBusy(mask);
+    #ifdef PERF_METRICS
+    deferredOverlap_usec += overlap;
+    deferredWait_usec += deferTimer.read_us() - overlap;
+    #endif
+    if (!ok)
+        deferFailed = true;
+    return ok;
+}
+
+
+// RRRR RGGG GGGB BBBB
+// 4321 0543 2104 3210
+//           RRRG GGBB
+//           2102 1010
+uint8_t RA8875::_cvt16to8(color_t c16)
+{
+    return ((c16 >> 8) & 0xE0)
+        | ((c16 >> 6) & 0x1C)
+        | ((c16 >> 3) & 0x03);
+}
+
+//           RRRG GGBB
+//           2102 1010
+// RRRR RGGG GGGB BBBB
+// 2101 0543 2104 3210
+color_t RA8875::_cvt8to16(uint8_t c8)
+{
+    color_t c16;
+    color_t temp = (color_t)c8;
+    
+    c16 = ((temp & 0xE0) << 8)
+        | ((temp & 0xC0) << 5)
+        | ((temp & 0x1C) << 6)
+        | ((temp & 0x1C) << 3)
+        | ((temp & 0x03) << 3)
+        | ((temp & 0x03) << 1)
+        | ((temp & 0x03) >> 1);
+    c16 = (c16 << 8) | (c16 >> 8);
+    return c16;
+}
+
+RetCode_t RA8875::_writeColorTrio(uint8_t regAddr, color_t color)
+{
+    RetCode_t rt = noerror;
+    
+    if (screenbpp == 16) {
+        WriteCommand(regAddr+0, (color>>11));                  // BGCR0
+        WriteCommand(regAddr+1, (unsigned char)(color>>5));    // BGCR1
+        rt = WriteCommand(regAddr+2, (unsigned char)(color));       // BGCR2
+    } else {
+        uint8_t r, g, b;
+        
+        // RRRR RGGG GGGB BBBB      RGB
+        // RRR   GGG    B B
+        r = (uint8_t)((color) >> 13);
+        g = (uint8_t)((color) >> 8);
+        b = (uint8_t)((color) >> 3);
+        WriteCommand(regAddr+0, r);  // BGCR0
+        WriteCommand(regAddr+1, g);  // BGCR1
+        rt = WriteCommand(regAddr+2, b);  // BGCR2
+    }
+    return rt;
+}
+
+color_t RA8875::_readColorTrio(uint8_t regAddr)
+{
+    color_t color;
+    uint8_t r, g, b;
+    
+    r = ReadCommand(regAddr+0);
+    g = ReadCommand(regAddr+1);
+    b = ReadCommand(regAddr+2);
+    if (screenbpp == 16) {
+        // 000R RRRR 00GG GGGG 000B BBBB
+        // RRRR RGGG GGGB BBBB
+        color  = (r & 0x1F) << 11;
+        color |= (g & 0x3F) << 5;
+        color |= (b & 0x1F);
     } else {
         // RRRG GGBB
         // RRRR RGGG GGGB BBBB
@@ -1003,9 +1697,11 @@ RetCode_t RA8875::SetTextCursor(point_t p)
 
 RetCode_t RA8875::SetTextCursor(loc_t x, loc_t y)
 {
+    TRACEAPI("SetTextCursor");
     INFO("SetTextCursor(%d, %d)", x, y);
     cursor_x = x;     // set these values for non-internal fonts
     cursor_y = y;
+    textCursorKnown = true;     // and the internal font follows them
     WriteCommandW(0x2A, x);
     WriteCommandW(0x2C, y);
     return noerror;
@@ -1024,7 +1720,7 @@ loc_t RA8875::GetTextCursor_Y(void)
 {
     loc_t y;
     
-    if (font == NULL)
+    if (font == NULL && !textCursorKnown)
         y = ReadCommand(0x2C) | (ReadCommand(0x2D) << 8);
     else
         y = cursor_y;
@@ -1037,7 +1733,7 @@ loc_t RA8875::GetTextCursor_X(void)
 {
     loc_t x;
     
-    if (font == NULL)
+    if (font == NULL && !textCursorKnown)
         x = ReadCommand(0x2A) | (ReadCommand(0x2B) << 8);
     else
         x = cursor_x;
@@ -1095,6 +1791,40 @@ RetCode_t RA8875::SetTextFont(RA8875::font_t font)
 }
 
 
+// The glyph is written as graphics data, with the memory write sent to
+// CGRAM (MWCR1 bits 3:2), at the character chosen by CGSR.
+RetCode_t RA8875::SetUserGlyph(uint8_t code, const uint8_t * glyph)
+{
+    uint8_t mwcr0 = ReadCommand(0x40);
+    uint8_t mwcr1 = ReadCommand(0x41);
+    uint8_t fncr0 = ReadCommand(0x21);
+
+    if (code == 0 || code == '\r' || code == '\n' || glyph == NULL)
+        return bad_parameter;
+    WriteCommand(0x21, fncr0 & ~0x80);              // FNCR0 - CGROM while CGRAM is written
+    WriteCommand(0x41, (mwcr1 & ~0x0C) | 0x04);     // MWCR1 - write to CGRAM
+    WriteCommand(0x23, code);                       // CGSR - the character
+    _StartGraphicsStream();
+    for (int row=0; row<16; row++)
+        _stageByte(glyph[row]);
+    _EndGraphicsStream();
+    if (!_WaitWhileBusy(0x80))
+        return external_abort;
+    WriteCommand(0x41, mwcr1);
+    WriteCommand(0x40, mwcr0);
+    WriteCommand(0x21, fncr0);
+    userGlyph[code >> 5] |= 1UL << (code & 0x1F);
+    return noerror;
+}
+
+
+RetCode_t RA8875::ClearUserGlyphs(void)
+{
+    memset(userGlyph, 0, sizeof(userGlyph));
+    return noerror;
+}
+
+
 RetCode_t RA8875::SetOrientation(RA8875::orientation_t angle)
 {
     uint8_t fncr1Val = ReadCommand(0x22);
@@ -1185,10 +1915,86 @@ RetCode_t RA8875::GetTextFontSize(RA8875::HorizontalScale * hScale, RA8875::Vert
     return noerror;
 }
 
+RetCode_t RA8875::SetTextScroll(RA8875::TextScroll_T mode)
+{
+    TRACEAPI("SetTextScroll");
+    dim_t lineHeight = fontheight();
+    dim_t lines = (windowrect.p2.y - windowrect.p1.y - 1) / lineHeight;
+
+    if (mode > HardwareScroll || (mode != NoScroll && lines < 2))
+        return bad_parameter;
+    if (mode == HardwareScroll) {
+        uint8_t ltpr0 = ReadCommand(0x52) & ~0xC0;  // both layers scroll
+
+        scrollWindow = windowrect;
+        scrollWindow.p2.y = windowrect.p1.y + lines * lineHeight - 1;
+        SPITransaction t(*this);
+        t.WriteCommandW(0x38, scrollWindow.p1.x);   // HSSW - scroll window
+        t.WriteCommandW(0x3A, scrollWindow.p1.y);   // VSSW
+        t.WriteCommandW(0x3C, scrollWindow.p2.x);   // HESW
+        t.WriteCommandW(0x3E, scrollWindow.p2.y);   // VESW
+        t.WriteCommandW(0x24, 0);                   // HOFS - no horizontal offset
+        t.WriteCommandW(0x26, 0);                   // VOFS - shown as it is drawn, until it rolls
+        t.WriteCommand(0x52, ltpr0);                // LTPR0
+    } else if (textScroll == HardwareScroll) {
+        WriteCommandW(0x26, 0);                     // VOFS - the window is no longer rolled
+    }
+    scrollRolled = false;
+    textScroll = mode;
+    return noerror;
+}
+
+
+loc_t RA8875::_TextLineFeed(loc_t y, dim_t lineHeight)
+{
+    loc_t x1 = windowrect.p1.x;
+    loc_t x2 = windowrect.p2.x;
+    color_t fg = _foreground;
+
+    y += lineHeight;
+    if (textScroll == MoveScroll) {
+        if (y + lineHeight >= windowrect.p2.y) {
+            // Move up by just enough for the line to fit, and clear what is exposed.
+            dim_t shift = y + lineHeight + 1 - windowrect.p2.y;
+            dim_t h = windowrect.p2.y - windowrect.p1.y + 1;
+            uint16_t layer = GetDrawingLayer();
+
+            if (shift < h) {
+                point_t src = { x1, (loc_t)(windowrect.p1.y + shift) };
+
+                BlockMove(layer, 0, windowrect.p1, layer, 0, src, x2 - x1 + 1, h - shift, 0x2, 0xC);
+            }
+            fillrect(x1, windowrect.p2.y - shift + 1, x2, windowrect.p2.y, _background);
+            foreground(fg);
+            y -= shift;
+        }
+    } else if (textScroll == HardwareScroll) {
+        dim_t h = scrollWindow.p2.y - scrollWindow.p1.y + 1;
+
+        if (y + lineHeight > scrollWindow.p2.y + 1) {
+            y = scrollWindow.p1.y;              // round the ring of lines
+            scrollRolled = true;
+        }
+        if (scrollRolled) {
+            // Roll the window so this line shows at the bottom, in place of
+            // the one it overwrites.
+            WriteCommandW(0x26, (y + lineHeight - scrollWindow.p1.y) % h);   // VOFS
+            fillrect(x1, y, x2, y + lineHeight - 1, _background);
+            foreground(fg);
+        }
+    }
+    return y;
+}
+
+
 int RA8875::_putc(int c)
 {
+    TRACEAPI("putc");
     if (font == NULL) {
-        return _internal_putc(c);
+        char ch = c;
+
+        _internal_write(&ch, 1);
+        return c;
     } else {
         return _external_putc(c);
     }
@@ -1199,8 +2005,8 @@ int RA8875::_putc(int c)
 // Questions to ponder -
 // - if we choose to wrap to the next line, because the character won't fit on the current line,
 //      should it erase the space to the width of the screen (in case there is leftover junk there)?
-// - it currently wraps from the bottom of the screen back to the top. I have pondered what
-//      it might take to scroll the screen - but haven't thought hard enough about it.
+// - it wraps from the bottom of the window back to the top, unless SetTextScroll has chosen
+//      to scroll it.
 //
 int RA8875::_external_putc(int c)
 {
@@ -1208,7 +2014,7 @@ int RA8875::_external_putc(int c)
         if (c == '\r') {
             cursor_x = windowrect.p1.x;
         } else if (c == '\n') {
-            cursor_y += extFontHeight;
+            cursor_y = _TextLineFeed(cursor_y, extFontHeight);
         } else {
             dim_t charWidth, charHeight;
             const uint8_t * charRecord;
@@ -1222,10 +2028,10 @@ int RA8875::_external_putc(int c)
                 //cursor_x += advance;
                 if (cursor_x + charWidth >= windowrect.p2.x) {
                     cursor_x = windowrect.p1.x;
-                    cursor_y += charHeight;
+                    cursor_y = _TextLineFeed(cursor_y, charHeight);
                 }
                 if (cursor_y + charHeight >= windowrect.p2.y) {
-                    cursor_y = windowrect.p1.y;               // @todo Should it scroll?
+                    cursor_y = windowrect.p1.y;               // wraps, unless SetTextScroll
                 }
                 (void)character(cursor_x, cursor_y, c);
                 cursor_x += charWidth * fontScaleX;
@@ -1236,8 +2042,11 @@ int RA8875::_external_putc(int c)
 }
 
 
+// Each character on its own, for when the controller moves the text cursor
+// in ways that _internal_write does not follow.
 int RA8875::_internal_putc(int c)
 {
+    textCursorKnown = false;
     if (c) {
         unsigned char mwcr0;
 
@@ -1252,16 +2061,27 @@ int RA8875::_internal_putc(int c)
         } else if (c == '\n') {
             loc_t y;
             y = ReadCommand(0x2C) | (ReadCommand(0x2D) << 8);   // current y location
-            y += fontheight();
-            if (y >= height())               // @TODO after bottom of active window, then scroll window?
-                y = 0;
+            if (textScroll == NoScroll) {
+                y += fontheight();
+                if (y >= height())
+                    y = 0;
+            } else {
+                y = _TextLineFeed(y, fontheight());
+                WriteCommand(0x40, 0x80 | mwcr0);   // Back to Text mode after any clear
+            }
             WriteCommandW(0x2C, y);
         } else {
+            bool user = _isUserGlyph(c);
+
+            if (user)
+                WriteCommand(0x21, ReadCommand(0x21) | 0x80);       // FNCR0 - from CGRAM
             WriteCommand(0x02);                 // RA8875 Internal Fonts
             _select(true);
             WriteData(c);
             _WaitWhileBusy(0x80);
             _select(false);
+            if (user)
+                WriteCommand(0x21, ReadCommand(0x21) & ~0x80);      // FNCR0 - from CGROM
         }
     }
     return c;
@@ -1278,19 +2098,21 @@ RetCode_t RA8875::_StartGraphicsStream(void)
 
 RetCode_t RA8875::_EndGraphicsStream(void)
 {
+    _flushPixelBlock();
     return noerror;
 }
 
 
 RetCode_t RA8875::_putp(color_t pixel)
 {
-    WriteDataW((pixel>>8) | (pixel<<8));
+    _stagePixel(pixel);
     return noerror;
 }
 
 
 void RA8875::puts(loc_t x, loc_t y, const char * string)
 {
+    TRACEAPI("puts");
     SetTextCursor(x,y);
     puts(string);
 }
@@ -1298,17 +2120,281 @@ void RA8875::puts(loc_t x, loc_t y, const char * string)
 
 void RA8875::puts(const char * string)
 {
+    TRACEAPI("puts");
     if (font == NULL) {
-        WriteCommand(0x40,0x80);    // Put in Text mode if internal font
+        _internal_write(string, strlen(string));
+        return;
+    }
+#ifndef RA8875_MCU_EXPANSION
+    _external_puts(string);
+#else
+    while (*string) {
+        _putc(*string++);
+    }
+#endif
+}
+
+
+int RA8875::printf(const char * format, ...)
+{
+    char buf[RA8875_PRINTF_BUFFER];
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len >= (int)sizeof(buf)) {
+        char * big = (char *)swMalloc(len + 1);
+
+        if (big) {
+            va_start(args, format);
+            vsnprintf(big, len + 1, format, args);
+            va_end(args);
+            puts(big);
+            swFree(big);
+            return len;
+        }
+        ERR("no RAM for %d characters, printed %d", len, (int)sizeof(buf) - 1);
+        len = sizeof(buf) - 1;
+    }
+    if (len > 0)
+        puts(buf);
+    return len;
+}
+
+
+// The characters are staged as data after one MRWC command, and the runs
+// only end where the cursor is moved, which is written then rather than
+// read back. The controller wraps at the right edge of the window, so the
+// wrap is made here first, to keep cursor_x and cursor_y true, and so that
+// it also scrolls. The glyphs of SetUserGlyph come from CGRAM, which FNCR0
+// selects for the whole font, so a run also ends where the font memory
+// changes.
+void RA8875::_internal_write(const char * string, int count)
+{
+    uint8_t fncr0 = ReadCommand(0x21) & ~0x80;
+    uint8_t fncr1 = ReadCommand(0x22);
+    dim_t charWidth = (((fncr1 >> 2) & 0x3) + 1) * 8;
+    dim_t charHeight = (((fncr1 >> 0) & 0x3) + 1) * 16;
+    uint8_t mwcr0;
+    bool streaming = false;     // the MRWC command is sent, and the characters follow
+    bool moved = false;         // the cursor is to be written before the next character
+    bool cgram = false;         // the characters are drawn from CGRAM
+    int burst = 0;
+
+    if (fncr1 & 0x90) {         // full alignment, or rotated
+        while (count--)
+            _internal_putc((unsigned char)*string++);
+        return;
+    }
+    if (!textCursorKnown) {
+        cursor_x = ReadCommand(0x2A) | (ReadCommand(0x2B) << 8);
+        cursor_y = ReadCommand(0x2C) | (ReadCommand(0x2D) << 8);
+        textCursorKnown = true;
     }
-    if (*string != '\0') {
-        while (*string) {           // @TODO calling individual _putc is slower... optimizations?
-            _putc(*string++);
+    mwcr0 = ReadCommand(0x40);
+    if ((mwcr0 & 0x80) == 0x00) {
+        WriteCommand(0x40, 0x80 | mwcr0);    // Put in Text mode if not already
+    }
+    while (count--) {
+        int c = (unsigned char)*string++;
+        bool wraps = cursor_x + charWidth > windowrect.p2.x + 1;
+
+        if (c == 0)
+            continue;
+        if (c == '\r' || c == '\n' || wraps) {
+            if (streaming) {
+                _flushPixelBlock();
+                _WaitWhileBusy(0x80);
+                streaming = false;
+            }
+            moved = true;
+        }
+        if (c == '\r') {
+            cursor_x = windowrect.p1.x;
+        } else if (c == '\n') {
+            _internal_linefeed(charHeight);
+        } else {
+            if (wraps) {
+                cursor_x = windowrect.p1.x;
+                _internal_linefeed(charHeight);
+            }
+            if (_isUserGlyph(c) != cgram) {
+                if (streaming) {
+                    _flushPixelBlock();
+                    _WaitWhileBusy(0x80);
+                    streaming = false;
+                }
+                cgram = !cgram;
+                WriteCommand(0x21, (cgram) ? fncr0 | 0x80 : fncr0);    // FNCR0 - CGRAM or CGROM
+            }
+            if (!streaming) {
+                if (moved) {
+                    WriteCommandW(0x2A, cursor_x);
+                    WriteCommandW(0x2C, cursor_y);
+                    moved = false;
+                }
+                WriteCommand(0x02);                 // RA8875 Internal Fonts
+                streaming = true;
+                burst = 0;
+            } else if (burst == RA8875_TEXT_BURST) {
+                _flushPixelBlock();
+                _WaitWhileBusy(0x80);               // until the memory write FIFO has room
+                burst = 0;
+            }
+            _stageByte(c);
+            burst++;
+            cursor_x += charWidth;
         }
     }
+    if (streaming) {
+        _flushPixelBlock();
+        _WaitWhileBusy(0x80);
+    } else if (moved) {
+        WriteCommandW(0x2A, cursor_x);
+        WriteCommandW(0x2C, cursor_y);
+    }
+    if (cgram)
+        WriteCommand(0x21, fncr0);
 }
 
 
+void RA8875::_internal_linefeed(dim_t lineHeight)
+{
+    if (textScroll == NoScroll) {
+        cursor_y += lineHeight;
+        if (cursor_y >= height())
+            cursor_y = 0;
+    } else {
+        cursor_y = _TextLineFeed(cursor_y, lineHeight);
+        WriteCommand(0x40, 0x80 | ReadCommand(0x40));  // Back to Text mode after any clear
+    }
+}
+
+
+#ifndef RA8875_MCU_EXPANSION
+// The glyphs of a string are gathered while they run along one line, with
+// the same placement and wrapping as _external_putc, and each run is drawn
+// with one color expansion over its bounding box, its rows made from the
+// rows of each glyph in turn.
+void RA8875::_external_puts(const char * string)
+{
+    const uint8_t * glyph[RA8875_TEXT_RUN];
+    dim_t glyphWidth[RA8875_TEXT_RUN];
+    int count = 0;
+    loc_t runX = 0;
+    loc_t runY = 0;
+    dim_t runHeight = 0;
+
+    while (*string) {
+        int c = (unsigned char)*string++;
+        bool lineEnd = (c == '\r' || c == '\n');
+        dim_t charWidth = 0;
+        dim_t charHeight = 0;
+        const uint8_t * charRecord = (lineEnd) ? NULL : getCharMetrics(c, &charWidth, &charHeight);
+        bool wraps = charRecord && cursor_x + charWidth >= windowrect.p2.x;
+
+        if (count && (lineEnd || wraps || count == RA8875_TEXT_RUN)) {
+            if (_external_run(runX, runY, runHeight, glyph, glyphWidth, count) != noerror)
+                return;
+            count = 0;
+        }
+        if (c == '\r') {
+            cursor_x = windowrect.p1.x;
+        } else if (c == '\n') {
+            cursor_y = _TextLineFeed(cursor_y, extFontHeight);
+        } else if (charRecord) {
+            if (wraps) {
+                cursor_x = windowrect.p1.x;
+                cursor_y = _TextLineFeed(cursor_y, charHeight);
+            }
+            if (cursor_y + charHeight >= windowrect.p2.y) {
+                if (count) {
+                    if (_external_run(runX, runY, runHeight, glyph, glyphWidth, count) != noerror)
+                        return;
+                    count = 0;
+                }
+                cursor_y = windowrect.p1.y;               // wraps, unless SetTextScroll
+            }
+            if (count == 0) {
+                runX = cursor_x;
+                runY = cursor_y;
+                runHeight = charHeight;
+            }
+            glyph[count] = charRecord;
+            glyphWidth[count++] = charWidth;
+            cursor_x += charWidth * fontScaleX;
+        }
+    }
+    if (count)
+        (void)_external_run(runX, runY, runHeight, glyph, glyphWidth, count);
+}
+
+
+// The glyphs of the run are pinned in the cache while it is sent, as
+// packing one may otherwise evict another that is still to be sent.
+RetCode_t RA8875::_external_run(loc_t x, loc_t y, dim_t h, const uint8_t ** glyph, const dim_t * glyphWidth, int count)
+{
+    const uint8_t * packed[RA8875_TEXT_RUN];
+    bool transparent = (ReadCommand(0x22) & 0x40) != 0;    // FNCR1 - NOFILL is transparent
+    dim_t w = 0;
+    uint16_t acc = 0;
+    int accBits = 0;
+
+    PERFORMANCE_RESET;
+    for (int g=0; g<count; g++) {
+        packed[g] = _PackedGlyph(glyph[g], glyphWidth[g], h, true, fontScaleX, fontScaleY, true);
+        w += glyphWidth[g] * fontScaleX;
+    }
+    _StartColorExpand(x, y, w, h * fontScaleY, transparent);  // and no register is read until it ends
+    for (int row=0; row<h * fontScaleY; row++) {
+        for (int g=0; g<count; g++) {
+            dim_t gw = glyphWidth[g] * fontScaleX;
+
+            if (packed[g]) {
+                const uint8_t * p = packed[g] + row * ((gw + 7) / 8);
+
+                for (int n=gw; n>0; n-=8)
+                    _appendBits(acc, accBits, *p++, (n < 8) ? n : 8);
+            } else {
+                const uint8_t * p = glyph[g] + (row / fontScaleY) * ((glyphWidth[g] + 7) / 8);
+
+                for (int i=0; i<glyphWidth[g]; i++) {
+                    for (int dx=0; dx<fontScaleX; dx++)
+                        _appendBits(acc, accBits, ((p[i >> 3] >> (i & 7)) & 1) << 7, 1);
+                }
+            }
+        }
+        if (accBits) {                          // each row of the run starts on a byte
+            _stageByte(acc << (8 - accBits));
+            acc = 0;
+            accBits = 0;
+        }
+    }
+    _EndGraphicsStream();
+    glyphCache.UnpinAll();
+    if (!_WaitForEngine(0, 0x40))
+        return external_abort;
+    REGISTERPERFORMANCE(PRF_BOOLSTREAM);
+    return noerror;
+}
+
+
+// Append the top n bits of b to the bits being staged.
+void RA8875::_appendBits(uint16_t & acc, int & accBits, uint8_t b, int n)
+{
+    acc = (acc << n) | (b >> (8 - n));
+    accBits += n;
+    if (accBits >= 8) {
+        accBits -= 8;
+        _stageByte(acc >> accBits);
+        acc &= (1 << accBits) - 1;
+    }
+}
+#endif
+
+
 RetCode_t RA8875::SetGraphicsCursor(loc_t x, loc_t y)
 {
     WriteCommandW(0x46, x);
@@ -1344,6 +2430,7 @@ RetCode_t RA8875::window(rect_t r)
 
 RetCode_t RA8875::window(loc_t x, loc_t y, dim_t width, dim_t height)
 {
+    TRACEAPI("window");
     INFO("window(%d,%d,%d,%d)", x, y, width, height);
     if (width == (dim_t)-1)
         width = screenwidth - x;
@@ -1366,6 +2453,7 @@ RetCode_t RA8875::window(loc_t x, loc_t y, dim_t width, dim_t height)
 
 RetCode_t RA8875::cls(uint16_t layers)
 {
+    TRACEAPI("cls");
     RetCode_t ret;
 
     PERFORMANCE_RESET;
@@ -1385,6 +2473,10 @@ RetCode_t RA8875::cls(uint16_t layers)
         }
         SelectDrawingLayer(prevLayer);
     }
+    if (textScroll == HardwareScroll) {
+        WriteCommandW(0x26, 0);     // VOFS - the text starts again at the top of the window
+        scrollRolled = false;
+    }
     ret = SetTextCursor(0,0);
     ret = locate(0,0);
     REGISTERPERFORMANCE(PRF_CLS);
@@ -1394,6 +2486,7 @@ RetCode_t RA8875::cls(uint16_t layers)
 
 RetCode_t RA8875::clsw(RA8875::Region_t region)
 {
+    TRACEAPI("clsw");
     PERFORMANCE_RESET;
     WriteCommand(0x8E, (region == ACTIVEWINDOW) ? 0xC0 : 0x80);
     if (!_WaitWhileReg(0x8E, 0x80)) {
@@ -1407,16 +2500,19 @@ RetCode_t RA8875::clsw(RA8875::Region_t region)
 
 RetCode_t RA8875::pixel(point_t p, color_t color)
 {
+    TRACEAPI("pixel");
     return pixel(p.x, p.y, color);
 }
 
 RetCode_t RA8875::pixel(point_t p)
 {
+    TRACEAPI("pixel");
     return pixel(p.x, p.y);
 }
 
 RetCode_t RA8875::pixel(loc_t x, loc_t y, color_t color)
 {
+    TRACEAPI("pixel");
     RetCode_t ret;
 
     PERFORMANCE_RESET;
@@ -1428,6 +2524,7 @@ RetCode_t RA8875::pixel(loc_t x, loc_t y, color_t color)
 
 RetCode_t RA8875::pixel(loc_t x, loc_t y)
 {
+    TRACEAPI("pixel");
     RetCode_t ret;
 
     PERFORMANCE_RESET;
@@ -1440,24 +2537,99 @@ RetCode_t RA8875::pixel(loc_t x, loc_t y)
 
 RetCode_t RA8875::pixelStream(color_t * p, uint32_t count, loc_t x, loc_t y)
 {
+    TRACEAPI("pixelStream");
     PERFORMANCE_RESET;
     SetGraphicsCursor(x, y);
     _StartGraphicsStream();
-    _select(true);
-    _spiwrite(0x00);         // Cmd: write data
     while (count--) {
+        _stagePixel(*p++);
+    }
+    _EndGraphicsStream();
+    REGISTERPERFORMANCE(PRF_PIXELSTREAM);
+    return(noerror);
+}
+
+
+RetCode_t RA8875::pixelStreamAsync(const color_t * p, uint32_t count, loc_t x, loc_t y)
+{
+    TRACEAPI("pixelStreamAsync");
+#ifdef RA8875_ASYNC_SPI
+    SetGraphicsCursor(x, y);
+    _StartGraphicsStream();
+    while (count) {
+        uint8_t * b = asyncBlock[asyncFill];
+        int n = 0;
+
+        b[n++] = 0x00;          // Cmd: write data
         if (screenbpp == 16) {
-            _spiwrite(*p >> 8);
-            _spiwrite(*p & 0xFF);
+            while (count && n < RA8875_ASYNC_BLOCKSIZE - 1) {
+                b[n++] = *p >> 8;
+                b[n++] = *p & 0xFF;
+                p++;
+                count--;
+            }
         } else {
-            _spiwrite(_cvt16to8(*p));
+            while (count && n < RA8875_ASYNC_BLOCKSIZE) {
+                b[n++] = _cvt16to8(*p++);
+                count--;
+            }
         }
-        p++;
+        _startAsyncBlock(n);    // the next buffer is filled while this one is sent
     }
-    _select(false);
     _EndGraphicsStream();
-    REGISTERPERFORMANCE(PRF_PIXELSTREAM);
-    return(noerror);
+    return noerror;
+#else
+    return pixelStream((color_t *)p, count, x, y);
+#endif
+}
+
+
+// The data write cycle byte is sent on its own, and then, in 16-bit frames,
+// the pixels, so that each goes from its top byte, in the same transaction.
+RetCode_t RA8875::pixelStreamInPlace(const color_t * p, uint32_t count, loc_t x, loc_t y)
+{
+    TRACEAPI("pixelStreamInPlace");
+#ifdef RA8875_ASYNC_SPI
+    if (screenbpp == 16 && count) {
+        const uint8_t cmd = 0x00;   // Cmd: write data
+
+        SetGraphicsCursor(x, y);
+        _StartGraphicsStream();
+        _EndGraphicsStream();
+        _select(true);              // waits for any stream before this
+        if (!spiWriteSpeed)
+            _setWriteSpeed(true);
+        bus.write(cmd);
+        TRACEBYTES(&cmd, 1);
+        bus.format(16, 3);
+        asyncFrames16 = true;
+        asyncBusy = true;
+        TRACEBYTES(NULL, count * 2);
+        if (bus.transfer16(p, count, callback(this, &RA8875::_asyncComplete)) != 0) {
+            WARN("SPI transfer refused, sending it the slow way");
+            asyncBusy = false;
+            _select(false);
+            return pixelStreamAsync(p, count, x, y);
+        }
+        return noerror;
+    }
+#endif
+    return pixelStreamAsync(p, count, x, y);
+}
+
+
+RetCode_t RA8875::flush(void)
+{
+    bool failed;
+
+#ifdef RA8875_ASYNC_SPI
+    if (!_WaitWhileAsync())
+        return external_abort;
+#endif
+    _WaitDeferred();
+    failed = deferFailed;
+    deferFailed = false;
+    return (failed) ? external_abort : noerror;
 }
 
 // With a font scale X = 1, a pixel stream is "abcdefg..."
@@ -1467,14 +2639,19 @@ RetCode_t RA8875::pixelStream(color_t * p, uint32_t count, loc_t x, loc_t y)
 //
 RetCode_t RA8875::booleanStream(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_t * boolStream) 
 {
+    TRACEAPI("booleanStream");
     PERFORMANCE_RESET;
+#ifndef RA8875_MCU_EXPANSION
+    RetCode_t ret = _colorExpand(x, y, w, h, boolStream, true, fontScaleX, fontScaleY,
+        (ReadCommand(0x22) & 0x40) != 0);   // FNCR1 - NOFILL is transparent; not cached
+    REGISTERPERFORMANCE(PRF_BOOLSTREAM);
+    return ret;
+#else
     const uint8_t * rowStream;
     rect_t restore = windowrect;
     window(x, y, w * fontScaleX, h * fontScaleY);       // Scale from font scale factors
     SetGraphicsCursor(x, y);
     _StartGraphicsStream();
-    _select(true);
-    _spiwrite(0x00);         // Cmd: write data
     while (h--) {
         for (int dy=0; dy<fontScaleY; dy++) {           // Vertical Font Scale Factor
             uint8_t pixels = w;
@@ -1486,12 +2663,7 @@ RetCode_t RA8875::booleanStream(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_
                 color_t c = (byte & bitmask) ? _foreground : _background;
                 
                 for (int dx=0; dx<fontScaleX; dx++) {   // Horizontal Font Scale Factor
-                    if (screenbpp == 16) {
-                        _spiwrite(c >> 8);
-                        _spiwrite(c & 0xFF);
-                    } else {
-                        _spiwrite(_cvt16to8(c));
-                    }
+                    _stagePixel(c);
                 }
                 bitmask <<= 1;
                 if (pixels > 1 && bitmask == 0) {
@@ -1503,15 +2675,180 @@ RetCode_t RA8875::booleanStream(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_
         }
         boolStream += (rowStream - boolStream + 1);
     }
-    _select(false);
     _EndGraphicsStream();
     window(restore);
     REGISTERPERFORMANCE(PRF_BOOLSTREAM);
     return(noerror);
+#endif
+}
+
+
+#ifndef RA8875_MCU_EXPANSION
+// The glyphs of the selected font are in flash, so, unlike the data given to
+// booleanStream, they can be kept in the glyph cache by their address.
+int RA8875::fontblit(loc_t x, loc_t y, const unsigned char c)
+{
+    const uint8_t * charRecord;
+    dim_t charWidth, charHeight;
+
+    charRecord = getCharMetrics(c, &charWidth, &charHeight);
+    if (charRecord) {
+        INFO("hgt:%d, wdt:%d", charHeight, charWidth);
+        PERFORMANCE_RESET;
+        _colorExpand(x, y, charWidth, charHeight, charRecord, true, fontScaleX, fontScaleY,
+            (ReadCommand(0x22) & 0x40) != 0, true);     // FNCR1 - NOFILL is transparent
+        REGISTERPERFORMANCE(PRF_BOOLSTREAM);
+        return charWidth * fontScaleX;
+    } else {
+        return 0;
+    }
+}
+#endif
+
+
+RetCode_t RA8875::SetGlyphCache(uint32_t bytes)
+{
+    glyphCache.SetBudget(bytes);
+    return noerror;
+}
+
+
+RetCode_t RA8875::MonoBitmap(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_t * bits,
+    color_t fg, color_t bg, fill_t fillit)
+{
+    TRACEAPI("MonoBitmap");
+    color_t prevFg = _foreground;
+    color_t prevBg = _background;
+    RetCode_t ret;
+
+    foreground(fg);
+    background(bg);
+    ret = _colorExpand(x, y, w, h, bits, false, 1, 1, fillit == NOFILL);
+    foreground(prevFg);
+    background(prevBg);
+    return ret;
+}
+
+
+// The BTE takes the data after a memory write command, and the bits of each
+// byte from the start bit (in the ROP field) down, and each row starts on a
+// byte. So the data is sent as it is, but for the bit order and the scale,
+// and what must be packed for those is kept in the glyph cache, for a font
+// glyph.
+RetCode_t RA8875::_colorExpand(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_t * bits,
+    bool lsbFirst, int scaleX, int scaleY, bool transparent, bool cached)
+{
+    int rowBytes = (w + 7) / 8;
+
+    if (w == 0 || h == 0)
+        return noerror;
+    _StartColorExpand(x, y, w * scaleX, h * scaleY, transparent);
+    if (!lsbFirst && scaleX == 1) {
+        for (int row=0; row<h; row++) {
+            for (int dy=0; dy<scaleY; dy++) {
+                for (int i=0; i<rowBytes; i++)
+                    _stageByte(bits[i]);
+            }
+            bits += rowBytes;
+        }
+    } else {
+        const uint8_t * packed = (cached) ? _PackedGlyph(bits, w, h, lsbFirst, scaleX, scaleY) : NULL;
+
+        if (packed) {
+            uint32_t size = (uint32_t)((w * scaleX + 7) / 8) * h * scaleY;
+
+            for (uint32_t i=0; i<size; i++)
+                _stageByte(packed[i]);
+        } else {
+            _packBits(bits, w, h, lsbFirst, scaleX, scaleY, NULL);
+        }
+    }
+    _EndGraphicsStream();
+    if (!_WaitForEngine(0, 0x40))
+        return external_abort;
+    return noerror;
+}
+
+
+void RA8875::_StartColorExpand(loc_t x, loc_t y, dim_t w, dim_t h, bool transparent)
+{
+    dim_t layer = GetDrawingLayer() & 1;    // read before the transaction is opened
+
+    {
+        SPITransaction t(*this);
+        t.WriteCommandW(0x58, x);
+        t.WriteCommandW(0x5A, (layer << 15) | y);
+        t.WriteCommandW(0x5C, w);
+        t.WriteCommandW(0x5E, h);
+        t.WriteCommand(0x51, 0x70 | ((transparent) ? 0x09 : 0x08));   // from bit 7, with or without transparency
+        t.WriteCommand(0x50, 0x80);     // enable the BTE
+    }
+    _StartGraphicsStream();
+}
+
+
+// The glyph packed for the color expansion, from the glyph cache, or packed
+// into it now; or NULL when the cache cannot hold it.
+const uint8_t * RA8875::_PackedGlyph(const uint8_t * bits, dim_t w, dim_t h, bool lsbFirst,
+    int scaleX, int scaleY, bool pin)
+{
+    GlyphKey_T key = { bits, w, h, (uint8_t)scaleX, (uint8_t)scaleY };
+    uint32_t size;
+    const uint8_t * packed = glyphCache.Find(key, &size, pin);
+
+    if (packed == NULL) {
+        uint8_t * fill = glyphCache.Insert(key, (uint32_t)((w * scaleX + 7) / 8) * h * scaleY, pin);
+
+        if (fill)
+            _packBits(bits, w, h, lsbFirst, scaleX, scaleY, fill);
+        packed = fill;
+    }
+    return packed;
+}
+
+
+// Pack 1-bpp data for the color expansion, from bit 7 down, with each pixel
+// and row repeated for the scale, into out, or staged when out is NULL.
+void RA8875::_packBits(const uint8_t * bits, dim_t w, dim_t h, bool lsbFirst, int scaleX, int scaleY,
+    uint8_t * out)
+{
+    int rowBytes = (w + 7) / 8;
+
+    for (int row=0; row<h; row++) {
+        for (int dy=0; dy<scaleY; dy++) {       // Vertical Font Scale Factor
+            uint8_t acc = 0;
+            int accBits = 0;
+
+            for (int i=0; i<w; i++) {
+                uint8_t bit = (lsbFirst) ? (bits[i >> 3] >> (i & 7)) & 1 : (bits[i >> 3] >> (7 - (i & 7))) & 1;
+
+                for (int dx=0; dx<scaleX; dx++) {   // Horizontal Font Scale Factor
+                    acc = (acc << 1) | bit;
+                    if (++accBits == 8) {
+                        if (out)
+                            *out++ = acc;
+                        else
+                            _stageByte(acc);
+                        acc = 0;
+                        accBits = 0;
+                    }
+                }
+            }
+            if (accBits) {
+                acc <<= 8 - accBits;
+                if (out)
+                    *out++ = acc;
+                else
+                    _stageByte(acc);
+            }
+        }
+        bits += rowBytes;
+    }
 }
 
 color_t RA8875::getPixel(loc_t x, loc_t y)
 {
+    TRACEAPI("getPixel");
     color_t pixel;
 
     PERFORMANCE_RESET;
@@ -1535,7 +2872,7 @@ color_t RA8875::getPixel(loc_t x, loc_t y)
 
 RetCode_t RA8875::getPixelStream(color_t * p, uint32_t count, loc_t x, loc_t y)
 {
-    color_t pixel;
+    TRACEAPI("getPixelStream");
     RetCode_t ret = noerror;
 
     PERFORMANCE_RESET;
@@ -1545,16 +2882,20 @@ RetCode_t RA8875::getPixelStream(color_t * p, uint32_t count, loc_t x, loc_t y)
     _select(true);
     _spiwrite(0x40);         // Cmd: read data
     _spiwrite(0x00);         // dummy read
-    if (screenbpp == 16)
+    if (screenbpp == 16) {
         _spiwrite(0x00);     // dummy read is only necessary when in 16-bit mode
-    while (count--) {
-        if (screenbpp == 16) {
-            pixel  = _spiread();
-            pixel |= (_spiread() << 8);
-        } else {
-            pixel = _cvt8to16(_spiread());
+        // The first byte read lands in the low byte of each pixel, which is
+        // the memory order of a color_t on this little-endian target.
+        _spireadBlock((uint8_t *)p, count * sizeof(color_t));
+    } else {
+        while (count) {
+            uint32_t n = min(count, (uint32_t)RA8875_SPI_BLOCKSIZE);
+            _spireadBlock(spiBlock, n);
+            for (uint32_t i=0; i<n; i++) {
+                *p++ = _cvt8to16(spiBlock[i]);
+            }
+            count -= n;
         }
-        *p++ = pixel;
     }
     _select(false);
     REGISTERPERFORMANCE(PRF_READPIXELSTREAM);
@@ -1576,6 +2917,7 @@ RetCode_t RA8875::line(point_t p1, point_t p2, color_t color)
 
 RetCode_t RA8875::line(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color)
 {
+    TRACEAPI("line");
     foreground(color);
     return line(x1,y1,x2,y2);
 }
@@ -1583,18 +2925,22 @@ RetCode_t RA8875::line(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color)
 
 RetCode_t RA8875::line(loc_t x1, loc_t y1, loc_t x2, loc_t y2)
 {
+    TRACEAPI("line");
     PERFORMANCE_RESET;
     if (x1 == x2 && y1 == y2) {
         pixel(x1, y1);
     } else {
-        WriteCommandW(0x91, x1);
-        WriteCommandW(0x93, y1);
-        WriteCommandW(0x95, x2);
-        WriteCommandW(0x97, y2);
-        unsigned char drawCmd = 0x00;       // Line
-        WriteCommand(0x90, drawCmd);
-        WriteCommand(0x90, 0x80 + drawCmd); // Start drawing.
-        if (!_WaitWhileReg(0x90, 0x80)) {
+        {
+            SPITransaction t(*this);
+            t.WriteCommandW(0x91, x1);
+            t.WriteCommandW(0x93, y1);
+            t.WriteCommandW(0x95, x2);
+            t.WriteCommandW(0x97, y2);
+            unsigned char drawCmd = 0x00;       // Line
+            t.WriteCommand(0x90, drawCmd);
+            t.WriteCommand(0x90, 0x80 + drawCmd); // Start drawing.
+        }
+        if (!_WaitForEngine(0x90, 0x80)) {
             REGISTERPERFORMANCE(PRF_DRAWLINE);
             return external_abort;
         }
@@ -1640,6 +2986,7 @@ RetCode_t RA8875::fillrect(rect_t r, color_t color, fill_t fillit)
 RetCode_t RA8875::fillrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
                            color_t color, fill_t fillit)
 {
+    TRACEAPI("fillrect");
     return rect(x1,y1,x2,y2,color,fillit);
 }
 
@@ -1651,6 +2998,7 @@ RetCode_t RA8875::rect(rect_t r, color_t color, fill_t fillit)
 RetCode_t RA8875::rect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
                        color_t color, fill_t fillit)
 {
+    TRACEAPI("rect");
     foreground(color);
     return rect(x1,y1,x2,y2,fillit);
 }
@@ -1658,6 +3006,7 @@ RetCode_t RA8875::rect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
 RetCode_t RA8875::rect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
                        fill_t fillit)
 {
+    TRACEAPI("rect");
     RetCode_t ret = noerror;
     PERFORMANCE_RESET;
     // check for bad_parameter
@@ -1672,16 +3021,19 @@ RetCode_t RA8875::rect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
         } else if (y1 == y2) {
             line(x1, y1, x2, y2);
         } else {
-            WriteCommandW(0x91, x1);
-            WriteCommandW(0x93, y1);
-            WriteCommandW(0x95, x2);
-            WriteCommandW(0x97, y2);
-            unsigned char drawCmd = 0x10;   // Rectangle
-            if (fillit == FILL)
-                drawCmd |= 0x20;
-            WriteCommand(0x90, drawCmd);
-            ret = WriteCommand(0x90, 0x80 + drawCmd); // Start drawing.
-            if (!_WaitWhileReg(0x90, 0x80)) {
+            {
+                SPITransaction t(*this);
+                t.WriteCommandW(0x91, x1);
+                t.WriteCommandW(0x93, y1);
+                t.WriteCommandW(0x95, x2);
+                t.WriteCommandW(0x97, y2);
+                unsigned char drawCmd = 0x10;   // Rectangle
+                if (fillit == FILL)
+                    drawCmd |= 0x20;
+                t.WriteCommand(0x90, drawCmd);
+                t.WriteCommand(0x90, 0x80 + drawCmd); // Start drawing.
+            }
+            if (!_WaitForEngine(0x90, 0x80)) {
                 REGISTERPERFORMANCE(PRF_DRAWRECTANGLE);
                 return external_abort;
             }
@@ -1704,6 +3056,7 @@ RetCode_t RA8875::fillroundrect(rect_t r, dim_t radius1, dim_t radius2, color_t
 RetCode_t RA8875::fillroundrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
                                 dim_t radius1, dim_t radius2, color_t color, fill_t fillit)
 {
+    TRACEAPI("fillroundrect");
     foreground(color);
     return roundrect(x1,y1,x2,y2,radius1,radius2,fillit);
 }
@@ -1716,6 +3069,7 @@ RetCode_t RA8875::roundrect(rect_t r, dim_t radius1, dim_t radius2, color_t colo
 RetCode_t RA8875::roundrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
                             dim_t radius1, dim_t radius2, color_t color, fill_t fillit)
 {
+    TRACEAPI("roundrect");
     foreground(color);
     return roundrect(x1,y1,x2,y2,radius1,radius2,fillit);
 }
@@ -1724,6 +3078,7 @@ RetCode_t RA8875::roundrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
 RetCode_t RA8875::roundrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
                             dim_t radius1, dim_t radius2, fill_t fillit)
 {
+    TRACEAPI("roundrect");
     RetCode_t ret = noerror;
 
     PERFORMANCE_RESET;
@@ -1739,21 +3094,24 @@ RetCode_t RA8875::roundrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
     } else if (y1 == y2) {
         line(x1, y1, x2, y2);
     } else {
-        WriteCommandW(0x91, x1);
-        WriteCommandW(0x93, y1);
-        WriteCommandW(0x95, x2);
-        WriteCommandW(0x97, y2);
-        WriteCommandW(0xA1, radius1);
-        WriteCommandW(0xA3, radius2);
-        // Should not need this...
-        WriteCommandW(0xA5, 0);
-        WriteCommandW(0xA7, 0);
-        unsigned char drawCmd = 0x20;       // Rounded Rectangle
-        if (fillit == FILL)
-            drawCmd |= 0x40;
-        WriteCommand(0xA0, drawCmd);
-        WriteCommand(0xA0, 0x80 + drawCmd); // Start drawing.
-        if (!_WaitWhileReg(0xA0, 0x80)) {
+        {
+            SPITransaction t(*this);
+            t.WriteCommandW(0x91, x1);
+            t.WriteCommandW(0x93, y1);
+            t.WriteCommandW(0x95, x2);
+            t.WriteCommandW(0x97, y2);
+            t.WriteCommandW(0xA1, radius1);
+            t.WriteCommandW(0xA3, radius2);
+            // Should not need this...
+            t.WriteCommandW(0xA5, 0);
+            t.WriteCommandW(0xA7, 0);
+            unsigned char drawCmd = 0x20;       // Rounded Rectangle
+            if (fillit == FILL)
+                drawCmd |= 0x40;
+            t.WriteCommand(0xA0, drawCmd);
+            t.WriteCommand(0xA0, 0x80 + drawCmd); // Start drawing.
+        }
+        if (!_WaitForEngine(0xA0, 0x80)) {
             REGISTERPERFORMANCE(PRF_DRAWROUNDEDRECTANGLE);
             return external_abort;
         }
@@ -1770,6 +3128,7 @@ RetCode_t RA8875::roundrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
 RetCode_t RA8875::triangle(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
                            loc_t x3, loc_t y3, color_t color, fill_t fillit)
 {
+    TRACEAPI("triangle");
     RetCode_t ret;
 
     if (x1 < 0 || x1 >= screenwidth || x2 < 0 || x2 >= screenwidth || x3 < 0 || x3 >= screenwidth
@@ -1784,6 +3143,7 @@ RetCode_t RA8875::triangle(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
 RetCode_t RA8875::filltriangle(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
                                loc_t x3, loc_t y3, color_t color, fill_t fillit)
 {
+    TRACEAPI("filltriangle");
     RetCode_t ret;
 
     foreground(color);
@@ -1795,24 +3155,28 @@ RetCode_t RA8875::filltriangle(loc_t x1, loc_t y1, loc_t x2, loc_t y2,
 RetCode_t RA8875::triangle(loc_t x1, loc_t y1 ,loc_t x2, loc_t y2,
                            loc_t x3, loc_t y3, fill_t fillit)
 {
+    TRACEAPI("triangle");
     RetCode_t ret = noerror;
 
     PERFORMANCE_RESET;
     if (x1 == x2 && y1 == y2 && x1 == x3 && y1 == y3) {
         pixel(x1, y1);
     } else {
-        WriteCommandW(0x91, x1);
-        WriteCommandW(0x93, y1);
-        WriteCommandW(0x95, x2);
-        WriteCommandW(0x97, y2);
-        WriteCommandW(0xA9, x3);
-        WriteCommandW(0xAB, y3);
-        unsigned char drawCmd = 0x01;       // Triangle
-        if (fillit == FILL)
-            drawCmd |= 0x20;
-        WriteCommand(0x90, drawCmd);
-        WriteCommand(0x90, 0x80 + drawCmd); // Start drawing.
-        if (!_WaitWhileReg(0x90, 0x80)) {
+        {
+            SPITransaction t(*this);
+            t.WriteCommandW(0x91, x1);
+            t.WriteCommandW(0x93, y1);
+            t.WriteCommandW(0x95, x2);
+            t.WriteCommandW(0x97, y2);
+            t.WriteCommandW(0xA9, x3);
+            t.WriteCommandW(0xAB, y3);
+            unsigned char drawCmd = 0x01;       // Triangle
+            if (fillit == FILL)
+                drawCmd |= 0x20;
+            t.WriteCommand(0x90, drawCmd);
+            t.WriteCommand(0x90, 0x80 + drawCmd); // Start drawing.
+        }
+        if (!_WaitForEngine(0x90, 0x80)) {
             REGISTERPERFORMANCE(PRF_DRAWTRIANGLE);
             return external_abort;
         }
@@ -1847,6 +3211,7 @@ RetCode_t RA8875::circle(point_t p, dim_t radius, fill_t fillit)
 RetCode_t RA8875::circle(loc_t x, loc_t y, dim_t radius,
                          color_t color, fill_t fillit)
 {
+    TRACEAPI("circle");
     foreground(color);
     return circle(x,y,radius,fillit);
 }
@@ -1855,6 +3220,7 @@ RetCode_t RA8875::circle(loc_t x, loc_t y, dim_t radius,
 RetCode_t RA8875::fillcircle(loc_t x, loc_t y, dim_t radius,
                              color_t color, fill_t fillit)
 {
+    TRACEAPI("fillcircle");
     foreground(color);
     return circle(x,y,radius,fillit);
 }
@@ -1862,6 +3228,7 @@ RetCode_t RA8875::fillcircle(loc_t x, loc_t y, dim_t radius,
 
 RetCode_t RA8875::circle(loc_t x, loc_t y, dim_t radius, fill_t fillit)
 {
+    TRACEAPI("circle");
     RetCode_t ret = noerror;
 
     PERFORMANCE_RESET;
@@ -1871,15 +3238,18 @@ RetCode_t RA8875::circle(loc_t x, loc_t y, dim_t radius, fill_t fillit)
     } else if (radius == 1) {
         pixel(x,y);
     } else {
-        WriteCommandW(0x99, x);
-        WriteCommandW(0x9B, y);
-        WriteCommand(0x9d, radius & 0xFF);
-        unsigned char drawCmd = 0x00;       // Circle
-        if (fillit == FILL)
-            drawCmd |= 0x20;
-        WriteCommand(0x90, drawCmd);
-        WriteCommand(0x90, 0x40 + drawCmd); // Start drawing.
-        if (!_WaitWhileReg(0x90, 0x40)) {
+        {
+            SPITransaction t(*this);
+            t.WriteCommandW(0x99, x);
+            t.WriteCommandW(0x9B, y);
+            t.WriteCommand(0x9d, radius & 0xFF);
+            unsigned char drawCmd = 0x00;       // Circle
+            if (fillit == FILL)
+                drawCmd |= 0x20;
+            t.WriteCommand(0x90, drawCmd);
+            t.WriteCommand(0x90, 0x40 + drawCmd); // Start drawing.
+        }
+        if (!_WaitForEngine(0x90, 0x40)) {
             REGISTERPERFORMANCE(PRF_DRAWCIRCLE);
             return external_abort;
         }
@@ -1891,6 +3261,7 @@ RetCode_t RA8875::circle(loc_t x, loc_t y, dim_t radius, fill_t fillit)
 
 RetCode_t RA8875::ellipse(loc_t x, loc_t y, dim_t radius1, dim_t radius2, color_t color, fill_t fillit)
 {
+    TRACEAPI("ellipse");
     foreground(color);
     return ellipse(x,y,radius1,radius2,fillit);
 }
@@ -1898,6 +3269,7 @@ RetCode_t RA8875::ellipse(loc_t x, loc_t y, dim_t radius1, dim_t radius2, color_
 
 RetCode_t RA8875::fillellipse(loc_t x, loc_t y, dim_t radius1, dim_t radius2, color_t color, fill_t fillit)
 {
+    TRACEAPI("fillellipse");
     foreground(color);
     return ellipse(x,y,radius1,radius2,fillit);
 }
@@ -1905,6 +3277,7 @@ RetCode_t RA8875::fillellipse(loc_t x, loc_t y, dim_t radius1, dim_t radius2, co
 
 RetCode_t RA8875::ellipse(loc_t x, loc_t y, dim_t radius1, dim_t radius2, fill_t fillit)
 {
+    TRACEAPI("ellipse");
     RetCode_t ret = noerror;
 
     PERFORMANCE_RESET;
@@ -1914,16 +3287,19 @@ RetCode_t RA8875::ellipse(loc_t x, loc_t y, dim_t radius1, dim_t radius2, fill_t
     } else if (radius1 == 1 && radius2 == 1) {
         pixel(x, y);
     } else {
-        WriteCommandW(0xA5, x);
-        WriteCommandW(0xA7, y);
-        WriteCommandW(0xA1, radius1);
-        WriteCommandW(0xA3, radius2);
-        unsigned char drawCmd = 0x00;   // Ellipse
-        if (fillit == FILL)
-            drawCmd |= 0x40;
-        WriteCommand(0xA0, drawCmd);
-        WriteCommand(0xA0, 0x80 + drawCmd); // Start drawing.
-        if (!_WaitWhileReg(0xA0, 0x80)) {
+        {
+            SPITransaction t(*this);
+            t.WriteCommandW(0xA5, x);
+            t.WriteCommandW(0xA7, y);
+            t.WriteCommandW(0xA1, radius1);
+            t.WriteCommandW(0xA3, radius2);
+            unsigned char drawCmd = 0x00;   // Ellipse
+            if (fillit == FILL)
+                drawCmd |= 0x40;
+            t.WriteCommand(0xA0, drawCmd);
+            t.WriteCommand(0xA0, 0x80 + drawCmd); // Start drawing.
+        }
+        if (!_WaitForEngine(0xA0, 0x80)) {
             REGISTERPERFORMANCE(PRF_DRAWELLIPSE);
             return external_abort;
         }
@@ -1940,24 +3316,25 @@ RetCode_t RA8875::frequency(unsigned long Hz, unsigned long Hz2)
         spireadfreq = Hz2;
     else
         spireadfreq = Hz/2;
+    spiActiveFreq = 0;          // force the port to be reprogrammed
     _setWriteSpeed(true);
     //       __   ___
     // Clock   ___A     Rising edge latched
     //       ___ ____
     // Data  ___X____
-    spi.format(8, 3);           // 8 bits and clock to data phase 0
+    bus.format(8, 3);           // 8 bits and clock to data phase 0
     return noerror;
 }
 
 void RA8875::_setWriteSpeed(bool writeSpeed)
 {
-    if (writeSpeed) {
-        spi.frequency(spiwritefreq);
-        spiWriteSpeed = true;
-    } else {
-        spi.frequency(spireadfreq);
-        spiWriteSpeed = false;
+    unsigned long hz = (writeSpeed) ? spiwritefreq : spireadfreq;
+
+    if (hz != spiActiveFreq) {  // reprogramming the port is costly, skip it when nothing changes
+        bus.frequency(hz);
+        spiActiveFreq = hz;
     }
+    spiWriteSpeed = writeSpeed;
 }
 
 
@@ -1967,6 +3344,7 @@ RetCode_t RA8875::BlockMove(uint8_t dstLayer, uint8_t dstDataSelect, point_t dst
     dim_t bte_width, dim_t bte_height,
     uint8_t bte_op_code, uint8_t bte_rop_code)
 {
+    TRACEAPI("BlockMove");
     uint8_t cmd;
 
     PERFORMANCE_RESET;
@@ -1975,16 +3353,19 @@ RetCode_t RA8875::BlockMove(uint8_t dstLayer, uint8_t dstDataSelect, point_t dst
     srcPoint.y &= 0x1FF;
     dstPoint.x &= 0x3FF;
     dstPoint.y &= 0x1FF;
-    WriteCommandW(0x54, srcPoint.x);
-    WriteCommandW(0x56, ((dim_t)(srcLayer & 1) << 15) | srcPoint.y);
-    WriteCommandW(0x58, dstPoint.x);
-    WriteCommandW(0x5A, ((dim_t)(dstLayer & 1) << 15) | dstPoint.y);
-    WriteCommandW(0x5C, bte_width);
-    WriteCommandW(0x5E, bte_height);
-    WriteCommand(0x51,  ((bte_rop_code & 0x0F) << 4) | (bte_op_code & 0x0F));
-    cmd = ((srcDataSelect & 1) << 6) | ((dstDataSelect & 1) << 5);
-    WriteCommand(0x50, 0x80 | cmd);     // enable the BTE
-    if (!_WaitWhileBusy(0x40)) {
+    {
+        SPITransaction t(*this);
+        t.WriteCommandW(0x54, srcPoint.x);
+        t.WriteCommandW(0x56, ((dim_t)(srcLayer & 1) << 15) | srcPoint.y);
+        t.WriteCommandW(0x58, dstPoint.x);
+        t.WriteCommandW(0x5A, ((dim_t)(dstLayer & 1) << 15) | dstPoint.y);
+        t.WriteCommandW(0x5C, bte_width);
+        t.WriteCommandW(0x5E, bte_height);
+        t.WriteCommand(0x51,  ((bte_rop_code & 0x0F) << 4) | (bte_op_code & 0x0F));
+        cmd = ((srcDataSelect & 1) << 6) | ((dstDataSelect & 1) << 5);
+        t.WriteCommand(0x50, 0x80 | cmd);   // enable the BTE
+    }
+    if (!_WaitForEngine(0, 0x40)) {
         REGISTERPERFORMANCE(PRF_BLOCKMOVE);
         return external_abort;
     }
@@ -2039,133 +3420,339 @@ RetCode_t RA8875::Backlight(float brightness)
 
 float RA8875::GetBacklight(void)
 {
-    return (float)(GetBacklight_u8())/255;
+    return (float)(GetBacklight_u8())/255;
+}
+
+RetCode_t RA8875::SelectUserFont(const uint8_t * _font)
+{
+    INFO("Cursor(%d,%d)  %p", cursor_x, cursor_y, _font);
+    INFO("Text C(%d,%d)", GetTextCursor_X(), GetTextCursor_Y());
+    if (_font) {
+        HexDump("Font Memory", _font, 16);
+        extFontHeight = _font[6];
+        uint32_t totalWidth = 0;
+        uint16_t firstChar = _font[3] * 256 + _font[2];
+        uint16_t lastChar  = _font[5] * 256 + _font[4];
+        uint16_t i;
+        
+        for (i=firstChar; i<=lastChar; i++) {
+            // 8 bytes of preamble to the first level lookup table
+            uint16_t offsetToCharLookup = 8 + 4 * (i - firstChar);    // 4-bytes: width(pixels), 16-bit offset from table start, 0
+            totalWidth += _font[offsetToCharLookup];
+        }
+        extFontWidth = totalWidth / (lastChar - firstChar);
+        INFO("Font Metrics: Avg W: %2d, H: %2d, First:%d, Last:%d", extFontWidth, extFontHeight, firstChar, lastChar);
+    }
+    SetTextCursor(GetTextCursor_X(), GetTextCursor_Y());  // soft-font cursor -> hw cursor
+    font = _font;
+    return GraphicsDisplay::SelectUserFont(_font);
+}
+
+RetCode_t RA8875::background(color_t color)
+{
+    GraphicsDisplay::background(color);
+    return _writeColorTrio(0x60, color);
+}
+
+
+RetCode_t RA8875::background(unsigned char r, unsigned char g, unsigned char b)
+{
+    background(RGB(r,g,b));
+    return noerror;
+}
+
+
+RetCode_t RA8875::foreground(color_t color)
+{
+    GraphicsDisplay::foreground(color);
+    return _writeColorTrio(0x63, color);
+}
+
+
+RetCode_t RA8875::foreground(unsigned char r, unsigned char g, unsigned char b)
+{
+    foreground(RGB(r,g,b));
+    return noerror;
+}
+
+
+color_t RA8875::GetForeColor(void)
+{
+    return _readColorTrio(0x63);
+}
+
+
+color_t RA8875::DOSColor(int i)
+{
+    const color_t colors[16] = {
+        Black,    Blue,       Green,       Cyan,
+        Red,      Magenta,    Brown,       Gray,
+        Charcoal, BrightBlue, BrightGreen, BrightCyan,
+        Orange,   Pink,       Yellow,      White
+    };
+    if (i >= 0 && i < 16)
+        return colors[i];
+    else
+        return 0;
+}
+
+
+const char * RA8875::DOSColorNames(int i)
+{
+    const char * names[16] = {
+        "Black",    "Blue",       "Green",       "Cyan",
+        "Red",      "Magenta",    "Brown",       "Gray",
+        "Charcoal", "BrightBlue", "BrightGreen", "BrightCyan",
+        "Orange",   "Pink",       "Yellow",      "White"
+    };
+    if (i >= 0 && i < 16)
+        return names[i];
+    else
+        return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////
+// Private functions
+
+unsigned char RA8875::_spiwrite(unsigned char data)
+{
+    unsigned char retval;
+
+    if (!spiWriteSpeed)
+        _setWriteSpeed(true);
+    TRACEBYTES(&data, 1);
+    retval = bus.write(data);
+    return retval;
+}
+
+
+unsigned char RA8875::_spiread(void)
+{
+    unsigned char retval;
+    unsigned char data = 0;
+
+    if (spiWriteSpeed)
+        _setWriteSpeed(false);
+    TRACEBYTES(NULL, 1);
+    retval = bus.write(data);
+    return retval;
+}
+
+
+unsigned char RA8875::_spiReadCycle(unsigned char cycle)
+{
+    unsigned char data;
+
+    _select(true);              // which may draw, so the speed is set after
+    if (spiWriteSpeed)
+        _setWriteSpeed(false);
+    TRACEBYTES(&cycle, 1);
+    bus.write(cycle);
+    TRACEBYTES(NULL, 1);
+    data = bus.write(0);
+    _select(false);
+    return data;
+}
+
+
+void RA8875::_spiwriteBlock(const uint8_t * data, int count)
+{
+    if (!spiWriteSpeed)
+        _setWriteSpeed(true);
+    TRACEBYTES(data, count);
+    bus.write((const char *)data, count, NULL, 0);
+}
+
+
+void RA8875::_spireadBlock(uint8_t * data, int count)
+{
+    if (spiWriteSpeed)
+        _setWriteSpeed(false);
+    TRACEBYTES(NULL, count);
+    bus.write(NULL, 0, (char *)data, count);   // the tx side is padded, which the RA8875 ignores
+}
+
+
+void RA8875::_stagePixel(color_t c)
+{
+    if (spiBlockCount == 0)
+        spiBlock[spiBlockCount++] = 0x00;       // Cmd: write data
+    if (screenbpp == 16) {
+        spiBlock[spiBlockCount++] = c >> 8;
+        spiBlock[spiBlockCount++] = c & 0xFF;
+    } else {
+        spiBlock[spiBlockCount++] = _cvt16to8(c);
+    }
+    if (spiBlockCount > RA8875_SPI_BLOCKSIZE - 2)
+        _flushPixelBlock();
+}
+
+
+void RA8875::_stageByte(uint8_t b)
+{
+    if (spiBlockCount == 0)
+        spiBlock[spiBlockCount++] = 0x00;       // Cmd: write data
+    spiBlock[spiBlockCount++] = b;
+    if (spiBlockCount > RA8875_SPI_BLOCKSIZE - 2)
+        _flushPixelBlock();
+}
+
+
+void RA8875::_flushPixelBlock(void)
+{
+    if (spiBlockCount) {
+        _select(true);
+        _spiwriteBlock(spiBlock, spiBlockCount);
+        _select(false);
+        spiBlockCount = 0;
+    }
+}
+
+
+void RA8875::_shadowClear(void)
+{
+    memset(regShadowValid, 0, sizeof(regShadowValid));
 }
 
-RetCode_t RA8875::SelectUserFont(const uint8_t * _font)
+
+void RA8875::_shadowStore(uint8_t reg, uint8_t data)
 {
-    INFO("Cursor(%d,%d)  %p", cursor_x, cursor_y, _font);
-    INFO("Text C(%d,%d)", GetTextCursor_X(), GetTextCursor_Y());
-    if (_font) {
-        HexDump("Font Memory", _font, 16);
-        extFontHeight = _font[6];
-        uint32_t totalWidth = 0;
-        uint16_t firstChar = _font[3] * 256 + _font[2];
-        uint16_t lastChar  = _font[5] * 256 + _font[4];
-        uint16_t i;
-        
-        for (i=firstChar; i<=lastChar; i++) {
-            // 8 bytes of preamble to the first level lookup table
-            uint16_t offsetToCharLookup = 8 + 4 * (i - firstChar);    // 4-bytes: width(pixels), 16-bit offset from table start, 0
-            totalWidth += _font[offsetToCharLookup];
-        }
-        extFontWidth = totalWidth / (lastChar - firstChar);
-        INFO("Font Metrics: Avg W: %2d, H: %2d, First:%d, Last:%d", extFontWidth, extFontHeight, firstChar, lastChar);
+    if (!IsVolatileRegister(reg)) {
+        regShadow[reg] = data;
+        regShadowValid[reg >> 5] |= (1UL << (reg & 0x1F));
     }
-    SetTextCursor(GetTextCursor_X(), GetTextCursor_Y());  // soft-font cursor -> hw cursor
-    font = _font;
-    return GraphicsDisplay::SelectUserFont(_font);
 }
 
-RetCode_t RA8875::background(color_t color)
+
+void RA8875::_shadowForget(uint8_t reg)
 {
-    GraphicsDisplay::background(color);
-    return _writeColorTrio(0x60, color);
+    regShadowValid[reg >> 5] &= ~(1UL << (reg & 0x1F));
 }
 
 
-RetCode_t RA8875::background(unsigned char r, unsigned char g, unsigned char b)
+RetCode_t RA8875::_select(bool chipsel)
 {
-    background(RGB(r,g,b));
+#ifdef RA8875_ASYNC_SPI
+    if (chipsel && asyncBusy)
+        _WaitWhileAsync();      // let a non-blocking stream finish first
+    if (chipsel && asyncFrames16) {
+        bus.format(8, 3);       // from the frames of pixelStreamInPlace, outside the interrupt
+        asyncFrames16 = false;
+    }
+#endif
+    if (chipsel && deferMask)
+        _WaitDeferred();        // and a deferred engine operation
+    bus.select(chipsel);
+    if (chipsel)
+        TRACEOPEN();
+    else
+        TRACECLOSE();
     return noerror;
 }
 
 
-RetCode_t RA8875::foreground(color_t color)
+RA8875::SPITransaction::SPITransaction(RA8875 & d) : display(d), count(0)
 {
-    GraphicsDisplay::foreground(color);
-    return _writeColorTrio(0x63, color);
+    if (display.spiBlockCount)
+        display._flushPixelBlock();     // keep staged pixels ahead of the transaction
+    if (display.deferMask)
+        display._WaitDeferred();        // since regSelected and the shadow change as writes are gathered
 }
 
 
-RetCode_t RA8875::foreground(unsigned char r, unsigned char g, unsigned char b)
+RA8875::SPITransaction::~SPITransaction()
 {
-    foreground(RGB(r,g,b));
-    return noerror;
+    Commit();
 }
 
 
-color_t RA8875::GetForeColor(void)
+void RA8875::SPITransaction::WriteCommand(uint8_t command, uint8_t data)
 {
-    return _readColorTrio(0x63);
+    COUNTCOMMAND(command);
+    if (display._shadowHas(command) && display.regShadow[command] == data) {
+        COUNTSAVED(command);
+        return;                         // the controller already has this value
+    }
+    if (count > RA8875_TRANSACTION_SIZE - 4)
+        Commit();
+    buf[count++] = 0x80;                // RS:1 (Cmd/Status), RW:0 (Write)
+    buf[count++] = command;
+    buf[count++] = 0x00;                // RS:0 (Data), RW:0 (Write)
+    buf[count++] = data;
+    display._shadowStore(command, data);
+    display.regSelected = command;
 }
 
 
-color_t RA8875::DOSColor(int i)
+void RA8875::SPITransaction::WriteCommandW(uint8_t command, uint16_t data)
 {
-    const color_t colors[16] = {
-        Black,    Blue,       Green,       Cyan,
-        Red,      Magenta,    Brown,       Gray,
-        Charcoal, BrightBlue, BrightGreen, BrightCyan,
-        Orange,   Pink,       Yellow,      White
-    };
-    if (i >= 0 && i < 16)
-        return colors[i];
-    else
-        return 0;
+    WriteCommand(command, data & 0xFF);
+    WriteCommand(command+1, data >> 8);
 }
 
 
-const char * RA8875::DOSColorNames(int i)
+void RA8875::SPITransaction::Commit(void)
 {
-    const char * names[16] = {
-        "Black",    "Blue",       "Green",       "Cyan",
-        "Red",      "Magenta",    "Brown",       "Gray",
-        "Charcoal", "BrightBlue", "BrightGreen", "BrightCyan",
-        "Orange",   "Pink",       "Yellow",      "White"
-    };
-    if (i >= 0 && i < 16)
-        return names[i];
-    else
-        return NULL;
+    // Each register write gets its own chip select, since the controller
+    // takes every byte after a data write cycle as more data.
+    for (int i=0; i<count; i+=4) {
+        display._select(true);
+        display._spiwriteBlock(buf + i, 4);
+        display._select(false);
+    }
+    count = 0;
 }
 
 
-///////////////////////////////////////////////////////////////
-// Private functions
-
-unsigned char RA8875::_spiwrite(unsigned char data)
+#ifdef RA8875_ASYNC_SPI
+void RA8875::_startAsyncBlock(int count)
 {
-    unsigned char retval;
+    uint8_t * b = asyncBlock[asyncFill];
 
+    _select(true);              // waits for the other buffer to drain
     if (!spiWriteSpeed)
         _setWriteSpeed(true);
-    retval = spi.write(data);
-    return retval;
+    asyncBusy = true;
+    TRACEBYTES(b, count);
+    if (bus.transfer(b, count, (uint8_t *)NULL, 0, callback(this, &RA8875::_asyncComplete)) != 0) {
+        WARN("SPI transfer refused, sending it the slow way");
+        asyncBusy = false;
+        bus.write((const char *)b, count, NULL, 0);
+        _select(false);
+    }
+    asyncFill ^= 1;
 }
 
 
-unsigned char RA8875::_spiread(void)
+void RA8875::_asyncComplete(int event)
 {
-    unsigned char retval;
-    unsigned char data = 0;
-
-    if (spiWriteSpeed)
-        _setWriteSpeed(false);
-    retval = spi.write(data);
-    return retval;
+    (void)event;
+    bus.select(false);          // _select(false), from the interrupt context
+    TRACECLOSE();
+    asyncBusy = false;
+    if (stream_callback)
+        (*stream_callback)();
 }
 
 
-RetCode_t RA8875::_select(bool chipsel)
+bool RA8875::_WaitWhileAsync(void)
 {
-    cs = (chipsel == true) ? 0 : 1;
-    return noerror;
+    while (asyncBusy) {
+        if (idle_callback) {
+            if (external_abort == (*idle_callback)(stream_wait, 0)) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
+#endif
 
 
 RetCode_t RA8875::PrintScreen(uint16_t layer, loc_t x, loc_t y, dim_t w, dim_t h, const char *Name_BMP)
 {
+    TRACEAPI("PrintScreen");
     (void)layer;
     
     // AttachPrintHandler(this, RA8875::_printCallback);
@@ -2209,6 +3796,7 @@ int RA8875::RoundUp(int value, int roundTo)
 
 RetCode_t RA8875::PrintScreen(loc_t x, loc_t y, dim_t w, dim_t h, uint8_t bitsPerPixel)
 {
+    TRACEAPI("PrintScreen");
     BITMAPFILEHEADER BMP_Header;
     BITMAPINFOHEADER BMP_Info;
     uint8_t * lineBuffer = NULL;
@@ -2420,6 +4008,7 @@ RetCode_t RA8875::PrintScreen(loc_t x, loc_t y, dim_t w, dim_t h, uint8_t bitsPe
 
 RetCode_t RA8875::PrintScreen(loc_t x, loc_t y, dim_t w, dim_t h, const char *Name_BMP, uint8_t bitsPerPixel)
 {
+    TRACEAPI("PrintScreen");
     BITMAPFILEHEADER BMP_Header;
     BITMAPINFOHEADER BMP_Info;
     uint8_t * lineBuffer = NULL;
@@ -2673,6 +4262,17 @@ void TextWrapTest(RA8875 & display, Serial & pc)
     }
     if (!SuppressSlowStuff)
         wait_ms(3000);
+    display.SetTextScroll(RA8875::MoveScroll);
+    display.cls();
+    display.puts("Text Scroll Test.\r\n");
+    for (int i=1; i<60; i++) {
+        display.printf("L%2d\r\n", i);
+        if (!SuppressSlowStuff)
+            wait_ms(100);
+    }
+    display.SetTextScroll(RA8875::NoScroll);
+    if (!SuppressSlowStuff)
+        wait_ms(3000);
 }
 
 
@@ -3051,8 +4651,8 @@ void LayerTest(RA8875 & display, Serial & pc)
         y1 = 50 + rand() % 200;
         x2 = x1 + rand() % 100;
         y2 = y1 + rand() % 100;
-        r1 = rand() % (x2 - x1)/2;
-        r2 = rand() % (y2 - y1)/2;
+        r1 = rand() % (x2 - x1 + 1)/2;     // x2 may equal x1
+        r2 = rand() % (y2 - y1 + 1)/2;
         display.roundrect(x1,y1, x2,y2, r1,r2, display.DOSColor(i));
         if (!SuppressSlowStuff)
             wait_ms(20);
@@ -3112,16 +4712,16 @@ void RoundRectTest(RA8875 & display, Serial & pc)
         y1 = 50 + rand() % 200;
         x2 = x1 + rand() % 100;
         y2 = y1 + rand() % 100;
-        r1 = rand() % (x2 - x1)/2;
-        r2 = rand() % (y2 - y1)/2;
+        r1 = rand() % (x2 - x1 + 1)/2;     // x2 may equal x1
+        r2 = rand() % (y2 - y1 + 1)/2;
         display.roundrect(x1,y1, x2,y2, 5,8, display.DOSColor(i));
 
         x1 = 240 + rand() % 240;
         y1 = 50 + rand() % 200;
         x2 = x1 + rand() % 100;
         y2 = y1 + rand() % 100;
-        r1 = rand() % (x2 - x1)/2;
-        r2 = rand() % (y2 - y1)/2;
+        r1 = rand() % (x2 - x1 + 1)/2;
+        r2 = rand() % (y2 - y1 + 1)/2;
         display.roundrect(x1,y1, x2,y2, r1,r2, FILL);
     }
 }
@@ -3353,6 +4953,304 @@ void SpeedTest(RA8875 & display, Serial & pc)
 }
 
 
+static void ReportStreamRate(Serial & pc, const char * name, uint32_t bytes, int usec)
+{
+    if (usec <= 0)
+        usec = 1;
+    pc.printf("  %-26s %8lu bytes %7d us %9lu bytes/s\r\n", name, bytes, usec,
+        (uint32_t)((uint64_t)bytes * 1000000 / usec));
+}
+
+
+void StreamSpeedTest(RA8875 & display, Serial & pc)
+{
+    Timer t;
+    const int lines = 32;                   // a band of the screen
+    const int loops = 5;
+    dim_t w = display.width();
+    uint32_t pixels = w * lines;
+    uint32_t bytes = loops * pixels * (display.color_bpp() / 8);
+
+    color_t * buf = (color_t *)swMalloc(pixels * sizeof(color_t));
+    if (buf == NULL) {
+        pc.printf("Stream Speed Test - not enough RAM\r\n");
+        return;
+    }
+    for (uint32_t i=0; i<pixels; i++)
+        buf[i] = RGB(i & 0xFF, (i >> 2) & 0xFF, (i >> 4) & 0xFF);
+    pc.printf("Stream Speed Test - %d x %d, %d bpp, %d loops\r\n", w, lines, display.color_bpp(), loops);
+    display.window();
+    display.cls();
+
+    t.start();
+    for (int n=0; n<loops; n++) {
+        for (uint32_t i=0; i<pixels; i++)
+            display.pixel(i % w, i / w, buf[i]);
+    }
+    ReportStreamRate(pc, "pixel, per pixel", bytes, t.read_us());
+
+    t.reset();
+    for (int n=0; n<loops; n++) {
+        for (int j=0; j<lines; j++)
+            display.pixelStream(buf + j * w, w, 0, j);
+    }
+    ReportStreamRate(pc, "pixelStream, per line", bytes, t.read_us());
+
+    t.reset();
+    for (int n=0; n<loops; n++)
+        display.pixelStream(buf, pixels, 0, 0);
+    ReportStreamRate(pc, "pixelStream, per band", bytes, t.read_us());
+
+    t.reset();
+    for (int n=0; n<loops; n++) {
+        for (int j=0; j<lines; j++)
+            display.pixelStreamAsync(buf + j * w, w, 0, j);
+    }
+    display.flush();
+    ReportStreamRate(pc, "pixelStreamAsync, per line", bytes, t.read_us());
+
+    t.reset();
+    for (int n=0; n<loops; n++) {
+        for (int j=0; j<lines; j++)
+            display.getPixelStream(buf + j * w, w, 0, j);
+    }
+    ReportStreamRate(pc, "getPixelStream, per line", bytes, t.read_us());
+    swFree(buf);
+}
+
+
+// The benchmark scenes. Each is a fixed piece of work, so that the results
+// of one build may be compared with the next.
+typedef enum {
+    BENCH_FILL,
+    BENCH_CLS,
+    BENCH_INTERNALTEXT,
+    BENCH_EXTERNALTEXT,
+    BENCH_CANVASTEXT,
+    BENCH_STRIPFRAME,
+    BENCH_PIXELBLIT,
+    BENCH_BLOCKMOVE,
+    BENCH_SPRITEMOVE,
+    BENCH_JPEG,
+    BENCH_GIF,
+    BENCH_PRINTSCREEN,
+    BENCH_TOUCH,
+    BENCH_COUNT
+} BenchScene_T;
+
+static const char * benchName[] = {
+    "fill", "cls", "internal_text", "external_text", "canvas_text", "strip_frame",
+    "pixel_blit", "block_move", "sprite_move", "jpeg_decode", "gif_decode", "print_screen", "touch_poll"
+};
+
+#define BENCH_BLITSIZE 64           // pixel_blit, block_move and sprite_move are this square
+static const char benchText[] = "The quick brown fox jumps over the lazy dog 0123456789";
+
+
+// PrintScreen sends the image here, so the time is the display read alone.
+static RetCode_t BenchPrintSink(RA8875::filecmd_t cmd, uint8_t * buffer, uint16_t size)
+{
+    (void)cmd;
+    (void)buffer;
+    (void)size;
+    return noerror;
+}
+
+
+// What a scene keeps from one iteration to the next, made by BenchSetup
+// before the first, and released by BenchTeardown after the last.
+typedef struct {
+    SpriteEngine * sprites;         ///< sprite_move engine, with the image loaded
+    int sprite;                     ///< sprite_move sprite
+    loc_t x;                        ///< sprite_move position
+} BenchState_T;
+
+
+// Make the state of a scene, so that each run of the suite starts the same.
+static RetCode_t BenchSetup(RA8875 & display, int scene, const color_t * image, BenchState_T * state)
+{
+    RetCode_t ret = noerror;
+
+    state->sprites = NULL;
+    state->sprite = 0;
+    state->x = 0;
+    if (scene == BENCH_SPRITEMOVE) {
+        rect_t store = { { 0, 0 }, { 2 * BENCH_BLITSIZE - 1, BENCH_BLITSIZE - 1 } };
+
+        state->sprites = new SpriteEngine(display, 1, store);
+        if (state->sprites == NULL)
+            return not_enough_ram;
+        ret = state->sprites->Load(image, BENCH_BLITSIZE, BENCH_BLITSIZE, Black, &state->sprite);
+    }
+    return ret;
+}
+
+
+static void BenchTeardown(BenchState_T * state)
+{
+    if (state->sprites) {
+        state->sprites->Clear();    // so the next scene is drawn without the sprite
+        delete state->sprites;
+        state->sprites = NULL;
+    }
+}
+
+
+// Run one iteration of a scene.
+static RetCode_t BenchScene(RA8875 & display, int scene, const color_t * image, const char * path,
+    BenchState_T * state)
+{
+    char name[80];
+    point_t src = { 0, 0 };
+    point_t dst = { BENCH_BLITSIZE, 0 };
+
+    switch (scene) {
+        case BENCH_FILL:
+            return display.fillrect(0,0, display.width()-1, display.height()-1, Blue);
+        case BENCH_CLS:
+            return display.cls();
+        case BENCH_INTERNALTEXT:
+            display.SelectUserFont();
+            display.puts(0,0, benchText);
+            return noerror;
+        case BENCH_EXTERNALTEXT:
+            display.SelectUserFont(BPG_Arial20x20);
+            display.puts(0,0, benchText);
+            display.SelectUserFont();
+            return noerror;
+        case BENCH_CANVASTEXT: {
+            Canvas canvas(display, display.width(), 48);    // the two lines of external_text
+
+            canvas.SelectUserFont(BPG_Arial20x20);
+            canvas.SetTextCursor(0,0);
+            canvas.puts(benchText);
+            return canvas.flush();
+        }
+        case BENCH_STRIPFRAME: {
+            StripRenderer frame(display);
+            loc_t w = display.width();
+            loc_t h = display.height();
+
+            frame.background(Blue);
+            frame.fillrect(10,10, w-11,h-11, DarkGray);
+            frame.blendrect(w/4,h/4, w*3/4,h*3/4, Yellow, 96);
+            frame.fillrect(w/4,h/4, w*3/4,h*3/4, White, NOFILL);
+            frame.pixels(20,20, BENCH_BLITSIZE,BENCH_BLITSIZE, image);
+            frame.text(20,h/2, benchText, BPG_Arial20x20, White, DarkGray);
+            return frame.Render();
+        }
+        case BENCH_PIXELBLIT:
+            return display.pixelStream((color_t *)image, BENCH_BLITSIZE * BENCH_BLITSIZE, 0, 0);
+        case BENCH_BLOCKMOVE:
+            return display.BlockMove(0, 0, dst, 0, 0, src, BENCH_BLITSIZE, BENCH_BLITSIZE, 0x2, 0xC);
+        case BENCH_SPRITEMOVE:          // loaded by BenchSetup, and moved back and forth
+            state->x = (state->x == BENCH_BLITSIZE) ? 2 * BENCH_BLITSIZE : BENCH_BLITSIZE;
+            return state->sprites->Show(state->sprite, state->x, BENCH_BLITSIZE);
+        case BENCH_JPEG:
+            snprintf(name, sizeof(name), "%s/bench.jpg", path);
+            return display.RenderJpegFile(0,0, name);
+        case BENCH_GIF:
+            snprintf(name, sizeof(name), "%s/bench.gif", path);
+            return display.RenderGIFFile(0,0, name);
+        case BENCH_PRINTSCREEN:
+            display.AttachPrintHandler(BenchPrintSink);
+            return display.PrintScreen(0,0, 100,100, 24);
+        case BENCH_TOUCH:
+            display.TouchPanelReadable();
+            return noerror;
+        default:
+            return bad_parameter;
+    }
+}
+
+
+static int BenchCompare(const void * a, const void * b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+void BenchmarkSuite(RA8875 & display, Serial & pc, int iterations, bool json, const char * path)
+{
+    Timer t;
+    uint32_t * usec = (uint32_t *)swMalloc(iterations * sizeof(uint32_t));
+    color_t * image = (color_t *)swMalloc(BENCH_BLITSIZE * BENCH_BLITSIZE * sizeof(color_t));
+
+    if (iterations <= 0 || usec == NULL || image == NULL) {
+        pc.printf("Benchmark - not enough RAM\r\n");
+        swFree(usec);
+        swFree(image);
+        return;
+    }
+    for (int i=0; i<BENCH_BLITSIZE * BENCH_BLITSIZE; i++)
+        image[i] = RGB(i & 0xFF, (i >> 2) & 0xFF, (i >> 4) & 0xFF);
+    display.window();
+    display.foreground(White);
+    display.background(Black);
+    if (json)
+        pc.printf("[\r\n");
+    else
+        pc.printf("scene,iterations,min_us,median_us,p99_us,bytes,transactions"
+        #ifdef RA8875_SIMULATED_SPI
+            ",predicted_us"
+        #endif
+            ",status\r\n");
+    t.start();
+    for (int scene=0; scene<BENCH_COUNT; scene++) {
+        BenchState_T state;
+        RetCode_t ret;
+        int n;
+
+        ret = BenchSetup(display, scene, image, &state);  // such as one layer at 800x480x16
+        if (ret != noerror)
+            usec[0] = 0;            // and no iteration is run
+        display.flush();            // the setup is not timed
+        uint32_t bytes = display.Bus().Bytes();
+        uint32_t transactions = display.Bus().Transactions();
+        #ifdef RA8875_SIMULATED_SPI
+        uint64_t predicted = display.Bus().PredictedTime_ns();
+        #endif
+        for (n=0; n<iterations && ret == noerror; n++) {
+            t.reset();
+            ret = BenchScene(display, scene, image, path, &state);
+            display.flush();        // include any non-blocking transfer in the time
+            usec[n] = t.read_us();
+        }
+        int runs = (n) ? n : 1;
+        bytes = (display.Bus().Bytes() - bytes) / runs;
+        transactions = (display.Bus().Transactions() - transactions) / runs;
+        qsort(usec, n, sizeof(uint32_t), BenchCompare);
+        int p99 = (runs * 99 + 99) / 100 - 1;  // nearest rank
+        if (json) {
+            pc.printf("  {\"scene\":\"%s\", \"iterations\":%d, \"min_us\":%u, \"median_us\":%u, "
+                "\"p99_us\":%u, \"bytes\":%u, \"transactions\":%u, ",
+                benchName[scene], n, usec[0], usec[n/2], usec[p99], bytes, transactions);
+            #ifdef RA8875_SIMULATED_SPI
+            pc.printf("\"predicted_us\":%u, ",
+                (uint32_t)((display.Bus().PredictedTime_ns() - predicted) / runs / 1000));
+            #endif
+            pc.printf("\"status\":%d}%s\r\n", ret, (scene < BENCH_COUNT - 1) ? "," : "");
+        } else {
+            pc.printf("%s,%d,%u,%u,%u,%u,%u,", benchName[scene], n, usec[0], usec[n/2], usec[p99],
+                bytes, transactions);
+            #ifdef RA8875_SIMULATED_SPI
+            pc.printf("%u,", (uint32_t)((display.Bus().PredictedTime_ns() - predicted) / runs / 1000));
+            #endif
+            pc.printf("%d\r\n", ret);
+        }
+        BenchTeardown(&state);
+    }
+    if (json)
+        pc.printf("]\r\n");
+    display.AttachPrintHandler();
+    swFree(usec);
+    swFree(image);
+}
+
+
 void PrintScreen(RA8875 & display, Serial & pc)
 {
     if (!SuppressSlowStuff)
@@ -3361,6 +5259,114 @@ void PrintScreen(RA8875 & display, Serial & pc)
 }
 
 
+// Run one test, by its key in the menu of RunTestSet.
+static void RunTest(RA8875 & lcd, Serial & pc, int q)
+{
+    switch(q) {
+#ifdef PERF_METRICS
+        case '0':
+            lcd.ClearPerformance();
+            break;
+        case '1':
+            lcd.ReportPerformance(pc);
+            break;
+#endif
+#ifdef RA8875_TRACE
+        case '2':
+            lcd.TraceEnable();
+            break;
+        case '3':
+            lcd.TraceReport(pc);
+            break;
+#endif
+#ifdef SPAN_TRACE
+        case '4':
+            SpanTrace::Enable();
+            break;
+        case '5':
+            SpanTrace::Dump(pc);
+            break;
+#endif
+        case 'B':
+            BacklightTest(lcd, pc, 2);
+            break;
+        case 'b':
+            BacklightTest2(lcd, pc);
+            break;
+        case 'D':
+            DOSColorTest(lcd, pc);
+            break;
+        case 'K':
+            KeyPadTest(lcd, pc);
+            break;
+        case 'W':
+            WebColorTest(lcd, pc);
+            break;
+        case 't':
+            TextCursorTest(lcd, pc);
+            break;
+        case 'w':
+            TextWrapTest(lcd, pc);
+            break;
+        case 'F':
+            ExternalFontTest(lcd, pc);
+            break;
+        case 'L':
+            LineTest(lcd, pc);
+            break;
+        case 'l':
+            LayerTest(lcd, pc);
+            break;
+        case 'R':
+            RectangleTest(lcd, pc);
+            break;
+        case 'O':
+            RoundRectTest(lcd, pc);
+            break;
+        case 'p':
+            PrintScreen(lcd, pc);
+            break;
+        case 'S':
+            SpeedTest(lcd, pc);
+            break;
+        case 'M':
+            StreamSpeedTest(lcd, pc);
+            break;
+        case 'X':
+            BenchmarkSuite(lcd, pc);
+            break;
+        case 's':
+            TouchPanelTest(lcd, pc);
+            break;
+        case 'T':
+            TriangleTest(lcd, pc);
+            break;
+        case 'P':
+            PixelTest(lcd, pc);
+            break;
+        case 'G':
+            TestGraphicsBitmap(lcd, pc);
+            break;
+        case 'C':
+            CircleTest(lcd, pc);
+            break;
+        case 'E':
+            EllipseTest(lcd, pc);
+            break;
+        case 'r':
+            pc.printf("Resetting ...\r\n");
+            wait_ms(20);
+            mbed_reset();
+            break;
+        case ' ':
+            break;
+        default:
+            printf("huh?\n");
+            break;
+    }
+}
+
+
 void RunTestSet(RA8875 & lcd, Serial & pc)
 {
     int q = 0;
@@ -3380,8 +5386,15 @@ void RunTestSet(RA8875 & lcd, Serial & pc)
                   "K - Keypad Test       s - touch screen test\r\n"
                   "p - print screen      r - reset  \r\n"
                   "l - layer test        w - wrapping text \r\n"
+                  "M - stream bandwidth  X - benchmark suite\r\n"
 #ifdef PERF_METRICS
                   "0 - clear performance 1 - report performance\r\n"
+#endif
+#ifdef RA8875_TRACE
+                  "2 - start SPI trace   3 - report SPI trace\r\n"
+#endif
+#ifdef SPAN_TRACE
+                  "4 - start span trace  5 - dump span trace\r\n"
 #endif
                   "> ");
         if (automode == -1 || pc.readable()) {
@@ -3392,89 +5405,10 @@ void RunTestSet(RA8875 & lcd, Serial & pc)
         } else if (automode >= 0) {
             q = modelist[automode];
         }
-        switch(q) {
-#ifdef PERF_METRICS
-            case '0':
-                lcd.ClearPerformance();
-                break;
-            case '1':
-                lcd.ReportPerformance(pc);
-                break;
-#endif
-            case 'A':
-                automode = 0;
-                break;
-            case 'B':
-                BacklightTest(lcd, pc, 2);
-                break;
-            case 'b':
-                BacklightTest2(lcd, pc);
-                break;
-            case 'D':
-                DOSColorTest(lcd, pc);
-                break;
-            case 'K':
-                KeyPadTest(lcd, pc);
-                break;
-            case 'W':
-                WebColorTest(lcd, pc);
-                break;
-            case 't':
-                TextCursorTest(lcd, pc);
-                break;
-            case 'w':
-                TextWrapTest(lcd, pc);
-                break;
-            case 'F':
-                ExternalFontTest(lcd, pc);
-                break;
-            case 'L':
-                LineTest(lcd, pc);
-                break;
-            case 'l':
-                LayerTest(lcd, pc);
-                break;
-            case 'R':
-                RectangleTest(lcd, pc);
-                break;
-            case 'O':
-                RoundRectTest(lcd, pc);
-                break;
-            case 'p':
-                PrintScreen(lcd, pc);
-                break;
-            case 'S':
-                SpeedTest(lcd, pc);
-                break;
-            case 's':
-                TouchPanelTest(lcd, pc);
-                break;
-            case 'T':
-                TriangleTest(lcd, pc);
-                break;
-            case 'P':
-                PixelTest(lcd, pc);
-                break;
-            case 'G':
-                TestGraphicsBitmap(lcd, pc);
-                break;
-            case 'C':
-                CircleTest(lcd, pc);
-                break;
-            case 'E':
-                EllipseTest(lcd, pc);
-                break;
-            case 'r':
-                pc.printf("Resetting ...\r\n");
-                wait_ms(20);
-                mbed_reset();
-                break;
-            case ' ':
-                break;
-            default:
-                printf("huh?\n");
-                break;
-        }
+        if (q == 'A')
+            automode = 0;
+        else
+            RunTest(lcd, pc, q);
         if (automode >= 0) {
             automode++;
             if (automode >= sizeof(modelist))
@@ -3485,4 +5419,43 @@ void RunTestSet(RA8875 & lcd, Serial & pc)
     }
 }
 
+
+#ifdef RA8875_SIMULATED_SPI
+RetCode_t RunHeadlessTestSet(RA8875 & lcd, RA8875_Emulator & emu, Serial & pc, const char * path,
+    HeadlessScene_T * results)
+{
+    const unsigned char modelist[HEADLESS_SCENES+1] = "DWtGLlFROTPCEw";     // the scenes that need no input
+    char name[200];
+    RetCode_t ret = noerror;
+    bool slow = SuppressSlowStuff;
+
+    SuppressSlowStuff = true;       // no pauses to watch the scenes
+
+    for (unsigned int i=0; i<HEADLESS_SCENES; i++) {
+        uint32_t bytes = emu.Bytes();
+        uint32_t transactions = emu.Transactions();
+        uint64_t predicted = emu.PredictedTime_ns();
+        HeadlessScene_T scene;
+
+        RunTest(lcd, pc, modelist[i]);
+        lcd.flush();
+        scene.scene = modelist[i];
+        scene.bytes = emu.Bytes() - bytes;
+        scene.transactions = emu.Transactions() - transactions;
+        scene.predicted_us = (uint32_t)((emu.PredictedTime_ns() - predicted) / 1000);
+        if (results)
+            results[i] = scene;
+        snprintf(name, sizeof(name), "%s/scene_%02d.ppm", path, i);
+        pc.printf("Scene %c: %u bytes in %u transactions, %u uS predicted, %s\r\n", scene.scene,
+            scene.bytes, scene.transactions, scene.predicted_us, name);
+        if (emu.DumpPPM(name) != noerror) {
+            pc.printf("  can't write %s\r\n", name);
+            ret = file_not_found;
+        }
+    }
+    SuppressSlowStuff = slow;
+    return ret;
+}
+#endif
+
 #endif // TESTENABLE
@@ -274,17 +274,100 @@
 #include "RA8875_Touch_FT5206.h"
 #include "RA8875_Touch_GSL1680.h"
 #include "GraphicsDisplay.h"
+#include "DirtyRegion.h"
+#include "Canvas.h"
+#include "StripRenderer.h"
+#include "SpriteEngine.h"
+#include "GlyphCache.h"
 
 #define RA8875_DEFAULT_SPI_FREQ 5000000
 
+// Size, in bytes, of the staging buffer used to move pixel data over the
+// SPI interface as a block, rather than one byte at a time. Larger blocks
+// amortize the per-transfer overhead further, at the cost of RAM.
+#ifndef RA8875_SPI_BLOCKSIZE
+#define RA8875_SPI_BLOCKSIZE 256
+#endif
+
+// Non-blocking pixel streams are available when the SPI driver supports
+// asynchronous transfers, or when running on the simulated SPI bus.
+#if DEVICE_SPI_ASYNCH || defined(RA8875_SIMULATED_SPI)
+#ifndef RA8875_ASYNC_SPI
+#define RA8875_ASYNC_SPI
+#endif
+#endif
+
+// Size, in bytes, of each of the two staging buffers used by the
+// non-blocking pixel stream. One is filled while the other is sent.
+#ifndef RA8875_ASYNC_BLOCKSIZE
+#define RA8875_ASYNC_BLOCKSIZE 1024
+#endif
+
+#include "RA8875_Bus.h"
+
+// Size, in bytes, of the buffer that gathers the register writes of one
+// SPI transaction. Each register write takes four bytes on the wire.
+#ifndef RA8875_TRANSACTION_SIZE
+#define RA8875_TRANSACTION_SIZE 64
+#endif
+
 #ifndef MBED_ENCODE_VERSION
 #define MBED_ENCODE_VERSION(major, minor, patch) ((major)*10000 + (minor)*100 + (patch))
 #endif
 
+// When waiting on the INT or WAIT pin, the calling thread blocks on an event
+// flag if the RTOS is available. Without it, the MCU sleeps until the pin
+// interrupts, unless an idle callback is set, and then the pin is polled.
+#if MBED_VERSION >= MBED_ENCODE_VERSION(5,8,0) && !defined(RA8875_SIMULATED_SPI)
+#define RA8875_RTOS_WAIT
+#elif !defined(RA8875_SIMULATED_SPI)
+#define RA8875_IRQ_WAIT
+#endif
+
+// Define this to expand 1-bpp data (booleanStream, and so the user fonts)
+// to pixels on the MCU, rather than with the BTE color expansion.
+//#define RA8875_MCU_EXPANSION
+
+// The most glyphs of a string drawn with one color expansion, see puts.
+#ifndef RA8875_TEXT_RUN
+#define RA8875_TEXT_RUN 32
+#endif
+
+// The characters of the internal font sent in one data cycle before the
+// memory write FIFO is checked, see puts. The RA8875 renders each character
+// as it comes off the FIFO, so raise this only as far as it keeps up.
+#ifndef RA8875_TEXT_BURST
+#define RA8875_TEXT_BURST 1
+#endif
+
+// The text that printf formats on the stack; longer text is given a buffer
+// from the heap.
+#ifndef RA8875_PRINTF_BUFFER
+#define RA8875_PRINTF_BUFFER 80
+#endif
+
 // Define this to enable code that monitors the performance of various
 // graphics commands.
 //#define PERF_METRICS
 
+#define PERF_BUCKETS 84             ///< histogram buckets, to 2 seconds
+
+// Define this to trace every SPI transaction, with the API that caused it.
+// See @ref RA8875::TraceEnable.
+//#define RA8875_TRACE
+
+#ifdef RA8875_TRACE
+#ifndef RA8875_TRACE_SIZE
+#define RA8875_TRACE_SIZE 256       ///< transactions held by the tracer, a power of 2
+#endif
+#define TRACESCOPE(a) TraceScope _traceScope(*this, a)
+#else
+#define TRACESCOPE(a)
+#endif
+
+// Each public API is marked, for the tracer and for a span (see @ref SpanTrace_Page).
+#define TRACEAPI(a) TRACESCOPE(a); SPAN(a)
+
 // What better place for some test code than in here and the companion
 // .cpp file. See also the bottom of this file.
 //#define TESTENABLE
@@ -471,6 +554,14 @@ public:
         ACTIVEWINDOW    ///< active window/region
     } Region_t;
 
+    /// Text scroll argument for @ref SetTextScroll()
+    typedef enum
+    {
+        NoScroll,       ///< text wraps from the bottom of the window to the top (default)
+        MoveScroll,     ///< the window is moved up with a BTE block move
+        HardwareScroll  ///< the window is rolled with the scroll offset registers
+    } TextScroll_T;
+
     /// Layer Display Mode argument for @ref SetLayerMode, @ref GetLayerMode
     typedef enum
     {
@@ -546,6 +637,8 @@ public:
         touch_wait,         ///< user has called the touch function
         touchcal_wait,      ///< driver is performing a touch calibration
         progress,           ///< communicates progress
+        stream_wait,        ///< driver is waiting for a non-blocking pixel stream to drain
+        vsync_wait,         ///< driver is waiting for the vertical non-display period
     } IdleReason_T;
     
     /// Idle Callback 
@@ -581,6 +674,17 @@ public:
     ///
     typedef RetCode_t (* IdleCallback_T)(IdleReason_T reason, uint16_t param = 0);
 
+    /// Stream Callback
+    ///
+    /// This defines the interface for a callback that is activated each time
+    /// a block of a non-blocking pixel stream has been sent to the display,
+    /// and its staging buffer is available again. See @ref pixelStreamAsync.
+    ///
+    /// @attention This is called from the SPI interrupt context, so it must
+    ///     be brief and must not call back into the display driver.
+    ///
+    typedef void (* StreamCallback_T)(void);
+
     /// Basic constructor for a display based on the RAiO RA8875 
     /// display controller, which can be used with no touchscreen,
     /// or the RA8875 managed resistive touchscreen.
@@ -874,8 +978,92 @@ public:
     /// @returns the color.
     ///
     color_t GetBackgroundTransparencyColor(void);
- 
- 
+
+
+    /// Begin drawing a frame on the hidden layer, for double buffering.
+    ///
+    /// The two layers are used as a front and a back buffer. BeginFrame
+    /// selects the layer that is not on show for drawing, so the frame is
+    /// built out of sight, and @ref Present then shows it in one write of
+    /// the layer mode, without the partly drawn frame ever being seen.
+    ///
+    /// Once shown, the other layer is a frame behind. Rather than have the
+    /// next frame redraw everything, Present brings it up to date with a BTE
+    /// block move of each rectangle that was given to @ref FrameInvalidate,
+    /// which is inside the controller, and so costs only a few register
+    /// writes on the bus. Whatever is drawn must be invalidated, or the
+    /// other layer keeps the old content there, and shows it again after
+    /// the next flip. So a frame that redraws the whole screen invalidates
+    /// the whole screen, which is then copied in one block move.
+    ///
+    /// At the first BeginFrame, the layer on show is copied to the other,
+    /// so that the two start the same.
+    ///
+    /// At 800 x 480 and 16 bpp the display memory holds only one layer, and
+    /// there is nothing to flip to. Then, if allow8bpp is set, the display
+    /// is changed to 8 bpp with two layers, and both are cleared; and if
+    /// not, the frame is not begun, and not_supported_format is returned.
+    ///
+    /// @code
+    ///     lcd.FrameSyncInit(p23);                 // optional
+    ///     while (1) {
+    ///         lcd.BeginFrame();
+    ///         lcd.fillrect(gauge, Black);
+    ///         lcd.FrameInvalidate(gauge);
+    ///         DrawNeedle(speed);
+    ///         lcd.Present();
+    ///     }
+    /// @endcode
+    ///
+    /// @param[in] allow8bpp permits the change to 8 bpp, where it is the only
+    ///     way to have two layers.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t BeginFrame(bool allow8bpp = false);
+
+
+    /// Mark a rectangle that the frame being drawn has changed.
+    ///
+    /// After @ref Present, the rectangle is copied to the layer that was on
+    /// show, so that both layers hold it. Nearby rectangles are merged
+    /// into one copy, as a @ref DirtyRegion. Anything drawn in the frame,
+    /// and not inside a rectangle given here, is left stale on that layer.
+    ///
+    /// @param[in] r is the rectangle.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t FrameInvalidate(rect_t r);
+
+
+    /// Show the frame begun with @ref BeginFrame.
+    ///
+    /// Whatever is still being drawn is finished first. Then, when a VSYNC
+    /// pin has been set with @ref FrameSyncInit, and vsync is set, it waits
+    /// for the vertical non-display period before the layer is changed, so
+    /// that the flip does not tear. Last, the rectangles given to
+    /// @ref FrameInvalidate are copied to the layer that is now hidden, and
+    /// the layer on show is selected for drawing.
+    ///
+    /// @param[in] vsync is optional, and when false the flip is made at once.
+    /// @returns @ref RetCode_t value; bad_parameter without a BeginFrame.
+    ///
+    RetCode_t Present(bool vsync = true);
+
+
+    /// Set the pin to synchronise @ref Present with the display refresh.
+    ///
+    /// The RA8875 has no status bit for the vertical non-display period,
+    /// but it drives the VSYNC line of the panel, which is active low as
+    /// set up by init(). Wired to a pin, Present waits on it, with the
+    /// same means as @ref CompletionInterruptInit, for at most 20 msec.
+    ///
+    /// @param[in] vsyncPin is the pin wired to the panel VSYNC line, or NC.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t FrameSyncInit(PinName vsyncPin);
+
+
+
     /// Initialize theTouch Panel controller with default values 
     ///
     /// This activates the simplified touch panel init, which may work for
@@ -1457,6 +1645,12 @@ public:
     ///
     /// This is a high level command, and may invoke several primitives.
     ///
+    /// @note The driver keeps a shadow copy of the registers that the
+    ///     controller does not change on its own. If the register already
+    ///     holds the data value, nothing is sent to the display, and the
+    ///     command register selection is left as it was. A command without
+    ///     data is always sent, so it is safe to follow it with @ref WriteData.
+    ///
     /// @param[in] command is the command to write.
     /// @param[in] data is optional data to be written to the command register
     ///     and only occurs if the data is in the range [0 - 0xFF].
@@ -1487,6 +1681,11 @@ public:
     
     /// Read a command register
     ///
+    /// @note Registers that the controller does not change on its own are
+    ///     answered from the driver's shadow copy once their value is known.
+    ///     Status, touch, keypad, cursor and busy registers are always read
+    ///     from the display.
+    ///
     /// @param[in] command is the command register to read.
     /// @returns the value read from the register.
     ///
@@ -1670,6 +1869,38 @@ public:
     /// @returns @ref RetCode_t value.
     ///
     RetCode_t SetTextFont(font_t font = ISO8859_1);
+
+
+    /// Define a glyph of the internal font, held in the CGRAM of the RA8875.
+    ///
+    /// From then on, the character code in text written with the internal
+    /// font is drawn with this glyph, rather than the one from the font ROM,
+    /// so a symbol - a unit, an arrow, an icon - costs one byte on the bus,
+    /// like any other character. It is scaled and colored as the font is.
+    /// The CGRAM holds a glyph for each of the 256 codes.
+    ///
+    /// @code
+    ///     const uint8_t degree[16] = { 0x00, 0x38, 0x44, 0x44, 0x38 };
+    ///
+    ///     lcd.SetUserGlyph(0x80, degree);
+    ///     lcd.printf("Oil %3d\x80" "C", oilTemp);
+    /// @endcode
+    ///
+    /// @param[in] code is the character code, which may not be 0, '\\r'
+    ///     or '\\n'.
+    /// @param[in] glyph is the 8 x 16 glyph, 16 bytes from the top row down,
+    ///     with the leftmost pixel of each row in the most significant bit.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t SetUserGlyph(uint8_t code, const uint8_t * glyph);
+
+
+    /// Draw every character code from the font ROM again, as before any
+    /// @ref SetUserGlyph.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t ClearUserGlyphs(void);
     
 
     /// Sets the display orientation.
@@ -1800,6 +2031,52 @@ public:
     ///
     RetCode_t GetTextFontSize(HorizontalScale * hScale, VerticalScale * vScale);
 
+
+    /// Set what the text does when it reaches the bottom of the window.
+    ///
+    /// By default the text wraps back to the top of the window, and writes
+    /// over what is there. With scrolling, the window moves up by a line,
+    /// and only the line that is exposed at the bottom is cleared to the
+    /// background color, rather than the window being repainted.
+    ///
+    /// - MoveScroll moves the rest of the window up with a BTE @ref BlockMove,
+    ///   in the drawing layer, which is a dozen register writes, and then
+    ///   clears the exposed line. What is on the screen is where it is drawn.
+    /// - HardwareScroll leaves the window in the display memory, and rolls
+    ///   what is shown of it with the scroll window (0x38 - 0x3F) and the
+    ///   vertical scroll offset (0x26 - 0x27) registers, so a scroll is the
+    ///   offset and the cleared line alone. The lines are kept in the display
+    ///   memory as a ring, so a graphic drawn in the window at a fixed place
+    ///   will roll with the text. The scroll window is the whole number of
+    ///   lines of the present font that fit in the window, so the font and
+    ///   the window are set first. Both layers scroll.
+    ///
+    /// The window is the one in effect for the text, see @ref window. With
+    /// the internal fonts, a scroll is made at a new line, and so text lines
+    /// should end with '\n' rather than wrap at the right edge.
+    ///
+    /// @code
+    ///     lcd.window(0,240, 480,240);
+    ///     lcd.SelectUserFont(BPG_Arial10x10);
+    ///     lcd.SetTextScroll(RA8875::HardwareScroll);
+    ///     lcd.cls();
+    ///     while (1)
+    ///         lcd.printf("%8u: %s\r\n", seq++, msg);   // the log console
+    /// @endcode
+    ///
+    /// @param[in] mode is the scroll mode.
+    /// @returns @ref RetCode_t value; bad_parameter if the window does not hold
+    ///     two lines of the font.
+    ///
+    RetCode_t SetTextScroll(TextScroll_T mode);
+
+
+    /// Get the text scroll mode.
+    ///
+    /// @returns the mode set by @ref SetTextScroll.
+    ///
+    TextScroll_T GetTextScroll(void) { return textScroll; }
+
     /// put a character on the screen.
     ///
     /// @param[in] c is the character.
@@ -1814,6 +2091,16 @@ public:
     ///     lcd.puts("Test STring");
     /// @endcode
     ///
+    /// With the internal font, text mode is entered once, and the characters
+    /// are streamed after one memory write command, while the text cursor is
+    /// followed here rather than read back from the controller. When the
+    /// font is rotated or fully aligned, the controller moves the cursor in
+    /// ways not followed, and each character is put on its own.
+    ///
+    /// With a user font, the glyphs that run along a line are drawn with one
+    /// BTE color expansion over their bounding box, rather than one for each
+    /// character, and they wrap and scale as they do with @ref _putc.
+    ///
     /// @param[in] string is the null terminated string to send to the display.
     ///
     void puts(const char * string);
@@ -1830,6 +2117,23 @@ public:
     /// @param[in] string is the null terminated string to send to the display.
     ///
     void puts(loc_t x, loc_t y, const char * string);
+
+
+    /// Write formatted text to the display.
+    ///
+    /// This takes the place of the Stream printf, which passes the text one
+    /// character at a time to @ref _putc; here it is formatted first, and
+    /// then written with @ref puts.
+    ///
+    /// @code
+    ///     lcd.printf("Speed %3d km/h\r\n", speed);
+    /// @endcode
+    ///
+    /// @param[in] format is the printf format string.
+    /// @param[in] ... are the values it formats.
+    /// @returns the number of characters written.
+    ///
+    int printf(const char * format, ...);
     
 
     /// Prepare the controller to write binary data to the screen by positioning
@@ -2068,6 +2372,66 @@ public:
     virtual RetCode_t pixelStream(color_t * p, uint32_t count, loc_t x, loc_t y);
     
     
+    /// Write an RGB565 stream of pixels to the display, without waiting for
+    /// the transfer to complete.
+    ///
+    /// The pixels are copied into one of two staging buffers, and each buffer
+    /// is handed to the SPI driver for a non-blocking (DMA) transfer as it
+    /// fills. While one buffer is being sent, the other is being filled, so
+    /// the caller can be preparing the next data while the last of this is
+    /// still on its way to the display.
+    ///
+    /// The caller may reuse the pixel buffer as soon as this returns. Any
+    /// other access to the display waits for the stream to drain first, and
+    /// @ref flush may be used to wait for it explicitly.
+    ///
+    /// @note If the SPI driver does not support asynchronous transfers, this
+    ///     is the same as @ref pixelStream.
+    ///
+    /// @param[in] p is a pointer to a color_t array to write.
+    /// @param[in] count is the number of pixels to write.
+    /// @param[in] x is the horizontal position on the display.
+    /// @param[in] y is the vertical position on the display.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t pixelStreamAsync(const color_t * p, uint32_t count, loc_t x, loc_t y);
+    
+    
+    /// Write an RGB565 stream of pixels to the display straight from where
+    /// they are, without waiting for the transfer to complete.
+    ///
+    /// At 16 bits a pixel, the bus is set to 16-bit frames, which send each
+    /// pixel from its top byte, and the whole stream is handed to the SPI
+    /// driver as one non-blocking (DMA) transfer from the caller's buffer.
+    /// Nothing is copied, so the caller may draw the next strip of a frame
+    /// in another buffer while this one is sent, but must not change this
+    /// buffer until the stream is finished, which @ref flush, and any other
+    /// access to the display, waits for.
+    ///
+    /// @note At 8 bits a pixel, or if the SPI driver does not support
+    ///     asynchronous transfers, this is the same as @ref pixelStreamAsync.
+    ///
+    /// @param[in] p is a pointer to a color_t array to write.
+    /// @param[in] count is the number of pixels to write.
+    /// @param[in] x is the horizontal position on the display.
+    /// @param[in] y is the vertical position on the display.
+    /// @returns @ref RetCode_t value.
+    ///
+    virtual RetCode_t pixelStreamInPlace(const color_t * p, uint32_t count, loc_t x, loc_t y);
+    
+    
+    /// Wait for any non-blocking pixel stream, and any deferred graphics
+    /// engine operation (see @ref SetDeferredWait), to finish.
+    ///
+    /// While waiting, the idle callback is activated with the stream_wait reason.
+    ///
+    /// @returns @ref RetCode_t value, which is external_abort if the idle
+    ///     callback requested it, including for a deferred wait made since
+    ///     the last flush.
+    ///
+    virtual RetCode_t flush(void);
+    
+    
     /// Get a stream of pixels from the display.
     ///
     /// @param[in] p is a pointer to a color_t array to accept the stream.
@@ -2094,6 +2458,11 @@ public:
     /// See @ref SetTextFontSize, So, users may want to SetTextFontSize(1) for
     /// 1:1 scaling.
     /// 
+    /// The bits are sent as they are, one bit a pixel, and the BTE color
+    /// expansion applies the colors, rather than 16 bits a pixel being sent.
+    /// When the font is set to NOFILL with @ref SetTextFontControl, the bits
+    /// that are clear are not drawn, for transparent text.
+    ///
     /// @param[in] x is the horizontal position on the display.
     /// @param[in] y is the vertical position on the display.
     /// @param[in] w is the width of the rectangular region to fill.
@@ -2104,6 +2473,75 @@ public:
     ///
     virtual RetCode_t booleanStream(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_t * boolStream);
 
+
+    #ifndef RA8875_MCU_EXPANSION
+    /// Draw one character of the selected user font, as @ref booleanStream
+    /// does, but with the glyph packed for the color expansion kept in the
+    /// glyph cache (see @ref SetGlyphCache).
+    ///
+    /// Only the glyphs of the font are cached, as they are in flash and do
+    /// not change; the data given to booleanStream may be refilled by the
+    /// caller, so it is always packed again.
+    ///
+    /// @param[in] x is the horizontal pixel coordinate
+    /// @param[in] y is the vertical pixel coordinate
+    /// @param[in] c is the character to render
+    /// @returns how far the cursor should advance to the right in pixels.
+    /// @returns zero if the character could not be rendered.
+    ///
+    virtual int fontblit(loc_t x, loc_t y, const unsigned char c);
+    #endif
+
+
+    /// Draw a monochrome bitmap, such as an icon, with the BTE color expansion.
+    ///
+    /// Each row of the bitmap starts on a byte, and the leftmost pixel is the
+    /// most significant bit, as most image converters make them. Only the
+    /// bitmap is sent, one bit a pixel, and the controller applies the colors.
+    ///
+    /// @code
+    ///     lcd.MonoBitmap(10,10, 32,32, warningIcon, Yellow, Black);
+    ///     lcd.MonoBitmap(50,10, 32,32, warningIcon, Red, Black, NOFILL);
+    /// @endcode
+    ///
+    /// @param[in] x is the left edge of the bitmap.
+    /// @param[in] y is the top edge of the bitmap.
+    /// @param[in] w is the width of the bitmap.
+    /// @param[in] h is the height of the bitmap.
+    /// @param[in] bits is the bitmap, of h rows of (w + 7) / 8 bytes.
+    /// @param[in] fg is the color of the bits that are set.
+    /// @param[in] bg is the color of the bits that are clear.
+    /// @param[in] fillit is optional to NOFILL, and then the bits that are
+    ///     clear are not drawn. default is FILL.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t MonoBitmap(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_t * bits,
+        color_t fg, color_t bg, fill_t fillit = FILL);
+
+
+    /// Set the RAM budget of the glyph cache.
+    ///
+    /// The user font glyphs are packed for the BTE color expansion, and for
+    /// the font scale, as they are drawn, and the most recently drawn are
+    /// kept in a @ref GlyphCache, so a glyph drawn again is sent as it is.
+    ///
+    /// @param[in] bytes is the most RAM to use; 0 turns the cache off. The
+    ///     default is GLYPH_CACHE_BYTES.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t SetGlyphCache(uint32_t bytes);
+
+
+    /// Get the glyph cache, for its statistics.
+    ///
+    /// @code
+    ///     lcd.GetGlyphCache().ReportStats(pc);
+    /// @endcode
+    ///
+    /// @returns the glyph cache.
+    ///
+    GlyphCache & GetGlyphCache(void) { return glyphCache; }
+
     
     /// Draw a line in the specified color
     ///
@@ -2996,6 +3434,85 @@ public:
     ///
     void AttachIdleHandler(IdleCallback_T callback = NULL) { idle_callback = callback; }
 
+    /// Register a Stream callback with the RA8875 display object.
+    ///
+    /// This callback is activated each time a block of a non-blocking pixel
+    /// stream has been sent. See @ref StreamCallback_T and @ref pixelStreamAsync.
+    ///
+    /// @param callback is the stream callback function. Without a callback function
+    ///     it will unregister the handler.
+    ///
+    void AttachStreamHandler(StreamCallback_T callback = NULL) { stream_callback = callback; }
+
+    /// Wait on the RA8875 INT and WAIT pins, rather than polling the controller.
+    ///
+    /// Without this, when a drawing operation has been started, the driver
+    /// polls the controller over the SPI bus until it completes, which can
+    /// be as much as 20 msec. With this, it waits on the pins instead, and
+    /// when the RTOS is available, the calling thread is blocked on an event
+    /// flag, so other threads can run during large fills and block moves.
+    /// Without the RTOS, the MCU sleeps until the pin interrupts, or, when an
+    /// idle callback is attached, polls the pin and calls it meanwhile.
+    ///
+    /// - The INT pin is used with the BTE process complete interrupt, which is
+    ///   enabled in INTC1, for @ref BlockMove and the other BTE operations.
+    /// - The WAIT pin is used for the draw engine (line, rectangle, circle, and
+    ///   so on), and for the memory busy wait.
+    ///
+    /// Once a pin signals completion, the busy state is confirmed by one read
+    /// of the controller, and should it still be busy, the polling wait takes
+    /// over. So a pin that is not wired, or the INT pin being held by another
+    /// source such as the keypad interrupt, costs time but not correctness.
+    ///
+    /// On a host build, the pins are simulated by @ref SimInterruptIn, and are
+    /// driven by the model of the controller.
+    ///
+    /// @code
+    ///     lcd.init(...);
+    ///     lcd.CompletionInterruptInit(p21, p22);
+    /// @endcode
+    ///
+    /// @param[in] intPin is the pin wired to the RA8875 INT output, or NC.
+    /// @param[in] waitPin is the pin wired to the RA8875 WAIT output, or NC.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t CompletionInterruptInit(PinName intPin, PinName waitPin = NC);
+
+    /// Select the deferred wait mode for the hardware drawing primitives.
+    ///
+    /// Normally @ref line, @ref rect, @ref roundrect, @ref triangle, @ref circle,
+    /// @ref ellipse and @ref BlockMove start the graphics engine, and then wait
+    /// for it to finish before they return. In the deferred mode they return
+    /// as soon as the engine is started, and the wait is made just before
+    /// the next access to the controller. So the caller can prepare the next
+    /// command, such as decoding the next part of an image, while a large
+    /// fill runs.
+    ///
+    /// Since the wait is made later, a timeout or abort from it cannot be
+    /// returned by the primitive that started the engine. It is instead
+    /// returned by the next @ref flush.
+    ///
+    /// With PERF_METRICS, @ref ReportPerformance shows how long the caller
+    /// ran on after each deferral, before the next access to the controller,
+    /// and how much engine time was still waited for then. The engine may
+    /// have finished before that next access, so the time run on is the most
+    /// engine time that was hidden, not a measure of it.
+    ///
+    /// @param[in] defer when true selects the deferred mode. When false, any
+    ///     pending wait is made, and each primitive again waits for itself.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t SetDeferredWait(bool defer = true);
+
+    /// Get the display bus.
+    ///
+    /// This is chiefly of use with the @ref RA8875_MockBus, to read what was
+    /// sent to it, or the @ref RA8875_SimBus, to attach a model of the controller.
+    ///
+    /// @returns a reference to the bus; see @ref RA8875_Bus_Page.
+    ///
+    RA8875_BUS & Bus(void) { return bus; }
+
 
 #ifdef PERF_METRICS
     /// Clear the performance metrics to zero.
@@ -3013,6 +3530,98 @@ public:
     /// @param[in,out] pc is the serial channel to write to.
     ///
     void ReportPerformance(Serial & pc);
+
+    /// Write the performance histograms to a file, in a binary form, so that
+    /// those of different builds may be compared on a PC.
+    ///
+    /// All values are little-endian. The file holds a header, then one
+    /// record per method:
+    /// - header: "R8PH" (4 bytes), version 1 (uint16), method count (uint16),
+    ///   bucket count (uint16), sub-buckets per octave (uint16), and the
+    ///   build date and time, zero padded (32 bytes).
+    /// - method: name, zero padded (24 bytes), then as uint32 - calls, max uS,
+    ///   total bytes, total transactions, and the count of each bucket.
+    ///
+    /// Bucket b counts the times t, in uS, where t = b for b < 4, and for
+    /// larger b, where (4 + b % 4) << (b / 4 - 1) <= t < (5 + b % 4) << (b / 4 - 1).
+    /// The last bucket also counts all the longer times.
+    ///
+    /// @param[in] name is the file name.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t PerformanceSnapshot(const char * name);
+#endif
+
+
+#ifdef RA8875_TRACE
+    /// One SPI transaction, as recorded by the tracer.
+    typedef struct {
+        uint32_t usec;              ///< when the chip select was asserted, in uS since TraceEnable
+        const char * api;           ///< the API that caused it, or NULL if none is known
+        uint16_t bytes;             ///< bytes exchanged
+        uint16_t duration;          ///< uS from the chip select to its release
+        uint8_t type;               ///< cycle of the first byte; 0x80 command, 0x00 data write,
+                                    ///< 0x40 data read, 0xC0 status read
+        uint8_t reg;                ///< register written by a command, or the one read or written
+    } TraceEntry_T;
+
+    /// Start or stop the tracer.
+    ///
+    /// The tracer records every SPI transaction in a ring buffer of
+    /// RA8875_TRACE_SIZE entries, so it holds the most recent of them. Each
+    /// is attributed to the outermost public API in progress when it was
+    /// sent, such as "fillrect", "booleanStream" or "RenderJpegFile".
+    /// Starting it clears the buffer and the clock.
+    ///
+    /// @param[in] enable is true to start, and false to stop.
+    ///
+    void TraceEnable(bool enable = true);
+
+    /// Copy the trace out, oldest first.
+    ///
+    /// This may be called while tracing, as from another thread. An entry
+    /// overwritten while it was copied is dropped.
+    ///
+    /// @param[out] entries is where to put them.
+    /// @param[in] count is the most entries to copy.
+    /// @returns the number of entries copied.
+    ///
+    uint32_t TraceRead(TraceEntry_T * entries, uint32_t count);
+
+    /// Report the transactions, bytes and bus time of each API in the trace.
+    ///
+    /// @param[in,out] pc is the serial channel to write to.
+    ///
+    void TraceReport(Serial & pc);
+
+    /// Write the raw trace as CSV.
+    ///
+    /// @param[in,out] pc is the serial channel to write to.
+    ///
+    void TraceDump(Serial & pc);
+
+    // When tracing, the image file APIs are wrapped, to attribute their traffic.
+    // Their spans are recorded by GraphicsDisplay.
+    RetCode_t RenderImageFile(loc_t x, loc_t y, const char *FileName) {
+        TRACESCOPE("RenderImageFile");
+        return GraphicsDisplay::RenderImageFile(x, y, FileName);
+    }
+    RetCode_t RenderJpegFile(loc_t x, loc_t y, const char *Name_JPG) {
+        TRACESCOPE("RenderJpegFile");
+        return GraphicsDisplay::RenderJpegFile(x, y, Name_JPG);
+    }
+    RetCode_t RenderBitmapFile(loc_t x, loc_t y, const char *Name_BMP) {
+        TRACESCOPE("RenderBitmapFile");
+        return GraphicsDisplay::RenderBitmapFile(x, y, Name_BMP);
+    }
+    RetCode_t RenderIconFile(loc_t x, loc_t y, const char *Name_ICO) {
+        TRACESCOPE("RenderIconFile");
+        return GraphicsDisplay::RenderIconFile(x, y, Name_ICO);
+    }
+    RetCode_t RenderGIFFile(loc_t x, loc_t y, const char *Name_GIF) {
+        TRACESCOPE("RenderGIFFile");
+        return GraphicsDisplay::RenderGIFFile(x, y, Name_GIF);
+    }
 #endif
 
 
@@ -3134,6 +3743,28 @@ private:
     /// @returns the character put.
     ///
     int _internal_putc(int c);
+
+    /// Internal function to write text with the internal font engine, in
+    /// runs streamed after one memory write command, with the text cursor
+    /// followed in cursor_x and cursor_y.
+    ///
+    /// @param[in] string is the text.
+    /// @param[in] count is the number of characters of it.
+    ///
+    void _internal_write(const char * string, int count);
+
+    /// Internal function to move the internal font text cursor down a line.
+    ///
+    /// @param[in] lineHeight is the height of a line.
+    ///
+    void _internal_linefeed(dim_t lineHeight);
+
+    /// Internal function to check whether a character is drawn from CGRAM.
+    ///
+    /// @param[in] c is the character code.
+    /// @returns true if it was defined with @ref SetUserGlyph.
+    ///
+    bool _isUserGlyph(uint8_t c) { return (userGlyph[c >> 5] >> (c & 0x1F)) & 1; }
     
     /// Internal function to put a character using the external font engine
     ///
@@ -3141,6 +3772,15 @@ private:
     /// @returns the character put.
     ///
     int _external_putc(int c);
+
+    /// Internal function to move the text cursor down a line, which scrolls
+    /// the window when the line would pass its bottom, see @ref SetTextScroll.
+    ///
+    /// @param[in] y is the top of the line the cursor is on.
+    /// @param[in] lineHeight is the height of a line.
+    /// @returns the top of the next line.
+    ///
+    loc_t _TextLineFeed(loc_t y, dim_t lineHeight);
     
     /// Internal function to get the actual width of a character when using the external font engine
     ///
@@ -3197,6 +3837,127 @@ private:
     ///
     RetCode_t _select(bool chipsel);
 
+    /// A sequence of register writes, sent to the controller as one SPI transaction.
+    ///
+    /// The register writes for a drawing command are gathered, and then sent
+    /// back to back at the write speed, when the transaction is committed or
+    /// goes out of scope. Each write still has its own chip select, as the
+    /// controller requires, but the clock speed, the staged pixels and any
+    /// pending wait are dealt with once for the sequence, and the register
+    /// shadow is honored, so unchanged values are not sent at all.
+    ///
+    /// Nothing else should be sent to the controller while a transaction is
+    /// open, since it would overtake the gathered writes. Reads, if any, are
+    /// made before the transaction is opened, so the clock speed is changed
+    /// at most once.
+    ///
+    /// @code
+    ///     {
+    ///         SPITransaction t(*this);
+    ///         t.WriteCommandW(0x91, x1);
+    ///         ...
+    ///         t.WriteCommand(0x90, 0x80);
+    ///     }   // sent here
+    /// @endcode
+    ///
+    class SPITransaction
+    {
+    public:
+        /// Open a transaction.
+        ///
+        /// @param[in] display is the display to send it to.
+        ///
+        SPITransaction(RA8875 & display);
+
+        /// Close the transaction, sending anything not yet committed.
+        ///
+        ~SPITransaction();
+
+        /// Add a register write to the transaction.
+        ///
+        /// @param[in] command is the register to write.
+        /// @param[in] data is the value to write to it.
+        ///
+        void WriteCommand(uint8_t command, uint8_t data);
+
+        /// Add a 16-bit register write, as two register writes, to the transaction.
+        ///
+        /// @param[in] command is the register to write the low byte to.
+        /// @param[in] data is the value to write, the high byte going to command+1.
+        ///
+        void WriteCommandW(uint8_t command, uint16_t data);
+
+        /// Send the register writes gathered so far.
+        ///
+        void Commit(void);
+
+    private:
+        RA8875 & display;           ///< the display the transaction is for
+        uint8_t buf[RA8875_TRANSACTION_SIZE]; ///< the gathered register writes
+        int count;                  ///< number of bytes presently in buf
+    };
+    friend class SPITransaction;
+
+    #ifdef RA8875_TRACE
+    /// Attributes the traffic within its scope to an API, unless an outer
+    /// scope already has.
+    class TraceScope
+    {
+    public:
+        TraceScope(RA8875 & d, const char * api) : display(d), prev(d.traceApi) {
+            if (!prev)
+                display.traceApi = api;
+        }
+        ~TraceScope() { display.traceApi = prev; }
+    private:
+        RA8875 & display;           ///< the display being traced
+        const char * prev;          ///< the API of the outer scope, if any
+    };
+    friend class TraceScope;
+
+    void _traceOpen(void);
+    void _traceBytes(const uint8_t * data, int count);
+    void _traceClose(void);
+
+    TraceEntry_T traceBuf[RA8875_TRACE_SIZE]; ///< the ring buffer
+    volatile uint32_t traceHead;    ///< entries written; the next goes to traceHead % RA8875_TRACE_SIZE
+    volatile bool traceOpen;        ///< the entry at traceHead is being filled
+    bool traceEnabled;              ///< the tracer is running
+    const char * traceApi;          ///< the API in progress, or NULL
+    Timer traceTimer;               ///< the trace clock
+    #endif
+
+    /// Determine if the register shadow holds the value of a register.
+    ///
+    /// @param[in] reg is the register of interest.
+    /// @returns true if the shadow value can be used in place of the register.
+    ///
+    bool _shadowHas(uint8_t reg) { return (regShadowValid[reg >> 5] & (1UL << (reg & 0x1F))) != 0; }
+
+    /// Record a value written to, or read from, a register.
+    ///
+    /// Volatile registers, which the controller changes on its own, are
+    /// not recorded.
+    ///
+    /// @param[in] reg is the register.
+    /// @param[in] data is the value it now holds.
+    ///
+    void _shadowStore(uint8_t reg, uint8_t data);
+
+    /// Discard the shadow value of a register, so the next access goes to the controller.
+    ///
+    /// @param[in] reg is the register.
+    ///
+    void _shadowForget(uint8_t reg);
+
+    /// Discard the whole register shadow, as after a reset.
+    ///
+    void _shadowClear(void);
+
+    /// Initialize the state that does not depend on the constructor used.
+    ///
+    void _init(void);
+
     /// Wait while the status register indicates the controller is busy.
     ///
     /// @param[in] mask is the mask of bits to monitor.
@@ -3214,6 +3975,60 @@ private:
     ///
     bool _WaitWhileReg(uint8_t reg, uint8_t mask);
 
+    #ifdef RA8875_SIMULATED_SPI
+    typedef SimInterruptIn CompletionPin_T;
+    #else
+    typedef InterruptIn CompletionPin_T;
+    #endif
+
+    /// Wait for a completion pin to reach its ready level.
+    ///
+    /// This is the first part of a wait, before the controller is polled
+    /// to confirm that it is no longer busy.
+    ///
+    /// @param[in] pin is the INT or WAIT pin.
+    /// @param[in] readyLevel is the pin level that signals completion.
+    /// @param[in] flag is the event flag set by the pin interrupt.
+    /// @param[in] reason is passed to the idle callback while waiting.
+    /// @returns @ref RetCode_t value, which is external_abort if the idle callback
+    ///     asked to abort, and otherwise noerror, even on a timeout.
+    ///
+    RetCode_t _WaitForPin(CompletionPin_T * pin, int readyLevel, uint32_t flag, IdleReason_T reason);
+
+    /// Wait for the graphics engine after it is started, or defer the wait.
+    ///
+    /// @param[in] reg is the register to monitor, or 0 to monitor the status register.
+    /// @param[in] mask is the bit mask to monitor.
+    /// @returns true if a normal exit, or if the wait was deferred.
+    ///
+    bool _WaitForEngine(uint8_t reg, uint8_t mask);
+
+    /// Make a deferred graphics engine wait, if one is pending.
+    ///
+    /// @returns true if a normal exit, or if there was nothing to wait for.
+    ///
+    bool _WaitDeferred(void);
+
+    #if defined(RA8875_RTOS_WAIT) || defined(RA8875_IRQ_WAIT)
+    /// Interrupt handler for the INT pin, which wakes a waiting thread.
+    ///
+    void _intPinISR(void);
+
+    /// Interrupt handler for the WAIT pin, which wakes a waiting thread.
+    ///
+    void _waitPinISR(void);
+
+    /// Interrupt handler for the VSYNC pin, which wakes a waiting thread.
+    ///
+    void _vsyncPinISR(void);
+    #endif
+
+    #ifdef RA8875_IRQ_WAIT
+    /// Timeout handler, which ends a wait on a pin that did not interrupt.
+    ///
+    void _pinTimeoutISR(void);
+    #endif
+
     /// set the spi port to either the write or the read speed.
     ///
     /// This is a private API used to toggle between the write
@@ -3242,16 +4057,218 @@ private:
     ///     in while shifting out.
     ///
     unsigned char _spiread();
+
+    /// Read the status, or the selected register, in one chip select.
+    ///
+    /// The cycle byte is sent at the read speed too, as the controller
+    /// takes it at either, so a read does not switch the clock to the
+    /// write speed and back. Set to the read speed before a polling loop,
+    /// the port is then not reprogrammed while it polls.
+    ///
+    /// @param[in] cycle is 0x40 for a data read, or 0xC0 for the status.
+    /// @returns the value read.
+    ///
+    unsigned char _spiReadCycle(unsigned char cycle);
     
+    /// Write a block of data to the SPI interface.
+    ///
+    /// The port speed is checked once for the block, and the data is
+    /// handed to the SPI driver in a single transfer.
+    ///
+    /// @param[in] data is a pointer to the data to write.
+    /// @param[in] count is the number of bytes to write.
+    ///
+    void _spiwriteBlock(const uint8_t * data, int count);
+
+    /// Read a block of data from the SPI interface.
+    ///
+    /// The port speed is checked once for the block, and the data is
+    /// gathered by the SPI driver in a single transfer.
+    ///
+    /// @param[out] data is a pointer to where the data will be written.
+    /// @param[in] count is the number of bytes to read.
+    ///
+    void _spireadBlock(uint8_t * data, int count);
+
+    /// Add one pixel to the staging buffer for a graphics stream.
+    ///
+    /// The pixel is placed in the byte order and width that the display
+    /// expects for the configured color depth, and the buffer is sent to
+    /// the display when it is full.
+    ///
+    /// @param[in] c is the color to stage.
+    ///
+    void _stagePixel(color_t c);
+
+    /// Add one byte of 1-bpp data to the staging buffer, for a color expansion.
+    ///
+    /// @param[in] b is the byte to stage.
+    ///
+    void _stageByte(uint8_t b);
+
+    /// Send any pixels that are in the staging buffer to the display.
+    ///
+    void _flushPixelBlock(void);
+
+    /// Draw 1-bpp data with the BTE color expansion, in the foreground and
+    /// background colors.
+    ///
+    /// @param[in] x is the left edge on the display.
+    /// @param[in] y is the top edge on the display.
+    /// @param[in] w is the width of the data.
+    /// @param[in] h is the height of the data.
+    /// @param[in] bits is the data, of h rows of (w + 7) / 8 bytes.
+    /// @param[in] lsbFirst is true when the leftmost pixel of each byte is
+    ///     the least significant bit, as in the user fonts.
+    /// @param[in] scaleX repeats each pixel across.
+    /// @param[in] scaleY repeats each row down.
+    /// @param[in] transparent leaves the pixels of the clear bits undrawn.
+    /// @param[in] cached is true when the bits are a glyph of the selected
+    ///     font, which does not change, so it may be kept in the glyph cache.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t _colorExpand(loc_t x, loc_t y, dim_t w, dim_t h, const uint8_t * bits,
+        bool lsbFirst, int scaleX, int scaleY, bool transparent, bool cached = false);
+
+    /// Start a BTE color expansion, to which the 1-bpp data is then staged.
+    ///
+    /// @param[in] x is the left edge on the display.
+    /// @param[in] y is the top edge on the display.
+    /// @param[in] w is the width drawn.
+    /// @param[in] h is the height drawn.
+    /// @param[in] transparent leaves the pixels of the clear bits undrawn.
+    ///
+    void _StartColorExpand(loc_t x, loc_t y, dim_t w, dim_t h, bool transparent);
+
+    /// Get a glyph packed for the color expansion, from the glyph cache.
+    ///
+    /// @param[in] bits is the glyph, of h rows of (w + 7) / 8 bytes.
+    /// @param[in] w is the width of the glyph.
+    /// @param[in] h is the height of the glyph.
+    /// @param[in] lsbFirst is true when the leftmost pixel of each byte is
+    ///     the least significant bit.
+    /// @param[in] scaleX repeats each pixel across.
+    /// @param[in] scaleY repeats each row down.
+    /// @param[in] pin is true to keep it in the cache, while other glyphs
+    ///     are packed, until the cache is unpinned.
+    /// @returns the packed glyph, of h * scaleY rows of (w * scaleX + 7) / 8
+    ///     bytes, or NULL when the cache cannot hold it.
+    ///
+    const uint8_t * _PackedGlyph(const uint8_t * bits, dim_t w, dim_t h, bool lsbFirst,
+        int scaleX, int scaleY, bool pin = false);
+
+    #ifndef RA8875_MCU_EXPANSION
+    /// Write a string in the user font, with a color expansion for each run
+    /// of glyphs along a line, rather than one for each glyph.
+    ///
+    /// @param[in] string is the null terminated string.
+    ///
+    void _external_puts(const char * string);
+
+    /// Draw a run of glyphs, side by side, with one color expansion.
+    ///
+    /// @param[in] x is the left edge of the run.
+    /// @param[in] y is the top edge of the run.
+    /// @param[in] h is the height of the glyphs.
+    /// @param[in] glyph is the glyph of each character.
+    /// @param[in] glyphWidth is the width of each glyph.
+    /// @param[in] count is the number of glyphs.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t _external_run(loc_t x, loc_t y, dim_t h, const uint8_t ** glyph, const dim_t * glyphWidth, int count);
+
+    /// Append the top n bits of a byte to the bits being staged, which are
+    /// staged a byte at a time.
+    ///
+    /// @param[in,out] acc holds the bits not yet staged.
+    /// @param[in,out] accBits is the number of bits in acc.
+    /// @param[in] b holds the bits, from bit 7 down.
+    /// @param[in] n is the number of bits, 1 to 8.
+    ///
+    void _appendBits(uint16_t & acc, int & accBits, uint8_t b, int n);
+    #endif
+
+    /// Pack 1-bpp data for the color expansion, most significant bit first,
+    /// with each pixel and row repeated for the scale.
+    ///
+    /// @param[in] bits is the data, of h rows of (w + 7) / 8 bytes.
+    /// @param[in] w is the width of the data.
+    /// @param[in] h is the height of the data.
+    /// @param[in] lsbFirst is true when the leftmost pixel of each byte is
+    ///     the least significant bit.
+    /// @param[in] scaleX repeats each pixel across.
+    /// @param[in] scaleY repeats each row down.
+    /// @param[out] out is where to put the packed data, or NULL to stage it.
+    ///
+    void _packBits(const uint8_t * bits, dim_t w, dim_t h, bool lsbFirst, int scaleX, int scaleY,
+        uint8_t * out);
+
+    #ifdef RA8875_ASYNC_SPI
+    /// Start the non-blocking transfer of the staging buffer being filled,
+    /// and switch to the other one.
+    ///
+    /// @param[in] count is the number of bytes in the buffer.
+    ///
+    void _startAsyncBlock(int count);
+
+    /// SPI event handler for the completion of a non-blocking transfer.
+    ///
+    /// @param[in] event is the SPI event that occurred.
+    ///
+    void _asyncComplete(int event);
+
+    /// Wait while a non-blocking transfer is in progress.
+    ///
+    /// @returns true if a normal exit.
+    /// @returns false if the idle callback requested an abort.
+    ///
+    bool _WaitWhileAsync(void);
+    #endif
+
     const uint8_t * pKeyMap;
     
-    SPI spi;                        ///< spi port
+    RA8875_BUS bus;                 ///< the display bus, with the chip select; see @ref RA8875_Bus_Page
     bool spiWriteSpeed;             ///< indicates if the current mode is write or read
     unsigned long spiwritefreq;     ///< saved write freq
     unsigned long spireadfreq;      ///< saved read freq
-    DigitalOut cs;                  ///< RA8875 chip select pin, assumed active low
+    unsigned long spiActiveFreq;    ///< freq the spi port is presently programmed for
     DigitalOut res;                 ///< RA8875 reset pin, assumed active low
     DigitalOut * m_wake;            ///< GSL1680 wake pin
+    uint8_t spiBlock[RA8875_SPI_BLOCKSIZE]; ///< staging buffer for block transfers
+    int spiBlockCount;              ///< number of bytes presently in spiBlock
+    uint8_t regShadow[256];         ///< last value written to, or read from, each register
+    uint32_t regShadowValid[8];     ///< one bit per register, set when regShadow holds its value
+    uint8_t regSelected;            ///< register most recently selected by WriteCommand
+    #ifdef RA8875_ASYNC_SPI
+    uint8_t asyncBlock[2][RA8875_ASYNC_BLOCKSIZE]; ///< staging buffers for non-blocking streams
+    int asyncFill;                  ///< index of the staging buffer being filled
+    volatile bool asyncBusy;        ///< a non-blocking transfer is in progress
+    bool asyncFrames16;             ///< the bus is in 16-bit frames, for pixelStreamInPlace
+    #endif
+    CompletionPin_T * m_intPin;     ///< RA8875 INT pin, for the BTE complete interrupt, or NULL
+    CompletionPin_T * m_waitPin;    ///< RA8875 WAIT pin, for the draw engine, or NULL
+    CompletionPin_T * m_vsyncPin;   ///< panel VSYNC line, for Present, or NULL
+    bool frameActive;               ///< a frame is begun and not yet presented
+    bool frameSynced;               ///< the layers were made the same, for double buffering
+    uint8_t frameLayer;             ///< the hidden layer the frame is drawn on
+    DirtyRegion frameDirty;         ///< what the frame changed, to copy to the other layer
+    TextScroll_T textScroll;        ///< what the text does at the bottom of the window
+    rect_t scrollWindow;            ///< the hardware scroll window, a whole number of lines
+    bool scrollRolled;              ///< the text has filled the hardware scroll window once
+    bool textCursorKnown;           ///< cursor_x and cursor_y are where the internal font text cursor is
+    uint32_t userGlyph[8];          ///< a bit for each character code drawn from CGRAM
+    GlyphCache glyphCache;          ///< the user font glyphs, packed for the color expansion
+    #ifdef RA8875_RTOS_WAIT
+    EventFlags completionFlags;     ///< set by the pin interrupts, to wake a waiting thread
+    #endif
+    #ifdef RA8875_IRQ_WAIT
+    volatile uint32_t completionFlags;  ///< set by the pin interrupts, to end the sleep
+    Timeout completionTimeout;      ///< ends the sleep when a pin does not interrupt
+    #endif
+    bool deferWait;                 ///< primitives defer their graphics engine wait
+    uint8_t deferReg;               ///< register for the deferred wait, or 0 for the status register
+    uint8_t deferMask;              ///< bit mask for the deferred wait, or 0 when none is pending
+    bool deferFailed;               ///< a deferred wait ended in a timeout or abort since the last flush
     
     // display metrics to avoid lengthy spi read queries
     uint8_t screenbpp;              ///< configured bits per pixel
@@ -3264,7 +4281,7 @@ private:
     uint8_t extFontHeight;          ///< computed from the font table when the user sets the font
     uint8_t extFontWidth;           ///< computed from the font table when the user sets the font
     
-    loc_t cursor_x, cursor_y;       ///< used for external fonts only
+    loc_t cursor_x, cursor_y;       ///< the text cursor, for external fonts, and for the internal font while textCursorKnown
     
     #ifdef PERF_METRICS
     typedef enum
@@ -3284,10 +4301,30 @@ private:
         PRF_BLOCKMOVE,
         METRICCOUNT
     } method_e;
-    unsigned long metrics[METRICCOUNT];
+    /// The latency histogram of a method, with 4 log-spaced buckets per
+    /// octave of uS, as described at @ref PerformanceSnapshot.
+    typedef struct {
+        uint32_t calls;                 ///< number of calls
+        uint32_t max_usec;              ///< the longest call
+        uint32_t bytes;                 ///< bus bytes of all calls
+        uint32_t transactions;          ///< bus transactions of all calls
+        uint32_t buckets[PERF_BUCKETS]; ///< calls counted by time
+    } PerfHistogram_T;
+    PerfHistogram_T perfHistogram[METRICCOUNT];
     unsigned long idletime_usec;
+    unsigned long deferredWaits;        ///< number of deferred graphics engine waits
+    unsigned long deferredOverlap_usec; ///< time from each deferral to its wait, the most engine time hidden
+    unsigned long deferredWait_usec;    ///< engine time still waited for when deferred
     void RegisterPerformance(method_e method);
     Timer performance;
+    void MarkPerformance(void);
+    uint32_t markBytes;                 ///< bus bytes when the present method began
+    uint32_t markTransactions;          ///< bus transactions when the present method began
+    #ifdef RA8875_SIMULATED_SPI
+    uint64_t markPredicted_ns;          ///< predicted bus time when the present method began
+    uint64_t methodPredicted_ns[METRICCOUNT]; ///< predicted time on the target of each method, in total
+    #endif
+    Timer deferTimer;                   ///< time since the last deferred engine start
     #endif
     
     RetCode_t _printCallback(RA8875::filecmd_t cmd, uint8_t * buffer, uint16_t size);
@@ -3310,6 +4347,7 @@ private:
     FPointerDummy  *obj_callback;
     RetCode_t (FPointerDummy::*method_callback)(filecmd_t cmd, uint8_t * buffer, uint16_t size);
     RetCode_t (* idle_callback)(IdleReason_T reason, uint16_t param);
+    StreamCallback_T stream_callback;
 };
 
 
@@ -3346,6 +4384,74 @@ extern "C" void mbed_reset();
 void RunTestSet(RA8875 & lcd, Serial & pc);
 
 
+/// Run the benchmark suite, and report the results as CSV or JSON.
+///
+/// Each scene - fills, internal and external font text, that text composed
+/// on a @ref Canvas, a frame drawn by the @ref StripRenderer, pixel and BTE
+/// blits, JPEG and GIF decode, PrintScreen and touch polling - is run for
+/// the given number of iterations. For each scene the report gives the
+/// min, median and 99th percentile time, the bytes and SPI transactions of
+/// one iteration, and a status, which is nonzero where the scene could not
+/// run (as when an image file is missing). In a host build, it also gives
+/// the time predicted on the target by the emulator.
+///
+/// The JPEG and GIF scenes render path/bench.jpg and path/bench.gif.
+///
+/// @param[in] lcd is a reference to the display class.
+/// @param[in] pc is a reference to a serial interface, for the report.
+/// @param[in] iterations is the number of times to run each scene.
+/// @param[in] json is true for a JSON report, and false for CSV.
+/// @param[in] path is the directory of the image files.
+///
+void BenchmarkSuite(RA8875 & lcd, Serial & pc, int iterations = 20, bool json = false,
+    const char * path = "/local");
+
+
+#ifdef RA8875_SIMULATED_SPI
+#include "RA8875_Emulator.h"
+
+#define HEADLESS_SCENES 14          ///< the scenes RunHeadlessTestSet runs
+
+/// The measures of one scene of @ref RunHeadlessTestSet.
+///
+typedef struct {
+    char scene;                 ///< the RunTest code of the scene
+    uint32_t bytes;             ///< bytes sent to the controller
+    uint32_t transactions;      ///< SPI transactions
+    uint32_t predicted_us;      ///< time the timing model predicts on the target
+} HeadlessScene_T;
+
+/// Run the test scenes that need no input, against the emulator, in a
+/// host build.
+///
+/// Each scene is written to path/scene_NN.ppm, numbered in the order run,
+/// and the bytes and transactions the scene sent to the controller are
+/// reported, with the time the timing model of the emulator predicts it
+/// would take on the target.
+///
+/// @code
+///     RA8875 lcd(p5, p6, p7, p12, NC, "tft");
+///     RA8875_Emulator emu;
+///
+///     emu.Attach(lcd.Bus());
+///     lcd.init(480, 272, 16);
+///     RunHeadlessTestSet(lcd, emu, pc, "out");
+/// @endcode
+///
+/// @param[in] lcd is a reference to the display class.
+/// @param[in] emu is a reference to the emulator attached to it.
+/// @param[in] pc is a reference to a serial interface, for the report.
+/// @param[in] path is the directory for the images.
+/// @param[out] results is where the measures of the HEADLESS_SCENES scenes
+///     are written, in the order run, or NULL.
+/// @returns @ref RetCode_t value; file_not_found if an image could not be
+///     written.
+///
+RetCode_t RunHeadlessTestSet(RA8875 & lcd, RA8875_Emulator & emu, Serial & pc, const char * path,
+    HeadlessScene_T * results = NULL);
+#endif
+
+
 // To enable the test code, uncomment this section, or copy the
 // necessary pieces to your "main()".
 //
@@ -0,0 +1,282 @@
+/// @page RA8875_Bus_Page Display Bus
+///
+/// The RA8875 driver reaches the controller through a bus class, which is
+/// chosen when the library is compiled. There is no virtual interface, so
+/// the byte and block transfers used by the pixel loops are inlined for
+/// the one bus in use.
+///
+/// Each bus class offers the same small set of methods:
+/// - format(bits, mode) and frequency(hz), to configure the bus.
+/// - select(bool), to assert (true) or release (false) the chip select.
+/// - write(value), to exchange a byte.
+/// - write(tx, txLength, rx, rxLength), to exchange a block, as the mbed SPI does.
+/// - transfer(tx, txLength, rx, rxLength, callback), to start a non-blocking
+///   transfer, where RA8875_ASYNC_SPI is defined.
+/// - transfer16(tx, count, callback), to start a non-blocking transfer of
+///   count 16-bit frames, each from its most significant byte, once the
+///   format is 16 bits; so RGB565 pixels are sent from where they are.
+/// - Bytes() and Transactions(), the number of bytes exchanged and of chip
+///   selects asserted, for the benchmarks.
+///
+/// The buses are:
+/// - @ref RA8875_SPIBus, the mbed SPI with a DigitalOut chip select, which is the default.
+/// - @ref RA8875_SimBus, the simulated SPI bus with a model of the controller
+///   attached, for a host build (RA8875_SIMULATED_SPI).
+/// - @ref RA8875_MockBus, which records every byte, and replies with a fixed value.
+///
+/// Another bus is chosen by defining RA8875_BUS as its class name, as in
+/// -DRA8875_BUS=RA8875_MockBus. A faster transport may be added as another
+/// class with the same methods.
+///
+#ifndef RA8875_BUS_H
+#define RA8875_BUS_H
+#include <mbed.h>
+
+#ifdef RA8875_SIMULATED_SPI
+#include "SimSPI.h"
+#endif
+
+
+/// The mbed SPI bus, with the chip select on a DigitalOut pin.
+///
+class RA8875_SPIBus
+{
+public:
+    /// Constructor for the SPI bus.
+    ///
+    /// @param[in] mosi is the SPI output pin.
+    /// @param[in] miso is the SPI input pin.
+    /// @param[in] sclk is the SPI clock pin.
+    /// @param[in] csel is the chip select pin, which is active low.
+    ///
+    RA8875_SPIBus(PinName mosi, PinName miso, PinName sclk, PinName csel)
+        : spi(mosi, miso, sclk), cs(csel), bytes(0), transactions(0) { }
+
+    // The bus methods, as described above.
+    void format(int bits, int mode = 0) { spi.format(bits, mode); }
+    void frequency(int hz) { spi.frequency(hz); }
+    void select(bool chipsel) {
+        if (chipsel)
+            transactions++;
+        cs = (chipsel) ? 0 : 1;
+    }
+    int write(int value) {
+        bytes++;
+        return spi.write(value);
+    }
+    int write(const char * tx, int txLength, char * rx, int rxLength) {
+        bytes += (txLength > rxLength) ? txLength : rxLength;
+        return spi.write(tx, txLength, rx, rxLength);
+    }
+    #if DEVICE_SPI_ASYNCH
+    int transfer(const uint8_t * tx, int txLength, uint8_t * rx, int rxLength,
+        const event_callback_t & callback) {
+        int ret = spi.transfer(tx, txLength, rx, rxLength, callback);
+
+        if (ret == 0)               // a refused transfer is counted by the write sending it
+            bytes += (txLength > rxLength) ? txLength : rxLength;
+        return ret;
+    }
+    int transfer16(const uint16_t * tx, int count, const event_callback_t & callback) {
+        int ret = spi.transfer(tx, count * 2, (uint16_t *)NULL, 0, callback);
+
+        if (ret == 0)
+            bytes += count * 2;
+        return ret;
+    }
+    #endif
+    uint32_t Bytes(void) { return bytes; }
+    uint32_t Transactions(void) { return transactions; }
+
+private:
+    SPI spi;                        ///< spi port
+    DigitalOut cs;                  ///< chip select pin, assumed active low
+    uint32_t bytes;                 ///< bytes exchanged
+    uint32_t transactions;          ///< chip selects asserted
+};
+
+
+#ifdef RA8875_SIMULATED_SPI
+/// The simulated SPI bus, for a host build.
+///
+/// The model of the controller is attached with @ref SimSPI::AttachDevice,
+/// and is told of each change of the chip select as well as each byte.
+///
+class RA8875_SimBus : public SimSPI
+{
+public:
+    /// Constructor for the simulated bus.
+    ///
+    /// @param[in] mosi is the SPI output pin, which is ignored.
+    /// @param[in] miso is the SPI input pin, which is ignored.
+    /// @param[in] sclk is the SPI clock pin, which is ignored.
+    /// @param[in] csel is the chip select pin, which is ignored.
+    ///
+    RA8875_SimBus(int mosi, int miso, int sclk, int csel) : SimSPI(mosi, miso, sclk) { (void)csel; }
+
+    /// Start a non-blocking transfer of 16-bit frames, see @ref SimSPI::format.
+    ///
+    /// @param[in] tx is the frames to write.
+    /// @param[in] count is the number of frames.
+    /// @param[in] callback is invoked from the worker thread on completion.
+    /// @returns zero if the transfer was started, or -1 if the bus is busy.
+    ///
+    int transfer16(const uint16_t * tx, int count, const event_callback_t & callback) {
+        return transfer((const uint8_t *)tx, count * 2, (uint8_t *)NULL, 0, callback);
+    }
+
+    /// Get the number of bytes exchanged.
+    ///
+    /// @returns the number of bytes.
+    ///
+    uint32_t Bytes(void) { return BytesTransferred(); }
+};
+#endif
+
+
+/// A bus that records every byte sent to it, for checking the traffic
+/// of the driver without a controller.
+///
+/// Every byte read from it is the reply value (see @ref SetReply), which
+/// is zero by default, so that busy flags read as idle.
+///
+/// @code
+///     uint8_t trace[4096];
+///
+///     lcd.Bus().Record(trace, sizeof(trace));
+///     lcd.line(0,0, 100,100);
+///     printf("%u bytes in %u transactions\r\n", lcd.Bus().Bytes(), lcd.Bus().Transactions());
+/// @endcode
+///
+class RA8875_MockBus
+{
+public:
+    /// Constructor for the mock bus.
+    ///
+    /// The pin parameters are accepted for interface compatibility, and are
+    /// otherwise ignored.
+    ///
+    /// @param[in] mosi is the SPI output pin.
+    /// @param[in] miso is the SPI input pin.
+    /// @param[in] sclk is the SPI clock pin.
+    /// @param[in] csel is the chip select pin.
+    ///
+    RA8875_MockBus(PinName mosi, PinName miso, PinName sclk, PinName csel)
+        : m_record(NULL), m_size(0), m_count(0), m_bytes(0), m_transactions(0),
+          m_selected(false), m_reply(0), m_hz(0) {
+        (void)mosi; (void)miso; (void)sclk; (void)csel;
+    }
+
+    void format(int bits, int mode = 0) { (void)bits; (void)mode; }
+    void frequency(int hz) { m_hz = hz; }
+    void select(bool chipsel) {
+        if (chipsel && !m_selected)
+            m_transactions++;
+        m_selected = chipsel;
+    }
+    int write(int value) {
+        _record(value);
+        return m_reply;
+    }
+    int write(const char * tx, int txLength, char * rx, int rxLength) {
+        int total = (txLength > rxLength) ? txLength : rxLength;
+
+        for (int i=0; i<total; i++) {
+            _record((i < txLength) ? tx[i] : 0xFF);
+            if (i < rxLength)
+                rx[i] = m_reply;
+        }
+        return total;
+    }
+    #ifdef RA8875_ASYNC_SPI
+    /// Non-blocking transfers complete at once, calling back before returning.
+    int transfer(const uint8_t * tx, int txLength, uint8_t * rx, int rxLength,
+        const event_callback_t & callback) {
+        write((const char *)tx, txLength, (char *)rx, rxLength);
+        if (callback)
+            callback.call(SPI_EVENT_COMPLETE);
+        return 0;
+    }
+    int transfer16(const uint16_t * tx, int count, const event_callback_t & callback) {
+        for (int i=0; i<count; i++) {
+            _record(tx[i] >> 8);
+            _record(tx[i] & 0xFF);
+        }
+        if (callback)
+            callback.call(SPI_EVENT_COMPLETE);
+        return 0;
+    }
+    #endif
+
+    /// Set where to record the bytes, which also clears the counts.
+    ///
+    /// Recording stops when the buffer is full, but the counts go on.
+    ///
+    /// @param[in] buffer is where to record the bytes, or NULL to only count them.
+    /// @param[in] size is the size of the buffer.
+    ///
+    void Record(uint8_t * buffer, uint32_t size) {
+        m_record = buffer;
+        m_size = size;
+        m_count = m_bytes = m_transactions = 0;
+    }
+
+    /// Set the value returned for every byte read.
+    ///
+    /// @param[in] reply is the value.
+    ///
+    void SetReply(uint8_t reply) { m_reply = reply; }
+
+    /// Get the number of bytes recorded in the buffer.
+    ///
+    /// @returns the number of bytes recorded.
+    ///
+    uint32_t Recorded(void) { return m_count; }
+
+    /// Get the number of bytes exchanged.
+    ///
+    /// @returns the number of bytes.
+    ///
+    uint32_t Bytes(void) { return m_bytes; }
+
+    /// Get the number of transactions, which is the number of times the
+    /// chip select was asserted.
+    ///
+    /// @returns the number of transactions.
+    ///
+    uint32_t Transactions(void) { return m_transactions; }
+
+    /// Get the last frequency set.
+    ///
+    /// @returns the frequency in hertz.
+    ///
+    int Frequency(void) { return m_hz; }
+
+private:
+    void _record(uint8_t value) {
+        if (m_count < m_size)
+            m_record[m_count++] = value;
+        m_bytes++;
+    }
+
+    uint8_t * m_record;             ///< where to record the bytes
+    uint32_t m_size;                ///< size of the record buffer
+    uint32_t m_count;               ///< bytes in the record buffer
+    uint32_t m_bytes;               ///< bytes exchanged
+    uint32_t m_transactions;        ///< chip selects asserted
+    bool m_selected;                ///< chip select is asserted
+    uint8_t m_reply;                ///< value returned for every byte read
+    int m_hz;                       ///< last frequency set
+};
+
+
+// Choose the bus.
+#ifndef RA8875_BUS
+#ifdef RA8875_SIMULATED_SPI
+#define RA8875_BUS RA8875_SimBus
+#else
+#define RA8875_BUS RA8875_SPIBus
+#endif
+#endif
+
+#endif // RA8875_BUS_H
@@ -0,0 +1,781 @@
+// RA8875 Emulator.
+//
+// See the RA8875_Emulator.h file for full details. This is only compiled
+// when RA8875_SIMULATED_SPI is defined, as for a host build.
+//
+#include "RA8875_Emulator.h"
+
+#ifdef RA8875_SIMULATED_SPI
+
+#include <algorithm>
+#include "BPG_Arial08x08.h"
+
+//#define DEBUG "EMU_"
+// ...
+// INFO("Stuff to show %d", var); // new-line is automatically appended
+//
+#if (defined(DEBUG) && !defined(TARGET_LPC11U24))
+#define INFO(x, ...) std::printf("[INF %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define WARN(x, ...) std::printf("[WRN %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define ERR(x, ...)  std::printf("[ERR %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#else
+#define INFO(x, ...)
+#define WARN(x, ...)
+#define ERR(x, ...)
+#endif
+
+
+// The raster operations of the BTE, on source s and destination d.
+static uint16_t Rop(uint8_t rop, uint16_t s, uint16_t d)
+{
+    switch (rop & 0x0F) {
+        case 0x0: return 0;
+        case 0x1: return ~(s | d);
+        case 0x2: return ~s & d;
+        case 0x3: return ~s;
+        case 0x4: return s & ~d;
+        case 0x5: return ~d;
+        case 0x6: return s ^ d;
+        case 0x7: return ~(s & d);
+        case 0x8: return s & d;
+        case 0x9: return ~(s ^ d);
+        case 0xA: return d;
+        case 0xB: return ~s | d;
+        case 0xC: return s;
+        case 0xD: return s | ~d;
+        case 0xE: return s | d;
+        default:  return 0xFFFF;
+    }
+}
+
+
+// The default costs of the timing model. The host costs are measured on a
+// K64F, and the engine costs are about 2 system clocks a pixel, with a read
+// as well as a write for the BTE, at 60 MHz.
+static const RA8875_EmuTiming_T DefaultTiming = {
+    1000,                           // select_ns
+    500,                            // command_ns
+    34,                             // pixel_ns
+    67,                             // bte_pixel_ns
+};
+
+
+static bool InEllipse(int dx, int dy, int a, int b)
+{
+    return (int64_t)dx * dx * b * b + (int64_t)dy * dy * a * a <= (int64_t)a * a * b * b;
+}
+
+
+static bool InRoundRect(int x, int y, int x1, int y1, int x2, int y2, int a, int b)
+{
+    if (x < x1 || x > x2 || y < y1 || y > y2)
+        return false;
+    if (a <= 0 || b <= 0)
+        return true;
+    if (x < x1 + a && y < y1 + b)
+        return InEllipse(x - (x1 + a), y - (y1 + b), a, b);
+    if (x > x2 - a && y < y1 + b)
+        return InEllipse(x - (x2 - a), y - (y1 + b), a, b);
+    if (x < x1 + a && y > y2 - b)
+        return InEllipse(x - (x1 + a), y - (y2 - b), a, b);
+    if (x > x2 - a && y > y2 - b)
+        return InEllipse(x - (x2 - a), y - (y2 - b), a, b);
+    return true;
+}
+
+
+static int Edge(int ax, int ay, int bx, int by, int px, int py)
+{
+    return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+
+RA8875_Emulator::RA8875_Emulator()
+{
+    for (int l=0; l<2; l++)
+        m_layer[l] = (uint16_t *)calloc(RA8875_EMU_MEMWIDTH * RA8875_EMU_MEMHEIGHT, sizeof(uint16_t));
+    m_intPin = -1;
+    m_state = cycle;
+    m_selected = 0;
+    m_hiByte = 0;
+    m_phase = 0;
+    m_transactions = 0;
+    m_bytes = 0;
+    m_bus = NULL;
+    m_timing = DefaultTiming;
+    m_busyUntil_ns = 0;
+    m_pixels = 0;
+    _reset();
+}
+
+
+RA8875_Emulator::~RA8875_Emulator()
+{
+    for (int l=0; l<2; l++)
+        free(m_layer[l]);
+}
+
+
+void RA8875_Emulator::Attach(SimSPI & bus)
+{
+    bus.AttachDevice(&RA8875_Emulator::_exchange, this, &RA8875_Emulator::_chipSelect);
+    m_bus = &bus;
+    m_busyUntil_ns = 0;
+}
+
+
+uint64_t RA8875_Emulator::PredictedTime_ns(void)
+{
+    return (m_bus) ? m_bus->PredictedTime_ns() : 0;
+}
+
+
+void RA8875_Emulator::SetInterruptPin(int pin)
+{
+    m_intPin = pin;
+    _updateInterrupt();
+}
+
+
+uint16_t RA8875_Emulator::Pixel(int layer, int x, int y)
+{
+    uint16_t * p = _mem(layer & 1, x, y);
+
+    return (p) ? *p : 0;
+}
+
+
+dim_t RA8875_Emulator::Width(void)
+{
+    return ((m_reg[0x14] & 0x7F) + 1) * 8;
+}
+
+
+dim_t RA8875_Emulator::Height(void)
+{
+    return (_reg16(0x19) & 0x1FF) + 1;
+}
+
+
+RetCode_t RA8875_Emulator::DumpPPM(const char * name)
+{
+    FILE * fh = fopen(name, "wb");
+    int w = Width();
+    int h = Height();
+    uint8_t mode = m_reg[0x52] & 0x07;
+    bool twoLayers = (m_reg[0x20] & 0x80) != 0;
+    uint16_t key = _colorTrio(0x67);
+    int weight1 = 8 - std::min(8, m_reg[0x53] & 0x0F);   // LTPR1, 0 is opaque and 8 is hidden
+    int weight2 = 8 - std::min(8, m_reg[0x53] >> 4);
+
+    if (!fh)
+        return file_not_found;
+    fprintf(fh, "P6\n%d %d\n255\n", w, h);
+    for (int y=0; y<h; y++) {
+        for (int x=0; x<w; x++) {
+            uint16_t p0 = Pixel(0, x, y);
+            uint16_t p1 = Pixel(1, x, y);
+            uint32_t rgb = _rgb(p0);
+            uint32_t rgb1 = _rgb(p1);
+
+            if (twoLayers) {
+                switch (mode) {
+                    case 1:                 // ShowLayer1
+                        rgb = rgb1;
+                        break;
+                    case 2:                 // LightenOverlay
+                        rgb = std::max(rgb & 0xFF0000, rgb1 & 0xFF0000)
+                            | std::max(rgb & 0x00FF00, rgb1 & 0x00FF00)
+                            | std::max(rgb & 0x0000FF, rgb1 & 0x0000FF);
+                        break;
+                    case 3:                 // TransparentMode
+                        if (p0 == key) {
+                            rgb = rgb1;
+                        } else {
+                            uint32_t mix = 0;
+                            for (int s=0; s<24; s+=8) {
+                                int ch = (((rgb >> s) & 0xFF) * weight1 + ((rgb1 >> s) & 0xFF) * weight2) / 8;
+                                mix |= std::min(ch, 255) << s;
+                            }
+                            rgb = mix;
+                        }
+                        break;
+                    case 4:                 // BooleanOR
+                        rgb = _rgb(p0 | p1);
+                        break;
+                    case 5:                 // BooleanAND
+                        rgb = _rgb(p0 & p1);
+                        break;
+                    default:                // ShowLayer0, and the floating window is not modelled
+                        break;
+                }
+            }
+            fputc(rgb >> 16, fh);
+            fputc(rgb >> 8, fh);
+            fputc(rgb, fh);
+        }
+    }
+    fclose(fh);
+    return noerror;
+}
+
+
+uint8_t RA8875_Emulator::_exchange(void * context, uint8_t mosi)
+{
+    return ((RA8875_Emulator *)context)->_byte(mosi);
+}
+
+
+void RA8875_Emulator::_chipSelect(void * context, bool selected)
+{
+    RA8875_Emulator * emu = (RA8875_Emulator *)context;
+
+    if (selected) {
+        emu->m_transactions++;
+        if (emu->m_bus) {
+            uint64_t now = emu->m_bus->PredictedTime_ns();
+            if (now < emu->m_busyUntil_ns)
+                emu->m_bus->Stall(emu->m_busyUntil_ns - now);     // waiting for the engine
+            emu->m_bus->Stall(emu->m_timing.select_ns);
+        }
+    }
+    emu->m_state = cycle;           // every transaction starts with a cycle type
+}
+
+
+uint8_t RA8875_Emulator::_byte(uint8_t mosi)
+{
+    m_bytes++;
+    switch (m_state) {
+        case cycle:
+            m_phase = 0;
+            switch (mosi & 0xC0) {
+                case 0x80:                                  // RS:1, RW:0
+                    m_state = command;
+                    if (m_bus)
+                        m_bus->Stall(m_timing.command_ns);
+                    break;
+                case 0x00: m_state = data_write; break;     // RS:0, RW:0
+                case 0x40: m_state = data_read; break;      // RS:0, RW:1
+                default:   m_state = status_read; break;    // RS:1, RW:1
+            }
+            return 0;
+        case command:
+            m_selected = mosi;
+            m_state = cycle;        // a data cycle may follow in the same transaction
+            return 0;
+        case data_write:
+            if (m_selected == 0x02 && m_expandLeft)
+                _expandWrite(mosi);
+            else if (m_selected == 0x02)
+                _memWrite(mosi);
+            else
+                _writeReg(m_selected, mosi);
+            return 0;
+        case data_read:
+            if (m_selected == 0x02)
+                return _memRead();
+            return _readReg(m_selected + m_phase++);    // as ReadDataW reads the pair
+        case status_read:
+        default:
+            return 0x00;            // never busy
+    }
+}
+
+
+void RA8875_Emulator::_reset(void)
+{
+    memset(m_reg, 0, sizeof(m_reg));
+    m_expandLeft = 0;
+    _setReg16(0x34, RA8875_EMU_MEMWIDTH - 1);   // the active window is all of memory
+    _setReg16(0x36, RA8875_EMU_MEMHEIGHT - 1);
+    _updateInterrupt();
+}
+
+
+void RA8875_Emulator::_writeReg(uint8_t reg, uint8_t data)
+{
+    if (reg == 0x01 && (data & 0x01)) {
+        _reset();                   // software reset
+    } else if (reg == 0xF1) {
+        m_reg[reg] &= ~data;        // interrupt flags are cleared by writing 1
+        _updateInterrupt();
+        return;
+    }
+    m_reg[reg] = data;
+    switch (reg) {
+        case 0x50:
+            if (data & 0x80)
+                _bte();
+            break;
+        case 0x8E:
+            if (data & 0x80)
+                _memoryClear();
+            break;
+        case 0x90:
+            if (data & 0xC0)
+                _drawEngine();
+            break;
+        case 0xA0:
+            if (data & 0x80)
+                _ellipseEngine();
+            break;
+        case 0xF0:
+            _updateInterrupt();
+            break;
+    }
+}
+
+
+uint8_t RA8875_Emulator::_readReg(uint8_t reg)
+{
+    return m_reg[reg];
+}
+
+
+void RA8875_Emulator::_updateInterrupt(void)
+{
+    if (m_intPin >= 0)
+        SimInterruptIn::Drive(m_intPin, (m_reg[0xF0] & m_reg[0xF1] & 0x1E) ? 0 : 1);
+}
+
+
+int RA8875_Emulator::_writeLayer(void)
+{
+    return (m_reg[0x20] & 0x80) ? (m_reg[0x41] & 0x01) : 0;
+}
+
+
+uint16_t RA8875_Emulator::_colorTrio(uint8_t reg)
+{
+    if (_is16bpp())
+        return ((m_reg[reg] & 0x1F) << 11) | ((m_reg[reg+1] & 0x3F) << 5) | (m_reg[reg+2] & 0x1F);
+    else
+        return ((m_reg[reg] & 0x07) << 5) | ((m_reg[reg+1] & 0x07) << 2) | (m_reg[reg+2] & 0x03);
+}
+
+
+uint16_t * RA8875_Emulator::_mem(int layer, int x, int y)
+{
+    if (x < 0 || x >= RA8875_EMU_MEMWIDTH || y < 0 || y >= RA8875_EMU_MEMHEIGHT || !m_layer[layer])
+        return NULL;
+    return &m_layer[layer][y * RA8875_EMU_MEMWIDTH + x];
+}
+
+
+// Advance the memory write (0x46) or read (0x4A) cursor, left to right and
+// then top to bottom, within the active window.
+void RA8875_Emulator::_advance(uint8_t reg)
+{
+    int x = _reg16(reg) + 1;
+    int y = _reg16(reg+2);
+
+    if (x > _reg16(0x34)) {
+        x = _reg16(0x30);
+        if (++y > _reg16(0x36))
+            y = _reg16(0x32);
+    }
+    _setReg16(reg, x);
+    _setReg16(reg+2, y);
+}
+
+
+void RA8875_Emulator::_memWrite(uint8_t data)
+{
+    uint16_t c;
+    uint16_t * p;
+
+    if (m_reg[0x40] & 0x80) {
+        _text(data);
+        return;
+    }
+    if (m_reg[0x41] & 0x0C)
+        return;                     // the cursor and pattern memories are not modelled
+    if (_is16bpp()) {
+        if ((m_phase++ & 1) == 0) {
+            m_hiByte = data;        // the high byte is written first
+            return;
+        }
+        c = (m_hiByte << 8) | data;
+    } else {
+        c = data;
+    }
+    p = _mem(_writeLayer(), _reg16(0x46), _reg16(0x48));
+    if (p)
+        *p = c;
+    _advance(0x46);
+}
+
+
+uint8_t RA8875_Emulator::_memRead(void)
+{
+    int dummy = (_is16bpp()) ? 2 : 1;
+    uint16_t * p;
+    uint16_t c;
+
+    if (m_phase < dummy) {
+        m_phase++;                  // the dummy reads that prime the read
+        return 0;
+    }
+    p = _mem(_writeLayer(), _reg16(0x4A), _reg16(0x4C));
+    c = (p) ? *p : 0;
+    if (!_is16bpp()) {
+        _advance(0x4A);
+        return c;
+    }
+    if (((m_phase++ - dummy) & 1) == 0)
+        return c & 0xFF;            // the low byte is read first
+    _advance(0x4A);
+    return c >> 8;
+}
+
+
+// Plot a pixel of the geometry or text engines, which are limited to
+// the active window.
+void RA8875_Emulator::_plot(int x, int y, uint16_t c)
+{
+    uint16_t * p;
+
+    if (x < _reg16(0x30) || x > _reg16(0x34) || y < _reg16(0x32) || y > _reg16(0x36))
+        return;
+    m_pixels++;
+    p = _mem(_writeLayer(), x, y);
+    if (p)
+        *p = c;
+}
+
+
+void RA8875_Emulator::_hline(int x1, int x2, int y, uint16_t c)
+{
+    if (x1 > x2)
+        std::swap(x1, x2);
+    for (int x=x1; x<=x2; x++)
+        _plot(x, y, c);
+}
+
+
+void RA8875_Emulator::_line(int x1, int y1, int x2, int y2, uint16_t c)
+{
+    int dx = abs(x2 - x1), sx = (x1 < x2) ? 1 : -1;
+    int dy = -abs(y2 - y1), sy = (y1 < y2) ? 1 : -1;
+    int err = dx + dy;
+
+    for (;;) {
+        _plot(x1, y1, c);
+        if (x1 == x2 && y1 == y2)
+            break;
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x1 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
+
+
+void RA8875_Emulator::_triangle(int x1, int y1, int x2, int y2, int x3, int y3, bool fill, uint16_t c)
+{
+    if (fill) {
+        int left = std::min(x1, std::min(x2, x3)), right = std::max(x1, std::max(x2, x3));
+        int top = std::min(y1, std::min(y2, y3)), bottom = std::max(y1, std::max(y2, y3));
+
+        for (int y=top; y<=bottom; y++) {
+            for (int x=left; x<=right; x++) {
+                int e1 = Edge(x1, y1, x2, y2, x, y);
+                int e2 = Edge(x2, y2, x3, y3, x, y);
+                int e3 = Edge(x3, y3, x1, y1, x, y);
+                if ((e1 >= 0 && e2 >= 0 && e3 >= 0) || (e1 <= 0 && e2 <= 0 && e3 <= 0))
+                    _plot(x, y, c);
+            }
+        }
+    }
+    _line(x1, y1, x2, y2, c);
+    _line(x2, y2, x3, y3, c);
+    _line(x3, y3, x1, y1, c);
+}
+
+
+// An outline is the pixels of the filled shape with a 4-neighbour outside it.
+void RA8875_Emulator::_ellipse(int cx, int cy, int a, int b, bool fill, uint16_t c)
+{
+    for (int dy=-b; dy<=b; dy++) {
+        for (int dx=-a; dx<=a; dx++) {
+            if (!InEllipse(dx, dy, a, b))
+                continue;
+            if (fill || !InEllipse(dx-1, dy, a, b) || !InEllipse(dx+1, dy, a, b)
+            || !InEllipse(dx, dy-1, a, b) || !InEllipse(dx, dy+1, a, b))
+                _plot(cx + dx, cy + dy, c);
+        }
+    }
+}
+
+
+void RA8875_Emulator::_roundrect(int x1, int y1, int x2, int y2, int a, int b, bool fill, uint16_t c)
+{
+    for (int y=y1; y<=y2; y++) {
+        for (int x=x1; x<=x2; x++) {
+            if (!InRoundRect(x, y, x1, y1, x2, y2, a, b))
+                continue;
+            if (fill || !InRoundRect(x-1, y, x1, y1, x2, y2, a, b) || !InRoundRect(x+1, y, x1, y1, x2, y2, a, b)
+            || !InRoundRect(x, y-1, x1, y1, x2, y2, a, b) || !InRoundRect(x, y+1, x1, y1, x2, y2, a, b))
+                _plot(x, y, c);
+        }
+    }
+}
+
+
+// DCR (0x90) - line, rectangle, triangle and circle.
+void RA8875_Emulator::_drawEngine(void)
+{
+    uint8_t dcr = m_reg[0x90];
+    bool fill = (dcr & 0x20) != 0;
+    uint16_t c = _colorTrio(0x63);
+    int x1 = _reg16(0x91), y1 = _reg16(0x93);
+    int x2 = _reg16(0x95), y2 = _reg16(0x97);
+    uint32_t pixels = m_pixels;
+
+    if (dcr & 0x40) {
+        _ellipse(_reg16(0x99), _reg16(0x9B), m_reg[0x9D], m_reg[0x9D], fill, c);
+    } else if (dcr & 0x01) {
+        _triangle(x1, y1, x2, y2, _reg16(0xA9), _reg16(0xAB), fill, c);
+    } else if (dcr & 0x10) {
+        if (y1 > y2)
+            std::swap(y1, y2);
+        if (fill) {
+            for (int y=y1; y<=y2; y++)
+                _hline(x1, x2, y, c);
+        } else {
+            _hline(x1, x2, y1, c);
+            _hline(x1, x2, y2, c);
+            _line(x1, y1, x1, y2, c);
+            _line(x2, y1, x2, y2, c);
+        }
+    } else {
+        _line(x1, y1, x2, y2, c);
+    }
+    _busy(m_pixels - pixels, m_timing.pixel_ns);
+    m_reg[0x90] &= ~0xC0;           // done
+}
+
+
+// Ellipse and curve register (0xA0) - ellipse and rounded rectangle.
+void RA8875_Emulator::_ellipseEngine(void)
+{
+    uint8_t ell = m_reg[0xA0];
+    bool fill = (ell & 0x40) != 0;
+    uint16_t c = _colorTrio(0x63);
+    uint32_t pixels = m_pixels;
+
+    if (ell & 0x20) {
+        int x1 = _reg16(0x91), y1 = _reg16(0x93);
+        int x2 = _reg16(0x95), y2 = _reg16(0x97);
+        if (x1 > x2)
+            std::swap(x1, x2);
+        if (y1 > y2)
+            std::swap(y1, y2);
+        _roundrect(x1, y1, x2, y2, _reg16(0xA1), _reg16(0xA3), fill, c);
+    } else if (ell & 0x10) {
+        WARN("curves are not modelled");
+    } else {
+        _ellipse(_reg16(0xA5), _reg16(0xA7), _reg16(0xA1), _reg16(0xA3), fill, c);
+    }
+    _busy(m_pixels - pixels, m_timing.pixel_ns);
+    m_reg[0xA0] &= ~0x80;           // done
+}
+
+
+// MCLR (0x8E) - clear the full display, or the active window, to the background color.
+void RA8875_Emulator::_memoryClear(void)
+{
+    uint8_t mclr = m_reg[0x8E];
+    int x1 = 0, y1 = 0, x2 = Width() - 1, y2 = Height() - 1;
+    uint16_t c = _colorTrio(0x60);
+
+    if (mclr & 0x40) {
+        x1 = _reg16(0x30);
+        y1 = _reg16(0x32);
+        x2 = _reg16(0x34);
+        y2 = _reg16(0x36);
+    }
+    for (int y=y1; y<=y2; y++) {
+        for (int x=x1; x<=x2; x++) {
+            uint16_t * p = _mem(_writeLayer(), x, y);
+            if (p)
+                *p = c;
+        }
+    }
+    _busy((x2 - x1 + 1) * (y2 - y1 + 1), m_timing.pixel_ns);
+    m_reg[0x8E] &= ~0x80;           // done
+}
+
+
+// BECR0 (0x50), BECR1 (0x51) - the move and solid fill operations.
+void RA8875_Emulator::_bte(void)
+{
+    uint8_t op = m_reg[0x51] & 0x0F;
+    uint8_t rop = m_reg[0x51] >> 4;
+    int sx = _reg16(0x54) & 0x3FF, sy = _reg16(0x56) & 0x1FF, sl = _reg16(0x56) >> 15;
+    int dx = _reg16(0x58) & 0x3FF, dy = _reg16(0x5A) & 0x1FF, dl = _reg16(0x5A) >> 15;
+    int w = _reg16(0x5C), h = _reg16(0x5E);
+    int step = (op == 0x03) ? -1 : 1;       // the negative direction move starts at the bottom right
+    uint16_t fg = _colorTrio(0x63);
+    uint16_t mask = (_is16bpp()) ? 0xFFFF : 0x00FF;
+
+    if (!(m_reg[0x20] & 0x80))
+        sl = dl = 0;
+    if (op == 0x08 || op == 0x09) {
+        m_expandLeft = w * h;       // the pixels come with the memory writes that follow
+        if (m_expandLeft)
+            return;
+    }
+    for (int j=0; j<h; j++) {
+        for (int i=0; i<w; i++) {
+            uint16_t * s = _mem(sl, sx + step * i, sy + step * j);
+            uint16_t * d = _mem(dl, dx + step * i, dy + step * j);
+            if (!d)
+                continue;
+            switch (op) {
+                case 0x02:          // move in the positive direction, with ROP
+                case 0x03:          // move in the negative direction, with ROP
+                    if (s)
+                        *d = Rop(rop, *s, *d) & mask;
+                    break;
+                case 0x05:          // transparent move in the positive direction
+                    if (s && *s != fg)
+                        *d = *s;
+                    break;
+                case 0x0C:          // solid fill
+                    *d = fg;
+                    break;
+                default:
+                    WARN("BTE operation %X is not modelled", op);
+                    j = h;
+                    i = w;
+                    break;
+            }
+        }
+    }
+    _busy(w * h, m_timing.bte_pixel_ns);
+    m_reg[0x50] &= ~0x80;           // done
+    m_reg[0xF1] |= 0x02;            // BTE process complete
+    _updateInterrupt();
+}
+
+
+// A byte of the color expansion (op codes 0x8 and 0x9), from the start bit
+// in the ROP field down. The rest of the byte is dropped at the end of a row.
+void RA8875_Emulator::_expandWrite(uint8_t data)
+{
+    uint8_t op = m_reg[0x51] & 0x0F;
+    int dx = _reg16(0x58) & 0x3FF, dy = _reg16(0x5A) & 0x1FF, dl = _reg16(0x5A) >> 15;
+    int w = _reg16(0x5C), h = _reg16(0x5E);
+    uint16_t fg = _colorTrio(0x63);
+    uint16_t bg = _colorTrio(0x60);
+
+    if (!(m_reg[0x20] & 0x80))
+        dl = 0;
+    for (int b=(m_reg[0x51] >> 4) & 0x07; b>=0 && m_expandLeft; b--) {
+        int n = w * h - m_expandLeft--;
+        bool set = (data >> b) & 1;
+
+        if (set || op == 0x08) {
+            uint16_t * d = _mem(dl, dx + n % w, dy + n / w);
+            if (d)
+                *d = (set) ? fg : bg;
+        }
+        if (n % w == w - 1)
+            break;
+    }
+    if (m_expandLeft == 0) {
+        _busy(w * h, m_timing.bte_pixel_ns);
+        m_reg[0x50] &= ~0x80;       // done
+        m_reg[0xF1] |= 0x02;        // BTE process complete
+        _updateInterrupt();
+    }
+}
+
+
+// The internal font text engine, which draws at the text cursor, and
+// wraps at the right edge of the active window.
+void RA8875_Emulator::_text(uint8_t c)
+{
+    const unsigned char * font = BPG_Arial08x08;
+    uint16_t firstChar = font[3] * 256 + font[2];
+    uint16_t lastChar = font[5] * 256 + font[4];
+    int fontHeight = font[6];
+    int hs = ((m_reg[0x22] >> 2) & 0x03) + 1;
+    int vs = (m_reg[0x22] & 0x03) + 1;
+    int cw = 8 * hs, ch = 16 * vs;
+    bool transparent = (m_reg[0x22] & 0x40) != 0;
+    uint16_t fg = _colorTrio(0x63);
+    uint16_t bg = _colorTrio(0x60);
+    int x = _reg16(0x2A);
+    int y = _reg16(0x2C);
+    const unsigned char * glyph = NULL;
+    int glyphWidth = 0;
+
+    if (x + cw - 1 > _reg16(0x34)) {
+        x = _reg16(0x30);
+        y += ch + m_reg[0x29];      // FLDR, the line distance
+    }
+    if (c >= firstChar && c <= lastChar) {
+        int offset = 8 + 4 * (c - firstChar);
+        glyphWidth = std::min((int)font[offset], 8);
+        glyph = font + font[offset + 2] * 256 + font[offset + 1];
+    }
+    for (int row=0; row<16; row++) {
+        int fontRow = row * fontHeight / 16;
+        for (int col=0; col<8; col++) {
+            bool set = glyph && col < glyphWidth && (glyph[fontRow] & (1 << col));
+            if (!set && transparent)
+                continue;
+            for (int sy=0; sy<vs; sy++)
+                for (int sx=0; sx<hs; sx++)
+                    _plot(x + col * hs + sx, y + row * vs + sy, (set) ? fg : bg);
+        }
+    }
+    _busy(cw * ch, m_timing.pixel_ns);
+    x += cw + (m_reg[0x2E] & 0x3F); // FWTSET, the character spacing
+    _setReg16(0x2A, x);
+    _setReg16(0x2C, y);
+}
+
+
+// Mark the engine busy, for the time to touch the pixels, from now or from
+// the end of the work it already has, as with text sent in one stream.
+void RA8875_Emulator::_busy(uint32_t pixels, uint32_t ns)
+{
+    if (m_bus) {
+        uint64_t start = m_bus->PredictedTime_ns();
+
+        if (start < m_busyUntil_ns)
+            start = m_busyUntil_ns;
+        m_busyUntil_ns = start + (uint64_t)pixels * ns;
+    }
+}
+
+
+uint32_t RA8875_Emulator::_rgb(uint16_t c)
+{
+    uint8_t r, g, b;
+
+    if (_is16bpp()) {
+        r = (c >> 11) & 0x1F;
+        g = (c >> 5) & 0x3F;
+        b = c & 0x1F;
+        r = (r << 3) | (r >> 2);
+        g = (g << 2) | (g >> 4);
+        b = (b << 3) | (b >> 2);
+    } else {
+        r = ((c >> 5) & 0x07) * 255 / 7;
+        g = ((c >> 2) & 0x07) * 255 / 7;
+        b = (c & 0x03) * 85;
+    }
+    return (r << 16) | (g << 8) | b;
+}
+
+#endif // RA8875_SIMULATED_SPI
@@ -0,0 +1,222 @@
+/// @page RA8875_Emulator_Page RA8875 Emulator
+///
+/// A register level software model of the RA8875 controller, for a host
+/// build of the driver (RA8875_SIMULATED_SPI). It is attached to the
+/// simulated bus of a display object, after which the driver APIs work as
+/// they would on the target, with the results held in the display memory
+/// of the model. The visible image can then be written to a PPM file.
+///
+/// The model covers:
+/// - the register file, through the command, data and status cycles of
+///   the 4-wire SPI interface,
+/// - two display layers, and the layer display modes of LTPR0,
+/// - the memory write and read cursors, within the active window,
+/// - the geometry engine, for lines, rectangles, triangles, circles,
+///   ellipses and rounded rectangles, outlined or filled,
+/// - memory clear, of the full or the active window,
+/// - the BTE move (in either direction, and with transparency) and solid
+///   fill operations, with the 16 raster operations, and the color
+///   expansion of 1-bpp memory writes, with or without transparency,
+/// - the internal font text engine, with scaling, transparency, character
+///   and line spacing, and wrapping at the active window,
+/// - the BTE complete interrupt of INTC1 / INTC2, on a @ref SimInterruptIn.
+///
+/// Every operation completes at once, so the busy bits always read as idle.
+///
+/// Alongside the function is a timing model, to predict how long the
+/// traffic would take on the target. The bus charges each byte at the
+/// frequency set for it (see @ref SimSPI::PredictedTime_ns), and the model
+/// adds the overhead of each chip select and command, and the busy time of
+/// the engines, which is estimated from the pixels each operation touches.
+/// The busy time is charged when the next transaction begins, as the host
+/// must wait for the engine before it goes on. The costs are set with
+/// @ref SetTiming, and the defaults are for a K64F and an RA8875 at 60 MHz.
+///
+/// The controller font ROM is not reproduced. Text is drawn from the
+/// BPG_Arial08x08 font, doubled in height to fill the 8 x 16 cell, so the
+/// layout of text is true to the controller, but the shape of it is not.
+///
+/// @code
+///     RA8875 lcd(p5, p6, p7, p12, NC, "tft");
+///     RA8875_Emulator emu;
+///
+///     emu.Attach(lcd.Bus());
+///     lcd.init(480, 272, 16);
+///     lcd.fillrect(10,10, 100,100, Blue);
+///     emu.DumpPPM("frame.ppm");
+/// @endcode
+///
+#ifndef RA8875_EMULATOR_H
+#define RA8875_EMULATOR_H
+
+#ifdef RA8875_SIMULATED_SPI
+
+#include <mbed.h>
+#include "DisplayDefs.h"
+#include "SimSPI.h"
+
+#define RA8875_EMU_MEMWIDTH  1024   ///< display memory width, the range of a 10-bit x
+#define RA8875_EMU_MEMHEIGHT 512    ///< display memory height, the range of a 9-bit y
+
+/// The costs of the timing model, in nanoseconds.
+///
+typedef struct {
+    uint32_t select_ns;             ///< each chip select, with the host work around it
+    uint32_t command_ns;            ///< each command cycle, beyond its bytes
+    uint32_t pixel_ns;              ///< each pixel written by the geometry, clear or text engines
+    uint32_t bte_pixel_ns;          ///< each pixel of a BTE operation
+} RA8875_EmuTiming_T;
+
+/// A software model of the RA8875 controller.
+///
+class RA8875_Emulator
+{
+public:
+    /// Constructor, which allocates the display memory of both layers.
+    ///
+    RA8875_Emulator();
+
+    /// Destructor, which frees the display memory.
+    ///
+    ~RA8875_Emulator();
+
+    /// Attach the model to a simulated bus.
+    ///
+    /// @param[in,out] bus is the bus, typically lcd.Bus().
+    ///
+    void Attach(SimSPI & bus);
+
+    /// Set the costs of the timing model.
+    ///
+    /// @param[in] timing is the set of costs.
+    ///
+    void SetTiming(const RA8875_EmuTiming_T & timing) { m_timing = timing; }
+
+    /// Get the predicted time on the target of all the traffic so far.
+    ///
+    /// Take the difference across a frame, after @ref RA8875::flush, to
+    /// predict the frame time.
+    ///
+    /// @returns the predicted time in nanoseconds, or zero if not attached.
+    ///
+    uint64_t PredictedTime_ns(void);
+
+    /// Connect the INT output of the model to a simulated pin.
+    ///
+    /// @param[in] pin is the name of the pin given to @ref RA8875::CompletionInterruptInit.
+    ///
+    void SetInterruptPin(int pin);
+
+    /// Write the visible image to a binary PPM (P6) file.
+    ///
+    /// The image is the size of the configured display, and the layers are
+    /// combined as the layer display mode (LTPR0) selects.
+    ///
+    /// @param[in] name is the file name.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t DumpPPM(const char * name);
+
+    /// Get the value of a register.
+    ///
+    /// @param[in] reg is the register.
+    /// @returns the value.
+    ///
+    uint8_t Register(uint8_t reg) { return m_reg[reg]; }
+
+    /// Get a pixel from the display memory, as it is stored.
+    ///
+    /// @param[in] layer is 0 or 1.
+    /// @param[in] x is the horizontal position.
+    /// @param[in] y is the vertical position.
+    /// @returns the pixel, which is RGB565 in 16-bpp mode, and RGB332 in 8-bpp mode.
+    ///
+    uint16_t Pixel(int layer, int x, int y);
+
+    /// Get the configured display width.
+    ///
+    /// @returns the width in pixels.
+    ///
+    dim_t Width(void);
+
+    /// Get the configured display height.
+    ///
+    /// @returns the height in pixels.
+    ///
+    dim_t Height(void);
+
+    /// Get the number of chip selects seen, one for each bus transaction.
+    ///
+    /// @returns the number of transactions.
+    ///
+    uint32_t Transactions(void) { return m_transactions; }
+
+    /// Get the number of bytes seen.
+    ///
+    /// @returns the number of bytes.
+    ///
+    uint32_t Bytes(void) { return m_bytes; }
+
+private:
+    /// The state of the SPI interface, within one chip select.
+    typedef enum {
+        cycle,                      ///< expecting the cycle type byte
+        command,                    ///< expecting the register of a command write
+        data_write,                 ///< writing data to the selected register
+        data_read,                  ///< reading data from the selected register
+        status_read,                ///< reading the status register
+    } BusState_T;
+
+    static uint8_t _exchange(void * context, uint8_t mosi);
+    static void _chipSelect(void * context, bool selected);
+    uint8_t _byte(uint8_t mosi);
+
+    void _reset(void);
+    void _writeReg(uint8_t reg, uint8_t data);
+    uint8_t _readReg(uint8_t reg);
+    uint16_t _reg16(uint8_t reg) { return m_reg[reg] | (m_reg[reg+1] << 8); }
+    void _setReg16(uint8_t reg, uint16_t value) { m_reg[reg] = value & 0xFF; m_reg[reg+1] = value >> 8; }
+    void _updateInterrupt(void);
+
+    bool _is16bpp(void) { return (m_reg[0x10] & 0x08) != 0; }
+    int _writeLayer(void);
+    uint16_t _colorTrio(uint8_t reg);
+    uint16_t * _mem(int layer, int x, int y);
+    void _advance(uint8_t reg);
+    void _memWrite(uint8_t data);
+    uint8_t _memRead(void);
+
+    void _plot(int x, int y, uint16_t c);
+    void _hline(int x1, int x2, int y, uint16_t c);
+    void _line(int x1, int y1, int x2, int y2, uint16_t c);
+    void _triangle(int x1, int y1, int x2, int y2, int x3, int y3, bool fill, uint16_t c);
+    void _ellipse(int cx, int cy, int a, int b, bool fill, uint16_t c);
+    void _roundrect(int x1, int y1, int x2, int y2, int a, int b, bool fill, uint16_t c);
+    void _drawEngine(void);
+    void _ellipseEngine(void);
+    void _memoryClear(void);
+    void _bte(void);
+    void _expandWrite(uint8_t data);
+    void _text(uint8_t c);
+
+    void _busy(uint32_t pixels, uint32_t ns);
+    uint32_t _rgb(uint16_t c);
+
+    uint8_t m_reg[256];             ///< the register file
+    uint16_t * m_layer[2];          ///< the display memory of each layer
+    int m_intPin;                   ///< the simulated INT pin, or -1
+    BusState_T m_state;             ///< interface state
+    uint8_t m_selected;             ///< register selected by the last command write
+    uint8_t m_hiByte;               ///< first byte of a 16-bpp pixel write
+    int m_phase;                    ///< byte count within the present data cycle
+    uint32_t m_transactions;        ///< chip selects seen
+    uint32_t m_bytes;               ///< bytes seen
+    SimSPI * m_bus;                 ///< the bus attached to, for the timing model
+    RA8875_EmuTiming_T m_timing;    ///< the costs of the timing model
+    uint64_t m_busyUntil_ns;        ///< predicted time when the engine is idle
+    uint32_t m_pixels;              ///< pixels plotted by the engines
+    uint32_t m_expandLeft;          ///< pixels of a color expansion still to come
+};
+
+#endif // RA8875_SIMULATED_SPI
+#endif // RA8875_EMULATOR_H
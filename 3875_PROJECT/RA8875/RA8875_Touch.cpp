@@ -294,6 +294,7 @@ RetCode_t RA8875::TouchPanelCalibrate(const char * msg, tpMatrix_t * matrix, int
  */
 TouchCode_t RA8875::TouchPanelReadable(point_t * TouchPoint)
 {
+    TRACEAPI("TouchPanelReadable");
     TouchCode_t ts = no_touch;
 
     if (useTouchPanel == TP_FT5206) {
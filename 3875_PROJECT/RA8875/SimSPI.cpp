@@ -0,0 +1,203 @@
+// Simulated SPI Bus.
+//
+// See the SimSPI.h file for full details. This is only compiled when
+// RA8875_SIMULATED_SPI is defined, as for a host build.
+//
+#include "SimSPI.h"
+
+#ifdef RA8875_SIMULATED_SPI
+
+#include <time.h>
+
+SimSPI::SimSPI(int mosi, int miso, int sclk)
+{
+    (void)mosi;
+    (void)miso;
+    (void)sclk;
+    m_device = NULL;
+    m_select = NULL;
+    m_context = NULL;
+    m_hz = 1000000;
+    m_bits = 8;
+    m_bytes = 0;
+    m_selects = 0;
+    m_predicted_ps = 0;
+    m_transfers = 0;
+    m_stop = false;
+    m_pending = false;
+    pthread_mutex_init(&m_lock, NULL);
+    pthread_cond_init(&m_wake, NULL);
+    pthread_create(&m_thread, NULL, &SimSPI::_worker, this);
+}
+
+
+SimSPI::~SimSPI()
+{
+    pthread_mutex_lock(&m_lock);
+    m_stop = true;
+    pthread_cond_signal(&m_wake);
+    pthread_mutex_unlock(&m_lock);
+    pthread_join(m_thread, NULL);
+    pthread_cond_destroy(&m_wake);
+    pthread_mutex_destroy(&m_lock);
+}
+
+
+void SimSPI::format(int bits, int mode)
+{
+    (void)mode;
+    m_bits = bits;
+}
+
+
+void SimSPI::frequency(int hz)
+{
+    if (hz > 0)
+        m_hz = hz;
+}
+
+
+int SimSPI::write(int value)
+{
+    return _exchange(value);
+}
+
+
+int SimSPI::write(const char * tx_buffer, int tx_length, char * rx_buffer, int rx_length)
+{
+    int total = (tx_length > rx_length) ? tx_length : rx_length;
+
+    for (int i=0; i<total; i++) {
+        uint8_t in = _exchange((i < tx_length) ? tx_buffer[i] : 0xFF);
+        if (i < rx_length)
+            rx_buffer[i] = in;
+    }
+    return total;
+}
+
+
+int SimSPI::transfer(const void * tx_buffer, int tx_length, void * rx_buffer, int rx_length,
+    const event_callback_t & callback, int event)
+{
+    pthread_mutex_lock(&m_lock);
+    if (m_pending) {
+        pthread_mutex_unlock(&m_lock);
+        return -1;
+    }
+    m_tx = (const uint8_t *)tx_buffer;
+    m_txLength = tx_length;
+    m_txBits = m_bits;
+    m_rx = (uint8_t *)rx_buffer;
+    m_rxLength = rx_length;
+    m_callback = callback;
+    m_event = event;
+    m_pending = true;
+    pthread_cond_signal(&m_wake);
+    pthread_mutex_unlock(&m_lock);
+    return 0;
+}
+
+
+uint8_t SimSPI::_exchange(uint8_t mosi)
+{
+    m_bytes++;
+    m_predicted_ps += (uint64_t)8 * 1000000000000ULL / m_hz;
+    if (m_device)
+        return (*m_device)(m_context, mosi);
+    return 0;
+}
+
+
+// Take as long as the real bus would, 8 clocks per byte. Only the non-blocking
+// transfers are paced, since that is where the timing matters to the caller.
+void SimSPI::_clockOut(int count)
+{
+    uint64_t nsec = (uint64_t)count * 8 * 1000000000 / m_hz;
+    if (nsec) {
+        struct timespec ts;
+        ts.tv_sec = nsec / 1000000000;
+        ts.tv_nsec = nsec % 1000000000;
+        nanosleep(&ts, NULL);
+    }
+}
+
+
+void * SimSPI::_worker(void * arg)
+{
+    SimSPI * spi = (SimSPI *)arg;
+
+    pthread_mutex_lock(&spi->m_lock);
+    while (!spi->m_stop) {
+        if (!spi->m_pending) {
+            pthread_cond_wait(&spi->m_wake, &spi->m_lock);
+            continue;
+        }
+        pthread_mutex_unlock(&spi->m_lock);
+        spi->_clockOut((spi->m_txLength > spi->m_rxLength) ? spi->m_txLength : spi->m_rxLength);
+        if (spi->m_txBits == 16 && spi->m_rxLength == 0) {
+            const uint16_t * tx = (const uint16_t *)spi->m_tx;
+
+            for (int i=0; i<spi->m_txLength / 2; i++) {     // each frame from its top byte
+                spi->_exchange(tx[i] >> 8);
+                spi->_exchange(tx[i] & 0xFF);
+            }
+        } else {
+            spi->write((const char *)spi->m_tx, spi->m_txLength, (char *)spi->m_rx, spi->m_rxLength);
+        }
+        spi->m_transfers++;
+        event_callback_t callback = spi->m_callback;
+        int event = spi->m_event;
+        pthread_mutex_lock(&spi->m_lock);
+        spi->m_pending = false;
+        pthread_mutex_unlock(&spi->m_lock);
+        if (callback && (event & SPI_EVENT_COMPLETE))
+            callback.call(SPI_EVENT_COMPLETE);
+        pthread_mutex_lock(&spi->m_lock);
+    }
+    pthread_mutex_unlock(&spi->m_lock);
+    return NULL;
+}
+
+
+SimInterruptIn * SimInterruptIn::s_pins[SimInterruptIn::MAXPINS];
+
+
+SimInterruptIn::SimInterruptIn(int pin)
+{
+    m_pin = pin;
+    m_level = 1;
+    for (int i=0; i<MAXPINS; i++) {
+        if (s_pins[i] == NULL) {
+            s_pins[i] = this;
+            return;
+        }
+    }
+    error("SimInterruptIn: more than %d pins\r\n", MAXPINS);
+}
+
+
+SimInterruptIn::~SimInterruptIn()
+{
+    for (int i=0; i<MAXPINS; i++) {
+        if (s_pins[i] == this)
+            s_pins[i] = NULL;
+    }
+}
+
+
+void SimInterruptIn::Drive(int pin, int level)
+{
+    for (int i=0; i<MAXPINS; i++) {
+        SimInterruptIn * p = s_pins[i];
+
+        if (p && p->m_pin == pin && p->m_level != level) {
+            p->m_level = level;
+            if (level && p->m_rise)
+                p->m_rise.call();
+            else if (!level && p->m_fall)
+                p->m_fall.call();
+        }
+    }
+}
+
+#endif // RA8875_SIMULATED_SPI
@@ -0,0 +1,290 @@
+/// @page SimSPI_Copyright Simulated SPI Bus
+///
+/// A stand-in for the mbed SPI class, for building and exercising the
+/// RA8875 driver on a host (Linux) system, where there is no SPI hardware.
+///
+/// It offers the subset of the mbed SPI interface that the RA8875 driver
+/// uses - format, frequency, the single and block write methods, and the
+/// non-blocking transfer method - as well as the chip select. A non-blocking transfer is handed to a
+/// worker thread, which "clocks" the data out in the time the real bus
+/// would take, and then invokes the completion callback from that thread,
+/// in the same way as the SPI interrupt would on the target.
+///
+/// Alongside it is @ref SimInterruptIn, a stand-in for the mbed InterruptIn
+/// class, for the controller's INT and WAIT outputs.
+///
+/// This is only compiled when RA8875_SIMULATED_SPI is defined, which also
+/// switches the RA8875 driver to use these in place of the mbed classes.
+///
+#ifndef SIMSPI_H
+#define SIMSPI_H
+
+#ifdef RA8875_SIMULATED_SPI
+
+#include <mbed.h>
+#include <pthread.h>
+
+#ifndef SPI_EVENT_COMPLETE
+#define SPI_EVENT_COMPLETE    (1 << 2)
+#endif
+
+/// A simulated SPI bus, with a worker thread for non-blocking transfers.
+///
+class SimSPI
+{
+public:
+    /// The device callback
+    ///
+    /// This is called for every byte that crosses the simulated bus, so
+    /// that a model of the peripheral can observe the traffic and provide
+    /// the reply.
+    ///
+    /// @param[in] context is the pointer given to @ref AttachDevice.
+    /// @param[in] mosi is the byte written by the host.
+    /// @returns the byte the peripheral returns to the host.
+    ///
+    typedef uint8_t (* SimSPIDevice_T)(void * context, uint8_t mosi);
+
+    /// The device chip select callback
+    ///
+    /// This is called when the chip select changes, so that a model of the
+    /// peripheral can find the start and end of each transaction.
+    ///
+    /// @param[in] context is the pointer given to @ref AttachDevice.
+    /// @param[in] selected is true when the chip select is asserted.
+    ///
+    typedef void (* SimSPISelect_T)(void * context, bool selected);
+
+    /// Constructor for the simulated SPI bus.
+    ///
+    /// The pin parameters are accepted for interface compatibility with the
+    /// mbed SPI class, and are otherwise ignored.
+    ///
+    /// @param[in] mosi is the SPI output pin.
+    /// @param[in] miso is the SPI input pin.
+    /// @param[in] sclk is the SPI clock pin.
+    ///
+    SimSPI(int mosi, int miso, int sclk);
+
+    /// Destructor, which stops the worker thread.
+    ///
+    ~SimSPI();
+
+    /// Configure the data transmission format.
+    ///
+    /// With 16 bits a frame, a non-blocking transfer sends each 16-bit
+    /// element most significant byte first, as the target SPI does.
+    ///
+    /// @param[in] bits is the number of bits per frame.
+    /// @param[in] mode is the clock polarity and phase mode.
+    ///
+    void format(int bits, int mode = 0);
+
+    /// Set the bus frequency, which is used to compute the transfer time.
+    ///
+    /// @param[in] hz is the bus frequency in hertz.
+    ///
+    void frequency(int hz = 1000000);
+
+    /// Write a byte and return the reply, blocking.
+    ///
+    /// @param[in] value is the byte to write.
+    /// @returns the reply from the device.
+    ///
+    int write(int value);
+
+    /// Write and read a block, blocking.
+    ///
+    /// As with the mbed SPI, the total number of bytes exchanged is the
+    /// larger of tx_length and rx_length, and the tx side is padded with 0xFF.
+    ///
+    /// @param[in] tx_buffer is the data to write, which may be NULL if tx_length is zero.
+    /// @param[in] tx_length is the number of bytes to write.
+    /// @param[out] rx_buffer is where to put the reply, which may be NULL if rx_length is zero.
+    /// @param[in] rx_length is the number of bytes to read.
+    /// @returns the number of bytes exchanged.
+    ///
+    int write(const char * tx_buffer, int tx_length, char * rx_buffer, int rx_length);
+
+    /// Assert or release the chip select.
+    ///
+    /// @param[in] chipsel is true to assert it, and false to release it.
+    ///
+    void select(bool chipsel) {
+        if (chipsel)
+            m_selects++;
+        if (m_select)
+            (*m_select)(m_context, chipsel);
+    }
+
+    /// Start a non-blocking transfer.
+    ///
+    /// The buffers must remain valid until the callback is invoked.
+    ///
+    /// @param[in] tx_buffer is the data to write.
+    /// @param[in] tx_length is the number of elements to write.
+    /// @param[out] rx_buffer is where to put the reply, which may be NULL.
+    /// @param[in] rx_length is the number of elements to read.
+    /// @param[in] callback is invoked from the worker thread on completion.
+    /// @param[in] event is the set of events of interest.
+    /// @returns zero if the transfer was started, or -1 if the bus is busy.
+    ///
+    template<typename Type>
+    int transfer(const Type * tx_buffer, int tx_length, Type * rx_buffer, int rx_length,
+        const event_callback_t & callback, int event = SPI_EVENT_COMPLETE) {
+        return transfer((const void *)tx_buffer, tx_length * sizeof(Type),
+            (void *)rx_buffer, rx_length * sizeof(Type), callback, event);
+    }
+
+    /// Attach a model of the peripheral to the bus.
+    ///
+    /// @param[in] device is the callback, or NULL to detach.
+    /// @param[in] context is passed back to the callbacks.
+    /// @param[in] select is the optional chip select callback.
+    ///
+    void AttachDevice(SimSPIDevice_T device, void * context, SimSPISelect_T select = NULL) {
+        m_device = device;
+        m_context = context;
+        m_select = select;
+    }
+
+    /// Get the number of bytes that have crossed the bus.
+    ///
+    /// @returns the byte count.
+    ///
+    uint32_t BytesTransferred(void) { return m_bytes; }
+
+    /// Get the number of non-blocking transfers that have been completed.
+    ///
+    /// @returns the transfer count.
+    ///
+    uint32_t AsyncTransfers(void) { return m_transfers; }
+
+    /// Add time to the predicted bus time, for the peripheral model to
+    /// account for the time it holds up the host.
+    ///
+    /// @param[in] nsec is the time in nanoseconds.
+    ///
+    void Stall(uint32_t nsec) { m_predicted_ps += (uint64_t)nsec * 1000; }
+
+    /// Get the predicted bus time, which is the time the traffic so far
+    /// would take on the target.
+    ///
+    /// Each byte is charged 8 clocks at the frequency set when it was sent,
+    /// so the slower read rate is charged where it is used. The peripheral
+    /// model adds the rest with @ref Stall.
+    ///
+    /// @returns the predicted time in nanoseconds.
+    ///
+    uint64_t PredictedTime_ns(void) { return m_predicted_ps / 1000; }
+
+    /// Get the number of times the chip select was asserted, which is the
+    /// number of bus transactions.
+    ///
+    /// @returns the transaction count.
+    ///
+    uint32_t Transactions(void) { return m_selects; }
+
+private:
+    int transfer(const void * tx_buffer, int tx_length, void * rx_buffer, int rx_length,
+        const event_callback_t & callback, int event);
+    uint8_t _exchange(uint8_t mosi);
+    void _clockOut(int count);
+    static void * _worker(void * arg);
+
+    SimSPIDevice_T m_device;        ///< peripheral model, if any
+    SimSPISelect_T m_select;        ///< peripheral model chip select, if any
+    void * m_context;               ///< peripheral model context
+    int m_hz;                       ///< bus frequency, used to pace transfers
+    int m_bits;                     ///< bits per frame
+    volatile uint32_t m_bytes;      ///< total bytes exchanged
+    volatile uint32_t m_transfers;  ///< completed non-blocking transfers
+    volatile uint32_t m_selects;    ///< chip selects asserted
+    uint64_t m_predicted_ps;        ///< predicted bus time, in picoseconds
+
+    pthread_t m_thread;             ///< the worker which completes transfers
+    pthread_mutex_t m_lock;         ///< protects the pending transfer
+    pthread_cond_t m_wake;          ///< signals the worker
+    bool m_stop;                    ///< asks the worker to exit
+    bool m_pending;                 ///< a transfer is queued or in progress
+    const uint8_t * m_tx;           ///< pending transfer tx data
+    int m_txLength;                 ///< pending transfer tx length
+    int m_txBits;                   ///< pending transfer bits per frame
+    uint8_t * m_rx;                 ///< pending transfer rx data
+    int m_rxLength;                 ///< pending transfer rx length
+    event_callback_t m_callback;    ///< pending transfer completion
+    int m_event;                    ///< pending transfer events of interest
+};
+
+
+/// A simulated interrupt input pin.
+///
+/// The pin rests high. A model of the peripheral changes its level with
+/// @ref Drive, naming the pin as it is wired, and the rise or fall handler
+/// is then called from the model's thread, in the same way as the pin
+/// interrupt would be called on the target.
+///
+class SimInterruptIn
+{
+public:
+    /// Constructor for a simulated interrupt input.
+    ///
+    /// @param[in] pin is the name of the pin, which @ref Drive refers to.
+    ///
+    SimInterruptIn(int pin);
+
+    /// Destructor, which disconnects the pin from @ref Drive.
+    ///
+    ~SimInterruptIn();
+
+    /// Set the input pin mode, which is accepted and ignored.
+    ///
+    /// @param[in] pull is the pin mode.
+    ///
+    void mode(int pull) { (void)pull; }
+
+    /// Enable the interrupt, which is accepted and ignored.
+    ///
+    void enable_irq(void) { }
+
+    /// Disable the interrupt, which is accepted and ignored.
+    ///
+    void disable_irq(void) { }
+
+    /// Read the pin level.
+    ///
+    /// @returns 0 or 1.
+    ///
+    int read(void) { return m_level; }
+
+    /// Attach a function to call on the rising edge.
+    ///
+    /// @param[in] func is the function to call.
+    ///
+    void rise(Callback<void()> func) { m_rise = func; }
+
+    /// Attach a function to call on the falling edge.
+    ///
+    /// @param[in] func is the function to call.
+    ///
+    void fall(Callback<void()> func) { m_fall = func; }
+
+    /// Drive a simulated pin, as the peripheral would.
+    ///
+    /// @param[in] pin is the name of the pin.
+    /// @param[in] level is the new level, 0 or 1.
+    ///
+    static void Drive(int pin, int level);
+
+private:
+    static const int MAXPINS = 8;   ///< the most simulated pins in use at once
+    static SimInterruptIn * s_pins[MAXPINS]; ///< the pins, for Drive to find them
+
+    int m_pin;                      ///< the pin name
+    volatile int m_level;           ///< the present level
+    Callback<void()> m_rise;        ///< rising edge handler
+    Callback<void()> m_fall;        ///< falling edge handler
+};
+
+#endif // RA8875_SIMULATED_SPI
+#endif // SIMSPI_H
@@ -0,0 +1,68 @@
+// Span Tracing.
+//
+// See the SpanTrace.h file for full details.
+//
+#include "SpanTrace.h"
+
+#ifdef SPAN_TRACE
+
+SpanEntry_T SpanTrace::s_buf[SPAN_TRACE_SIZE];
+volatile uint32_t SpanTrace::s_head = 0;
+bool SpanTrace::s_enabled = false;
+
+
+void SpanTrace::Enable(bool enable)
+{
+    s_enabled = false;
+    if (enable) {
+        s_head = 0;
+        s_enabled = true;
+    }
+}
+
+
+void SpanTrace::Record(const char * name, uint32_t start_us)
+{
+    if (s_enabled) {
+        SpanEntry_T * e = &s_buf[s_head % SPAN_TRACE_SIZE];
+
+        e->name = name;
+        e->start_us = start_us;
+        e->duration_us = us_ticker_read() - start_us;
+        s_head = s_head + 1;
+    }
+}
+
+
+uint32_t SpanTrace::Read(SpanEntry_T * entries, uint32_t count)
+{
+    uint32_t head = s_head;
+    uint32_t first = (head > SPAN_TRACE_SIZE) ? head - SPAN_TRACE_SIZE : 0;
+    uint32_t n = 0;
+
+    if (head - first > count)
+        first = head - count;
+    for (uint32_t i=first; i<head; i++)
+        entries[n++] = s_buf[i % SPAN_TRACE_SIZE];
+    return n;
+}
+
+
+void SpanTrace::Dump(Serial & pc)
+{
+    bool enabled = s_enabled;
+    uint32_t head = s_head;
+    uint32_t first = (head > SPAN_TRACE_SIZE) ? head - SPAN_TRACE_SIZE : 0;
+
+    s_enabled = false;              // so the buffer holds still while it is written
+    pc.printf("# SpanTrace %u spans\r\n", head - first);
+    pc.printf("name,start_us,duration_us\r\n");
+    for (uint32_t i=first; i<head; i++) {
+        SpanEntry_T * e = &s_buf[i % SPAN_TRACE_SIZE];
+
+        pc.printf("%s,%u,%u\r\n", e->name, e->start_us, e->duration_us);
+    }
+    s_enabled = enabled;
+}
+
+#endif // SPAN_TRACE
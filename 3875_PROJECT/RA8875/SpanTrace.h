@@ -0,0 +1,117 @@
+/// @page SpanTrace_Page Span Tracing
+///
+/// A span is the time spent in a scope, such as a public API of the
+/// display, or a stage of an image decoder. With SPAN_TRACE defined, each
+/// span is recorded, when its scope is left, in a static ring buffer of
+/// SPAN_TRACE_SIZE entries, which holds the most recent of them.
+///
+/// Spans nest, so a frame of a dashboard shows as the APIs it called, and
+/// within those, the decoder stages and so on. @ref SpanTrace::Dump writes
+/// the buffer as text, which the host tool tools/span_to_chrome.py, in the
+/// project, turns into Chrome trace_event JSON, for viewing as a flame
+/// timeline in chrome://tracing or Perfetto.
+///
+/// @code
+///     SpanTrace::Enable();
+///     DrawDashboard();
+///     SpanTrace::Dump(pc);
+/// @endcode
+///
+/// The dump is a header line, then one line per span, oldest end first:
+/// @code
+///     # SpanTrace 2 spans
+///     name,start_us,duration_us
+///     jd_prepare,1000512,845
+///     RenderJpegFile,1000490,58120
+/// @endcode
+///
+/// Spans are recorded from thread context only, and from one thread.
+///
+#ifndef SPANTRACE_H
+#define SPANTRACE_H
+#include <mbed.h>
+
+// Define this to record a span for each public API and decoder stage.
+// As it is used by several files, it is defined here, and not in RA8875.h.
+//#define SPAN_TRACE
+
+#ifndef SPAN_TRACE_SIZE
+#define SPAN_TRACE_SIZE 512         ///< spans held by the ring buffer
+#endif
+
+#ifdef SPAN_TRACE
+
+/// One span, as recorded.
+typedef struct {
+    const char * name;              ///< the name given to the span
+    uint32_t start_us;              ///< when it began, from the us_ticker
+    uint32_t duration_us;           ///< how long it lasted
+} SpanEntry_T;
+
+
+/// The span ring buffer.
+///
+class SpanTrace
+{
+public:
+    /// Start or stop recording spans. Starting clears the buffer.
+    ///
+    /// @param[in] enable is true to start, and false to stop.
+    ///
+    static void Enable(bool enable = true);
+
+    /// Copy the spans out, oldest first.
+    ///
+    /// @param[out] entries is where to put them.
+    /// @param[in] count is the most entries to copy.
+    /// @returns the number of entries copied.
+    ///
+    static uint32_t Read(SpanEntry_T * entries, uint32_t count);
+
+    /// Write the spans as text, in the form described at @ref SpanTrace_Page.
+    ///
+    /// @param[in,out] pc is the serial channel to write to.
+    ///
+    static void Dump(Serial & pc);
+
+    /// Record a span which has ended. This is used by @ref Span.
+    ///
+    /// @param[in] name is the name of the span.
+    /// @param[in] start_us is when it began.
+    ///
+    static void Record(const char * name, uint32_t start_us);
+
+private:
+    static SpanEntry_T s_buf[SPAN_TRACE_SIZE]; ///< the ring buffer
+    static volatile uint32_t s_head;    ///< spans recorded; the next goes to s_head % SPAN_TRACE_SIZE
+    static bool s_enabled;              ///< spans are being recorded
+};
+
+
+/// A span, which lasts from its construction to its destruction.
+///
+class Span
+{
+public:
+    /// Begin a span.
+    ///
+    /// @param[in] name is the name of the span, which must remain valid,
+    ///     as a string literal does.
+    ///
+    Span(const char * name) : m_name(name), m_start(us_ticker_read()) { }
+
+    /// End the span, and record it.
+    ///
+    ~Span() { SpanTrace::Record(m_name, m_start); }
+
+private:
+    const char * m_name;            ///< the name of the span
+    uint32_t m_start;               ///< when it began
+};
+
+#define SPAN(name) Span _span(name)
+#else
+#define SPAN(name)
+#endif // SPAN_TRACE
+
+#endif // SPANTRACE_H
@@ -0,0 +1,194 @@
+// Sprite Engine.
+//
+// See the SpriteEngine.h file for full details.
+//
+#include "SpriteEngine.h"
+#include "RA8875.h"
+
+//#define DEBUG "SPRT"
+// ...
+// INFO("Stuff to show %d", var); // new-line is automatically appended
+//
+#if (defined(DEBUG) && !defined(TARGET_LPC11U24))
+#define INFO(x, ...) std::printf("[INF %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define WARN(x, ...) std::printf("[WRN %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define ERR(x, ...)  std::printf("[ERR %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#else
+#define INFO(x, ...)
+#define WARN(x, ...)
+#define ERR(x, ...)
+#endif
+
+// The BTE operations, see BlockMove.
+#define BTE_MOVE        0x2         // move in the positive direction, with ROP
+#define BTE_MOVE_TRANS  0x5         // transparent move in the positive direction
+#define ROP_SOURCE      0xC         // the destination is the source
+
+
+SpriteEngine::SpriteEngine(RA8875 & _lcd, uint16_t _storeLayer, rect_t _store)
+    : lcd(_lcd)
+{
+    storeLayer = _storeLayer;
+    store = _store;
+    count = 0;
+    shelfX = store.p1.x;
+    shelfY = store.p1.y;
+    shelfH = 0;
+}
+
+
+RetCode_t SpriteEngine::Load(const color_t * image, dim_t w, dim_t h, color_t key, int * id)
+{
+    Sprite_T * s;
+    uint16_t prevLayer;
+    loc_t x = shelfX;
+    loc_t y = shelfY;
+    RetCode_t ret;
+
+    if (image == NULL || w == 0 || h == 0 || id == NULL)
+        return bad_parameter;
+    if (count >= SPRITE_MAX) {
+        ERR("too many sprites");
+        return not_enough_ram;
+    }
+    if (x + 2 * w - 1 > store.p2.x) {           // the image and save-under side by side
+        x = store.p1.x;
+        y += shelfH;
+    }
+    if (x + 2 * w - 1 > store.p2.x || y + h - 1 > store.p2.y) {
+        ERR("store is full");
+        return not_enough_ram;
+    }
+    // At the largest size and color depth there is one layer, and the
+    // RA8875 then selects layer 0 for any other.
+    ret = lcd.SelectDrawingLayer(storeLayer, &prevLayer);
+    if (ret == noerror && lcd.GetDrawingLayer() != storeLayer) {
+        ERR("there is no layer %d", storeLayer);
+        ret = not_supported_format;
+    }
+    if (ret == noerror)
+        ret = lcd.window(x, y, w, h);
+    if (ret == noerror)
+        ret = lcd.pixelStream((color_t *)image, (uint32_t)w * h, x, y);
+    lcd.WindowMax();
+    lcd.SelectDrawingLayer(prevLayer);
+    if (ret != noerror)
+        return ret;
+    if (x != shelfX) {                          // the next shelf
+        shelfY = y;
+        shelfH = 0;
+    }
+    s = &sprites[count];
+    s->image.x = x;
+    s->image.y = y;
+    s->save.x = x + w;
+    s->save.y = y;
+    s->w = w;
+    s->h = h;
+    s->key = key;
+    s->shown = false;
+    shelfX = x + 2 * w;
+    if (h > shelfH)
+        shelfH = h;
+    INFO("sprite %d at (%d,%d) of the store", count, s->image.x, s->image.y);
+    *id = count++;
+    return noerror;
+}
+
+
+RetCode_t SpriteEngine::Show(int id, loc_t x, loc_t y)
+{
+    RetCode_t ret;
+
+    if (id < 0 || id >= count)
+        return bad_parameter;
+    if (x < 0 || y < 0 || x + sprites[id].w > lcd.width() || y + sprites[id].h > lcd.height())
+        return bad_parameter;           // the BTE does not clip
+    ret = _hideFrom(id);
+    sprites[id].at.x = x;
+    sprites[id].at.y = y;
+    sprites[id].shown = true;
+    if (ret == noerror)
+        ret = _showFrom(id);
+    return ret;
+}
+
+
+RetCode_t SpriteEngine::Hide(int id)
+{
+    RetCode_t ret;
+
+    if (id < 0 || id >= count)
+        return bad_parameter;
+    if (!sprites[id].shown)
+        return noerror;
+    ret = _hideFrom(id);
+    sprites[id].shown = false;
+    if (ret == noerror)
+        ret = _showFrom(id + 1);
+    return ret;
+}
+
+
+RetCode_t SpriteEngine::HideAll(void)
+{
+    RetCode_t ret = _hideFrom(0);
+
+    for (int i=0; i<count; i++)
+        sprites[i].shown = false;
+    return ret;
+}
+
+
+RetCode_t SpriteEngine::Clear(void)
+{
+    RetCode_t ret = noerror;
+
+    if (count)
+        ret = HideAll();
+    count = 0;
+    shelfX = store.p1.x;
+    shelfY = store.p1.y;
+    shelfH = 0;
+    return ret;
+}
+
+
+// Restore what was under the shown sprites from the top down to id, which
+// leaves them marked as shown.
+RetCode_t SpriteEngine::_hideFrom(int id)
+{
+    RetCode_t ret = noerror;
+    uint16_t layer = lcd.GetDrawingLayer();
+
+    for (int i=count-1; i>=id && ret == noerror; i--) {
+        Sprite_T * s = &sprites[i];
+
+        if (s->shown)
+            ret = lcd.BlockMove(layer, 0, s->at, storeLayer, 0, s->save, s->w, s->h, BTE_MOVE, ROP_SOURCE);
+    }
+    return ret;
+}
+
+
+// Save what is under, and draw, the shown sprites from id up to the top.
+RetCode_t SpriteEngine::_showFrom(int id)
+{
+    RetCode_t ret = noerror;
+    uint16_t layer = lcd.GetDrawingLayer();
+    color_t fg = lcd.GetForeColor();
+
+    for (int i=id; i<count && ret == noerror; i++) {
+        Sprite_T * s = &sprites[i];
+
+        if (!s->shown)
+            continue;
+        ret = lcd.BlockMove(storeLayer, 0, s->save, layer, 0, s->at, s->w, s->h, BTE_MOVE, ROP_SOURCE);
+        if (ret == noerror) {
+            lcd.foreground(s->key);     // the transparent color of the move
+            ret = lcd.BlockMove(layer, 0, s->at, storeLayer, 0, s->image, s->w, s->h, BTE_MOVE_TRANS, 0);
+        }
+    }
+    lcd.foreground(fg);
+    return ret;
+}
@@ -0,0 +1,141 @@
+/// @page SpriteEngine_Page Sprite Engine
+///
+/// Icons and needles that move are usually erased and redrawn with a pixel
+/// stream, so every pixel of them crosses the SPI bus on every frame. The
+/// SpriteEngine uploads each sprite image once, to display memory that is
+/// not on show - the other layer, or rows below the screen - and from then
+/// on draws it with the BTE of the RA8875, which is a dozen register writes
+/// whatever the size of the sprite.
+///
+/// - A sprite is drawn with the transparent move (op code 0x5), which skips
+///   the pixels of its key color, so it need not be a rectangle.
+/// - Before it is drawn, what is under it is saved with a move (op code 0x2)
+///   to a save-under area beside its image, and when it is moved or hidden,
+///   that is moved back.
+///
+/// @code
+///     RA8875 lcd(p5, p6, p7, p12, NC, "tft");
+///     rect_t store = { { 0, 0 }, { 479, 271 } };
+///
+///     lcd.init(480, 272, 16);
+///     SpriteEngine sprites(lcd, 1, store);    // layer 1 is not on show
+///     int needle;
+///
+///     DrawDial();
+///     sprites.Load(needleImage, 40, 40, Black, &needle);
+///     while (1)
+///         sprites.Show(needle, 100 + speed, 120);   // register writes only
+/// @endcode
+///
+/// Sprites are drawn on the drawing layer, in the order they were loaded,
+/// so the last loaded is on top. To move one, those above it are hidden and
+/// then drawn again, so that each save-under stays true.
+///
+/// Whatever is under a sprite should not be drawn on while it is shown, or
+/// it is undone when the sprite moves; hide the sprites first, with
+/// @ref HideAll. The store must not be drawn on at all, and when it is on
+/// the other layer, that layer is not free for @ref RA8875::BeginFrame.
+///
+#ifndef SPRITEENGINE_H
+#define SPRITEENGINE_H
+#include <mbed.h>
+#include "DisplayDefs.h"
+
+#ifndef SPRITE_MAX
+#define SPRITE_MAX 16               ///< sprites an engine holds
+#endif
+
+class RA8875;
+
+/// Draws sprites, held in display memory, with the BTE.
+///
+class SpriteEngine
+{
+public:
+    /// Constructor.
+    ///
+    /// @param[in] lcd is the display.
+    /// @param[in] storeLayer is the layer of the store, 0 or 1.
+    /// @param[in] store is the rectangle of display memory that holds the
+    ///     sprite images and save-unders, which is never on show.
+    ///
+    SpriteEngine(RA8875 & lcd, uint16_t storeLayer, rect_t store);
+
+    /// Upload a sprite to the store.
+    ///
+    /// This is the only time the pixels of the sprite are sent on the bus.
+    /// The store takes twice its area, for the image and the save-under.
+    ///
+    /// @param[in] image is the w x h pixels of the sprite.
+    /// @param[in] w is the width of the sprite.
+    /// @param[in] h is the height of the sprite.
+    /// @param[in] key is the color of the pixels that are not drawn.
+    /// @param[out] id is where the id of the sprite is written.
+    /// @returns @ref RetCode_t value; not_enough_ram when there is no room
+    ///     in the store, or SPRITE_MAX are loaded, and not_supported_format
+    ///     when the store is on layer 1, and the display, at its size and
+    ///     color depth, has only one layer.
+    ///
+    RetCode_t Load(const color_t * image, dim_t w, dim_t h, color_t key, int * id);
+
+    /// Show a sprite, or move it if it is shown.
+    ///
+    /// @param[in] id is the sprite.
+    /// @param[in] x is the left edge of where it is drawn.
+    /// @param[in] y is the top edge of where it is drawn.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Show(int id, loc_t x, loc_t y);
+
+    /// Hide a sprite, which restores what was under it.
+    ///
+    /// @param[in] id is the sprite.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Hide(int id);
+
+    /// Hide all of the sprites, top first.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t HideAll(void);
+
+    /// Hide all of the sprites, and forget them, which empties the store.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Clear(void);
+
+    /// Get whether a sprite is shown.
+    ///
+    /// @param[in] id is the sprite.
+    /// @returns true if it is shown.
+    ///
+    bool IsShown(int id) { return id >= 0 && id < count && sprites[id].shown; }
+
+private:
+    /// One sprite.
+    typedef struct {
+        point_t image;              ///< where the image is in the store
+        point_t save;               ///< where the save-under is in the store
+        point_t at;                 ///< where it is drawn, when shown
+        dim_t w;                    ///< its width
+        dim_t h;                    ///< its height
+        color_t key;                ///< the color that is not drawn
+        bool shown;                 ///< it is on the screen
+    } Sprite_T;
+
+    RetCode_t _hideFrom(int id);
+    RetCode_t _showFrom(int id);
+
+    RA8875 & lcd;                   ///< the display
+    uint16_t storeLayer;            ///< the layer of the store
+    rect_t store;                   ///< the store
+    loc_t shelfX;                   ///< the next free column of the shelf
+    loc_t shelfY;                   ///< the top of the shelf being filled
+    dim_t shelfH;                   ///< the height of the shelf being filled
+    Sprite_T sprites[SPRITE_MAX];   ///< the sprites, in the order they are drawn
+    int count;                      ///< entries of sprites in use
+};
+
+#endif // SPRITEENGINE_H
@@ -0,0 +1,310 @@
+// Strip Renderer.
+//
+// See the StripRenderer.h file for full details.
+//
+#include "StripRenderer.h"
+
+//#define DEBUG "STRP"
+// ...
+// INFO("Stuff to show %d", var); // new-line is automatically appended
+//
+#if (defined(DEBUG) && !defined(TARGET_LPC11U24))
+#define INFO(x, ...) std::printf("[INF %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define WARN(x, ...) std::printf("[WRN %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#define ERR(x, ...)  std::printf("[ERR %s %4d] "x"\r\n", DEBUG, __LINE__, ##__VA_ARGS__);
+#else
+#define INFO(x, ...)
+#define WARN(x, ...)
+#define ERR(x, ...)
+#endif
+
+
+// The number of lines a string takes in a user font, from x, as the text
+// of a Canvas wraps at the right edge of a screen w pixels wide.
+static int TextLines(const char * string, const uint8_t * font, loc_t x, dim_t w)
+{
+    uint16_t firstChar = font[3] * 256 + font[2];
+    uint16_t lastChar  = font[5] * 256 + font[4];
+    int lines = 1;
+
+    while (*string) {
+        unsigned char c = *string++;
+
+        if (c == '\r') {
+            x = 0;
+        } else if (c == '\n') {
+            lines++;
+        } else if (c >= firstChar && c <= lastChar) {
+            dim_t charWidth = font[8 + 4 * (c - firstChar)];
+
+            if (x + charWidth >= w - 1) {
+                x = 0;
+                lines++;
+            }
+            x += charWidth;
+        }
+    }
+    return lines;
+}
+
+
+StripRenderer::StripRenderer(GraphicsDisplay & _target, dim_t _stripHeight)
+    : target(_target)
+{
+    strip[0] = strip[1] = NULL;
+    stripNext = 0;
+    stripHeight = _stripHeight;
+    bgColor = 0x0000;           // Black
+    opCount = 0;
+    textUsed = 0;
+}
+
+
+StripRenderer::~StripRenderer()
+{
+    target.flush();             // one may still be sent from
+    delete strip[0];
+    delete strip[1];
+}
+
+
+RetCode_t StripRenderer::Clear(void)
+{
+    opCount = 0;
+    textUsed = 0;
+    return noerror;
+}
+
+
+StripRenderer::StripOp_T * StripRenderer::_add(StripOpType_T type, loc_t x1, loc_t y1, loc_t x2, loc_t y2)
+{
+    StripOp_T * op;
+
+    if (opCount >= STRIP_MAX_OPS) {
+        ERR("draw list is full");
+        return NULL;
+    }
+    op = &ops[opCount++];
+    op->type = type;
+    op->bounds.p1.x = (x1 < x2) ? x1 : x2;
+    op->bounds.p1.y = (y1 < y2) ? y1 : y2;
+    op->bounds.p2.x = (x1 < x2) ? x2 : x1;
+    op->bounds.p2.y = (y1 < y2) ? y2 : y1;
+    op->data = NULL;
+    op->context = NULL;
+    return op;
+}
+
+
+RetCode_t StripRenderer::fillrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color, fill_t fillit)
+{
+    StripOp_T * op = _add((fillit == FILL) ? op_fillrect : op_rect, x1, y1, x2, y2);
+
+    if (op == NULL)
+        return not_enough_ram;
+    op->color = color;
+    return noerror;
+}
+
+
+RetCode_t StripRenderer::blendrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color, uint8_t alpha)
+{
+    StripOp_T * op = _add(op_blendrect, x1, y1, x2, y2);
+
+    if (op == NULL)
+        return not_enough_ram;
+    op->color = color;
+    op->alpha = alpha;
+    return noerror;
+}
+
+
+RetCode_t StripRenderer::pixels(loc_t x, loc_t y, dim_t w, dim_t h, const color_t * image)
+{
+    StripOp_T * op;
+
+    if (w == 0 || h == 0 || image == NULL)
+        return bad_parameter;
+    op = _add(op_pixels, x, y, x + w - 1, y + h - 1);
+    if (op == NULL)
+        return not_enough_ram;
+    op->data = image;
+    return noerror;
+}
+
+
+RetCode_t StripRenderer::text(loc_t x, loc_t y, const char * string, const uint8_t * font, color_t fg, color_t bg)
+{
+    int len = strlen(string) + 1;
+    StripOp_T * op;
+
+    if (font == NULL)
+        return bad_parameter;
+    if (textUsed + len > STRIP_TEXT_POOL) {
+        ERR("text pool is full");
+        return not_enough_ram;
+    }
+    if (target.width() == 0) {      // not yet known, so it may wrap to any row below
+        op = _add(op_text, 0, y, 0x7FFF, 0x7FFF);
+    } else {
+        int lines = TextLines(string, font, x, target.width());
+
+        op = _add(op_text, (lines > 1) ? 0 : x, y, target.width() - 1, y + lines * font[6] - 1);
+    }
+    if (op == NULL)
+        return not_enough_ram;
+    memcpy(textPool + textUsed, string, len);
+    op->textX = x;
+    op->textOffset = textUsed;
+    textUsed += len;
+    op->data = font;
+    op->color = fg;
+    op->bgColor = bg;
+    return noerror;
+}
+
+
+RetCode_t StripRenderer::custom(rect_t bounds, StripDrawCallback_T callback, void * context)
+{
+    StripOp_T * op;
+
+    if (callback == NULL)
+        return bad_parameter;
+    op = _add(op_custom, bounds.p1.x, bounds.p1.y, bounds.p2.x, bounds.p2.y);
+    if (op == NULL)
+        return not_enough_ram;
+    op->data = (const void *)callback;
+    op->context = context;
+    return noerror;
+}
+
+
+void StripRenderer::_replay(Canvas * canvas, StripOp_T * op)
+{
+    rect_t b = op->bounds;
+    rect_t a = canvas->GetArea();
+
+    switch (op->type) {
+        case op_fillrect:
+            canvas->fillrect(b.p1.x, b.p1.y, b.p2.x, b.p2.y, op->color, FILL);
+            break;
+        case op_rect:
+            canvas->fillrect(b.p1.x, b.p1.y, b.p2.x, b.p2.y, op->color, NOFILL);
+            break;
+        case op_blendrect:
+            canvas->blendrect(b.p1.x, b.p1.y, b.p2.x, b.p2.y, op->color, op->alpha);
+            break;
+        case op_pixels: {
+            // only the rows of the image in this strip
+            dim_t w = b.p2.x - b.p1.x + 1;
+            loc_t y1 = (b.p1.y > a.p1.y) ? b.p1.y : a.p1.y;
+            loc_t y2 = (b.p2.y < a.p2.y) ? b.p2.y : a.p2.y;
+            const color_t * image = (const color_t *)op->data + (uint32_t)(y1 - b.p1.y) * w;
+
+            canvas->window(b.p1.x, y1, w, y2 - y1 + 1);
+            canvas->pixelStream((color_t *)image, (uint32_t)w * (y2 - y1 + 1), b.p1.x, y1);
+            canvas->WindowMax();
+            break;
+        }
+        case op_text:
+            canvas->SelectUserFont((const uint8_t *)op->data);
+            canvas->foreground(op->color);
+            canvas->background(op->bgColor);
+            canvas->puts(op->textX, b.p1.y, textPool + op->textOffset);
+            break;
+        case op_custom:
+            ((StripDrawCallback_T)op->data)(*canvas, op->context);
+            canvas->WindowMax();    // in case the callback changed it
+            break;
+    }
+}
+
+
+RetCode_t StripRenderer::Render(void)
+{
+    rect_t all = { { 0, 0 }, { (loc_t)(target.width() - 1), (loc_t)(target.height() - 1) } };
+
+    return Render(all);
+}
+
+
+RetCode_t StripRenderer::Render(rect_t region)
+{
+    RetCode_t ret = _render(region);
+    RetCode_t done;
+
+    target.WindowMax();
+    done = target.flush();
+    return (ret == noerror) ? done : ret;
+}
+
+
+RetCode_t StripRenderer::Render(DirtyRegion & region)
+{
+    RetCode_t ret = noerror;
+    RetCode_t done;
+    rect_t r[DIRTY_REGION_RECTS];
+    int n = region.Take(r, DIRTY_REGION_RECTS);
+
+    for (int i=0; i<n && ret == noerror; i++)
+        ret = _render(r[i]);
+    target.WindowMax();
+    done = target.flush();
+    return (ret == noerror) ? done : ret;
+}
+
+
+RetCode_t StripRenderer::_render(rect_t region)
+{
+    RetCode_t ret = noerror;
+    dim_t w = target.width();
+    dim_t h = target.height();
+    bool twoStrips;
+
+    if (region.p1.x > region.p2.x) {
+        loc_t t = region.p1.x; region.p1.x = region.p2.x; region.p2.x = t;
+    }
+    if (region.p1.y > region.p2.y) {
+        loc_t t = region.p1.y; region.p1.y = region.p2.y; region.p2.y = t;
+    }
+    if (region.p1.x < 0)
+        region.p1.x = 0;
+    if (region.p1.y < 0)
+        region.p1.y = 0;
+    if (region.p2.x >= w)
+        region.p2.x = w - 1;
+    if (region.p2.y >= h)
+        region.p2.y = h - 1;
+    if (region.p1.x > region.p2.x || region.p1.y > region.p2.y)
+        return noerror;
+    if (strip[0] == NULL || strip[0]->GetArea().p2.x != w - 1) {
+        target.flush();             // the screen size is known now, or has changed
+        for (int i=0; i<2; i++) {
+            delete strip[i];
+            strip[i] = new Canvas(target, w, stripHeight);
+        }
+        stripNext = 0;
+    }
+    twoStrips = strip[1]->GetArea().p2.x == w - 1;
+    for (loc_t y=region.p1.y; y<=region.p2.y && ret == noerror; y+=stripHeight) {
+        Canvas * s = strip[stripNext];  // which is not being sent from
+        rect_t band = region;
+
+        band.p1.y = y;
+        if (y + stripHeight - 1 < region.p2.y)
+            band.p2.y = y + stripHeight - 1;
+        s->SetOrigin(0, y);
+        s->WindowMax();
+        s->fillrect(band.p1.x, band.p1.y, band.p2.x, band.p2.y, bgColor);
+        for (int i=0; i<opCount; i++) {
+            if (DirtyRegion::Overlap(ops[i].bounds, band))
+                _replay(s, &ops[i]);
+        }
+        s->Validate();              // send the band, not all the strip
+        s->Invalidate(band);
+        ret = s->Send(twoStrips);   // which goes on while the next is drawn in the other
+        if (twoStrips)
+            stripNext ^= 1;
+    }
+    return ret;
+}
@@ -0,0 +1,233 @@
+/// @page StripRenderer_Page Strip Renderer
+///
+/// A full frame does not fit in RAM - at 800 x 480 and 16 bpp it is 750 kB,
+/// and a K64F has 256 kB - so a frame cannot be composed in software as a
+/// whole. The StripRenderer records the draw list of a frame once, and then
+/// replays it against a horizontal strip of the screen at a time, in one
+/// reusable @ref Canvas of STRIP_HEIGHT rows. Each operation is clipped to
+/// the strip, and those wholly outside it are skipped. Each finished strip
+/// is sent with @ref Canvas::Send, as one pixel stream.
+///
+/// As the strip is composed in RAM, translucent (@ref blendrect) and
+/// anti-aliased content is drawn over what is below it without reading
+/// back from the display.
+///
+/// There are two strip canvases, which take turns: while one is sent, from
+/// where it is (see @ref Canvas::Send), the next strip is drawn in the other.
+/// With RA8875_ASYNC_SPI, at 16 bits a pixel, a band of the full width is one
+/// non-blocking transfer, so drawing and sending go on together. Should
+/// there not be RAM for the second canvas, the one is sent by copying out
+/// of it, and only the tail of each strip overlaps the drawing.
+///
+/// @code
+///     RA8875 lcd(p5, p6, p7, p12, NC, "tft");
+///     StripRenderer frame(lcd);
+///
+///     lcd.init(800, 480, 16);
+///     frame.background(Blue);
+///     frame.fillrect(20,20, 780,200, DarkGray);
+///     frame.blendrect(40,120, 500,300, Yellow, 96);   // a translucent panel
+///     frame.text(50,140, "Engine temp", BPG_Arial20x20, White, Black);
+///     frame.Render();                                 // the whole screen
+///     ...
+///     frame.Render(valueRect);                        // just where it changed,
+///                                                     // or a DirtyRegion
+/// @endcode
+///
+/// Text and custom operations are kept in the list; the strings are copied
+/// into a pool of STRIP_TEXT_POOL bytes, while images, fonts and callback
+/// contexts must stay valid until the list is cleared.
+///
+#ifndef STRIPRENDERER_H
+#define STRIPRENDERER_H
+#include <mbed.h>
+#include "Canvas.h"
+
+#ifndef STRIP_HEIGHT
+#define STRIP_HEIGHT 32             ///< rows in each strip
+#endif
+
+#ifndef STRIP_MAX_OPS
+#define STRIP_MAX_OPS 64            ///< operations in the draw list
+#endif
+
+#ifndef STRIP_TEXT_POOL
+#define STRIP_TEXT_POOL 512         ///< bytes for the strings of the text operations
+#endif
+
+/// A callback for a custom operation, which draws on the canvas of a
+/// strip, in screen coordinates, for whatever it draws is clipped to it.
+///
+/// @param[in,out] canvas is the canvas of the strip.
+/// @param[in] context is the context given with the operation.
+///
+typedef void (* StripDrawCallback_T)(Canvas & canvas, void * context);
+
+/// Records a draw list, and renders it to the display one strip at a time.
+///
+class StripRenderer
+{
+public:
+    /// Constructor. The strips are allocated at the first render, as the
+    /// target may not yet know its size.
+    ///
+    /// @param[in] target is the display.
+    /// @param[in] stripHeight is the height of each strip.
+    ///
+    StripRenderer(GraphicsDisplay & target, dim_t stripHeight = STRIP_HEIGHT);
+
+    /// Destructor, which frees the strips, once they are sent.
+    ///
+    ~StripRenderer();
+
+    /// Empty the draw list.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Clear(void);
+
+    /// Get the number of operations in the draw list.
+    ///
+    /// @returns the count.
+    ///
+    int Count(void) { return opCount; }
+
+    /// Set the color each strip is cleared to, before the draw list is
+    /// replayed on it.
+    ///
+    /// @param[in] color is the color.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t background(color_t color) { bgColor = color; return noerror; }
+
+    /// Add a rectangle to the draw list.
+    ///
+    /// @param[in] x1 is the horizontal start of the rectangle.
+    /// @param[in] y1 is the vertical start of the rectangle.
+    /// @param[in] x2 is the horizontal end of the rectangle.
+    /// @param[in] y2 is the vertical end of the rectangle.
+    /// @param[in] color is the color.
+    /// @param[in] fillit is optional to NOFILL the rectangle. default is FILL.
+    /// @returns @ref RetCode_t value; not_enough_ram when the list is full.
+    ///
+    RetCode_t fillrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color, fill_t fillit = FILL);
+
+    /// Add a translucent rectangle to the draw list. See @ref Canvas::blendrect.
+    ///
+    /// @param[in] x1 is the horizontal start of the rectangle.
+    /// @param[in] y1 is the vertical start of the rectangle.
+    /// @param[in] x2 is the horizontal end of the rectangle.
+    /// @param[in] y2 is the vertical end of the rectangle.
+    /// @param[in] color is the color to blend.
+    /// @param[in] alpha is its opacity, from 0 (none) to 255 (opaque).
+    /// @returns @ref RetCode_t value; not_enough_ram when the list is full.
+    ///
+    RetCode_t blendrect(loc_t x1, loc_t y1, loc_t x2, loc_t y2, color_t color, uint8_t alpha);
+
+    /// Add an image to the draw list.
+    ///
+    /// @param[in] x is the left edge of the image.
+    /// @param[in] y is the top edge of the image.
+    /// @param[in] w is the width of the image.
+    /// @param[in] h is the height of the image.
+    /// @param[in] image is the w x h pixels, which must stay valid.
+    /// @returns @ref RetCode_t value; not_enough_ram when the list is full.
+    ///
+    RetCode_t pixels(loc_t x, loc_t y, dim_t w, dim_t h, const color_t * image);
+
+    /// Add a string to the draw list, drawn in a user font.
+    ///
+    /// The text wraps at the right edge of the screen. The lines it takes
+    /// are measured here, so the target should know its size by now, or
+    /// else the text is replayed on every strip below y.
+    ///
+    /// @param[in] x is the left edge of the text.
+    /// @param[in] y is the top edge of the text.
+    /// @param[in] string is the text, which is copied.
+    /// @param[in] font is the user font, which must stay valid.
+    /// @param[in] fg is the color of the text.
+    /// @param[in] bg is the color of the cells behind it.
+    /// @returns @ref RetCode_t value; not_enough_ram when the list or the
+    ///     pool is full.
+    ///
+    RetCode_t text(loc_t x, loc_t y, const char * string, const uint8_t * font, color_t fg, color_t bg);
+
+    /// Add a custom operation to the draw list.
+    ///
+    /// @param[in] bounds is the rectangle the callback draws within, so
+    ///     that it is called only for the strips it touches.
+    /// @param[in] callback is the function to draw with.
+    /// @param[in] context is passed to the callback, and must stay valid.
+    /// @returns @ref RetCode_t value; not_enough_ram when the list is full.
+    ///
+    RetCode_t custom(rect_t bounds, StripDrawCallback_T callback, void * context = NULL);
+
+    /// Render the draw list to the whole screen.
+    ///
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Render(void);
+
+    /// Render the draw list to a region of the screen.
+    ///
+    /// Only the strips that the region touches are rendered, and only the
+    /// region is sent.
+    ///
+    /// @param[in] region is the rectangle to redraw.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Render(rect_t region);
+
+    /// Render the draw list to the rectangles of a dirty region, which are
+    /// taken from it.
+    ///
+    /// @code
+    ///     region.Invalidate(speedRect);
+    ///     frame.Render(region);
+    /// @endcode
+    ///
+    /// @param[in,out] region is the dirty region.
+    /// @returns @ref RetCode_t value.
+    ///
+    RetCode_t Render(DirtyRegion & region);
+
+private:
+    /// The kinds of operation.
+    typedef enum {
+        op_fillrect,
+        op_rect,
+        op_blendrect,
+        op_pixels,
+        op_text,
+        op_custom,
+    } StripOpType_T;
+
+    /// One operation of the draw list.
+    typedef struct {
+        StripOpType_T type;         ///< what to draw
+        rect_t bounds;              ///< what it may touch
+        color_t color;              ///< the color, or the text color
+        color_t bgColor;            ///< the text background color
+        uint8_t alpha;              ///< the opacity of a blendrect
+        loc_t textX;                ///< where the text begins
+        uint16_t textOffset;        ///< where the string is in textPool
+        const void * data;          ///< the image, font or callback
+        void * context;             ///< the context of a callback
+    } StripOp_T;
+
+    StripOp_T * _add(StripOpType_T type, loc_t x1, loc_t y1, loc_t x2, loc_t y2);
+    void _replay(Canvas * canvas, StripOp_T * op);
+    RetCode_t _render(rect_t region);
+
+    GraphicsDisplay & target;       ///< the display
+    Canvas * strip[2];              ///< the strips, which take turns, once allocated
+    int stripNext;                  ///< the strip to draw next
+    dim_t stripHeight;              ///< the height of each strip
+    color_t bgColor;                ///< the color each strip is cleared to
+    StripOp_T ops[STRIP_MAX_OPS];   ///< the draw list
+    int opCount;                    ///< entries of ops in use
+    char textPool[STRIP_TEXT_POOL]; ///< the strings of the text operations
+    uint16_t textUsed;              ///< bytes of textPool in use
+};
+
+#endif // STRIPRENDERER_H
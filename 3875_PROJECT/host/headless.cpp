@@ -0,0 +1,98 @@
+// Host runner of the RA8875 test scenes.
+//
+// Runs RunHeadlessTestSet against the emulator, which writes each scene to
+// a PPM in the given directory, and writes the bytes, transactions and
+// predicted target time of each scene to frame_time.csv there. With
+// PERF_METRICS, the same is then reported for each API.
+//
+// Given a budget, in the format of frame_time.csv, it fails when a scene is
+// predicted to take longer than its budget, plus the tolerance (in percent,
+// 10 by default), so that a change that slows the drawing is caught in CI.
+//
+//   ra8875_headless <directory> [budget.csv [tolerance]]
+//
+#include "mbed.h"
+#include "RA8875.h"
+#include <sys/stat.h>
+
+Serial pc(USBTX, USBRX);
+RA8875 lcd(p5, p6, p7, p12, NC, "tft");    // MOSI, MISO, SCK, /ChipSelect, /reset, name
+
+
+static bool WriteFrameTimes(const char * path, const HeadlessScene_T * scenes)
+{
+    char name[200];
+    FILE * fh;
+
+    snprintf(name, sizeof(name), "%s/frame_time.csv", path);
+    fh = fopen(name, "w");
+    if (!fh) {
+        pc.printf("can't write %s\r\n", name);
+        return false;
+    }
+    fprintf(fh, "scene,bytes,transactions,predicted_us\n");
+    for (int i=0; i<HEADLESS_SCENES; i++)
+        fprintf(fh, "%c,%u,%u,%u\n", scenes[i].scene, scenes[i].bytes, scenes[i].transactions,
+            scenes[i].predicted_us);
+    fclose(fh);
+    return true;
+}
+
+
+// Each scene in the budget must be run, and within it.
+static bool CheckBudget(const char * budget, int tolerance, const HeadlessScene_T * scenes)
+{
+    char line[100];
+    bool ok = true;
+    FILE * fh = fopen(budget, "r");
+
+    if (!fh) {
+        pc.printf("can't read %s\r\n", budget);
+        return false;
+    }
+    while (fgets(line, sizeof(line), fh)) {
+        char scene;
+        unsigned bytes, transactions, limit;
+        int i;
+
+        if (sscanf(line, "%c,%u,%u,%u", &scene, &bytes, &transactions, &limit) != 4)
+            continue;               // the heading
+        for (i=0; i<HEADLESS_SCENES && scenes[i].scene != scene; i++)
+            ;
+        if (i == HEADLESS_SCENES) {
+            pc.printf("Scene %c: in the budget, but not run\r\n", scene);
+            ok = false;
+        } else if ((uint64_t)scenes[i].predicted_us * 100 > (uint64_t)limit * (100 + tolerance)) {
+            pc.printf("Scene %c: %u uS predicted, over the budget of %u uS + %d%%\r\n", scene,
+                scenes[i].predicted_us, limit, tolerance);
+            ok = false;
+        }
+    }
+    fclose(fh);
+    return ok;
+}
+
+
+int main(int argc, char * argv[])
+{
+    const char * path = (argc > 1) ? argv[1] : ".";
+    const char * budget = (argc > 2) ? argv[2] : NULL;
+    int tolerance = (argc > 3) ? atoi(argv[3]) : 10;
+    HeadlessScene_T scenes[HEADLESS_SCENES];
+    RA8875_Emulator emu;
+    int ret = 0;
+
+    mkdir(path, 0777);
+    emu.Attach(lcd.Bus());
+    lcd.init(480, 272, 16);
+    if (RunHeadlessTestSet(lcd, emu, pc, path, scenes) != noerror)
+        ret = 1;
+    if (!WriteFrameTimes(path, scenes))
+        ret = 1;
+    #ifdef PERF_METRICS
+    lcd.ReportPerformance(pc);
+    #endif
+    if (budget && !CheckBudget(budget, tolerance, scenes))
+        ret = 1;
+    return ret;
+}
@@ -0,0 +1,79 @@
+// Host stand-in for the mbed library.
+//
+// See the mbed.h file alongside for full details.
+//
+#include "mbed.h"
+#include <time.h>
+
+
+void wait(float s)
+{
+    wait_us((int)(s * 1000000));
+}
+
+
+void wait_ms(int ms)
+{
+    wait_us(ms * 1000);
+}
+
+
+void wait_us(int us)
+{
+    struct timespec ts;
+
+    if (us <= 0)
+        return;
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000L;
+    nanosleep(&ts, NULL);
+}
+
+
+uint32_t us_ticker_read(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+
+void error(const char * format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    std::vfprintf(stderr, format, args);
+    va_end(args);
+    std::exit(1);
+}
+
+
+extern "C" void mbed_reset(void)
+{
+    std::exit(0);
+}
+
+
+int Stream::printf(const char * format, ...)
+{
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vprintf(format, args);
+    va_end(args);
+    return len;
+}
+
+
+int Stream::vprintf(const char * format, va_list args)
+{
+    char buf[256];
+    int len = std::vsnprintf(buf, sizeof(buf), format, args);
+
+    for (int i=0; i<len && i<(int)sizeof(buf)-1; i++)
+        _putc(buf[i]);
+    return len;
+}
@@ -0,0 +1,277 @@
+// Host stand-in for the mbed library.
+//
+// This offers the small part of the mbed 2 API that the RA8875 library
+// uses, so that it can be built and run on a host (Linux) system, against
+// the simulated bus and the emulator (RA8875_SIMULATED_SPI). The pins do
+// nothing, time is the host clock, and Serial is stdin and stdout.
+//
+#ifndef MBED_H
+#define MBED_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cmath>
+#include <algorithm>
+
+#define MBED_LIBRARY_VERSION 146
+#define MBED_ENCODE_VERSION(major, minor, patch) ((major) * 10000 + (minor) * 100 + (patch))
+
+typedef int PinName;
+
+enum {
+    NC = -1,
+    p5 = 5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17, p18,
+    p19, p20, p21, p22, p23, p24, p25, p26, p27, p28, p29, p30,
+    LED1 = 100, LED2, LED3, LED4,
+    USBTX = 110, USBRX
+};
+
+typedef enum {
+    PullNone = 0,
+    PullUp = 1,
+    PullDown = 2,
+    OpenDrain = 3,
+    PullDefault = PullUp
+} PinMode;
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+uint32_t us_ticker_read(void);
+void error(const char * format, ...);
+extern "C" void mbed_reset(void);
+
+
+/// A function, or a method of an object, to call; as the mbed Callback, for
+/// no argument and for one.
+///
+template <typename F> class Callback;
+
+template <typename R>
+class Callback<R()>
+{
+public:
+    Callback(R (*func)() = NULL) : _func(func), _obj(NULL), _thunk(NULL) { }
+
+    template <typename T>
+    Callback(T * obj, R (T::*method)()) : _func(NULL), _obj(obj), _thunk(&_methodThunk<T>) {
+        memcpy(_method, &method, sizeof(method));
+    }
+
+    R call() const { return (_thunk) ? (*_thunk)(_obj, _method) : (*_func)(); }
+    R operator()() const { return call(); }
+    operator bool() const { return _func != NULL || _thunk != NULL; }
+
+private:
+    template <typename T>
+    static R _methodThunk(void * obj, const char * method) {
+        R (T::*m)();
+        memcpy(&m, method, sizeof(m));
+        return (((T *)obj)->*m)();
+    }
+
+    R (*_func)();
+    void * _obj;
+    R (*_thunk)(void *, const char *);
+    char _method[2 * sizeof(void *)];
+};
+
+template <typename R, typename A>
+class Callback<R(A)>
+{
+public:
+    Callback(R (*func)(A) = NULL) : _func(func), _obj(NULL), _thunk(NULL) { }
+
+    template <typename T>
+    Callback(T * obj, R (T::*method)(A)) : _func(NULL), _obj(obj), _thunk(&_methodThunk<T>) {
+        memcpy(_method, &method, sizeof(method));
+    }
+
+    R call(A a) const { return (_thunk) ? (*_thunk)(_obj, _method, a) : (*_func)(a); }
+    R operator()(A a) const { return call(a); }
+    operator bool() const { return _func != NULL || _thunk != NULL; }
+
+private:
+    template <typename T>
+    static R _methodThunk(void * obj, const char * method, A a) {
+        R (T::*m)(A);
+        memcpy(&m, method, sizeof(m));
+        return (((T *)obj)->*m)(a);
+    }
+
+    R (*_func)(A);
+    void * _obj;
+    R (*_thunk)(void *, const char *, A);
+    char _method[2 * sizeof(void *)];
+};
+
+template <typename T, typename R>
+Callback<R()> callback(T * obj, R (T::*method)()) { return Callback<R()>(obj, method); }
+
+template <typename T, typename R, typename A>
+Callback<R(A)> callback(T * obj, R (T::*method)(A)) { return Callback<R(A)>(obj, method); }
+
+typedef Callback<void(int)> event_callback_t;
+
+
+/// Elapsed time, from the host clock.
+///
+class Timer
+{
+public:
+    Timer() : _running(false), _start(0), _total(0) { }
+    void start(void) { if (!_running) { _start = _now(); _running = true; } }
+    void stop(void) { if (_running) { _total += _now() - _start; _running = false; } }
+    void reset(void) { _start = _now(); _total = 0; }
+    float read(void) { return (float)_elapsed() / 1000000.0f; }
+    int read_ms(void) { return (int)(_elapsed() / 1000); }
+    int read_us(void) { return (int)_elapsed(); }
+    operator float() { return read(); }
+
+private:
+    uint64_t _elapsed(void) { return _total + ((_running) ? _now() - _start : 0); }
+    static uint64_t _now(void) { return us_ticker_read(); }
+
+    bool _running;
+    uint64_t _start;
+    uint64_t _total;
+};
+
+
+/// A periodic call, which never fires on the host.
+///
+class Ticker
+{
+public:
+    void attach_us(Callback<void()> func, uint32_t us) { (void)func; (void)us; }
+    template <typename T>
+    void attach_us(T * obj, void (T::*method)(), uint32_t us) { (void)obj; (void)method; (void)us; }
+    void detach(void) { }
+};
+
+
+class DigitalOut
+{
+public:
+    DigitalOut(PinName pin, int value = 0) : _value(value) { (void)pin; }
+    void write(int value) { _value = value; }
+    int read(void) { return _value; }
+    DigitalOut & operator= (int value) { write(value); return *this; }
+    operator int() { return read(); }
+
+private:
+    int _value;
+};
+
+
+class DigitalIn
+{
+public:
+    DigitalIn(PinName pin, PinMode pull = PullDefault) { (void)pin; (void)pull; }
+    void mode(PinMode pull) { (void)pull; }
+    int read(void) { return 1; }
+    operator int() { return read(); }
+};
+
+
+/// An input pin that rests high, and never interrupts.
+///
+class InterruptIn
+{
+public:
+    InterruptIn(PinName pin) { (void)pin; }
+    void mode(PinMode pull) { (void)pull; }
+    int read(void) { return 1; }
+    operator int() { return read(); }
+    void rise(Callback<void()> func) { (void)func; }
+    void fall(Callback<void()> func) { (void)func; }
+    void enable_irq(void) { }
+    void disable_irq(void) { }
+};
+
+
+/// An I2C bus with nothing on it, so every transfer is not acknowledged.
+///
+class I2C
+{
+public:
+    I2C(PinName sda, PinName scl) { (void)sda; (void)scl; }
+    void frequency(int hz) { (void)hz; }
+    int read(int address, char * data, int length, bool repeated = false) {
+        (void)address; (void)data; (void)length; (void)repeated;
+        return -1;
+    }
+    int write(int address, const char * data, int length, bool repeated = false) {
+        (void)address; (void)data; (void)length; (void)repeated;
+        return -1;
+    }
+};
+
+
+/// An SPI port with nothing on it; the host build uses the simulated bus.
+///
+class SPI
+{
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk) { (void)mosi; (void)miso; (void)sclk; }
+    void format(int bits, int mode = 0) { (void)bits; (void)mode; }
+    void frequency(int hz = 1000000) { (void)hz; }
+    int write(int value) { (void)value; return 0; }
+    int write(const char * tx, int txLength, char * rx, int rxLength) {
+        (void)tx;
+        if (rx)
+            memset(rx, 0, rxLength);
+        return (txLength > rxLength) ? txLength : rxLength;
+    }
+};
+
+
+/// A character stream, as the mbed Stream, without the FILE it claims.
+///
+class Stream
+{
+public:
+    Stream(const char * name = NULL) { (void)name; }
+    virtual ~Stream() { }
+    int putc(int c) { return _putc(c); }
+    int puts(const char * s) { while (*s) _putc(*s++); return 0; }
+    int getc(void) { return _getc(); }
+    int printf(const char * format, ...);
+    int vprintf(const char * format, va_list args);
+
+protected:
+    virtual int _putc(int c) = 0;
+    virtual int _getc() = 0;
+};
+
+
+/// The serial port to the PC, which is stdin and stdout.
+///
+class Serial : public Stream
+{
+public:
+    Serial(PinName tx, PinName rx, const char * name = NULL) : Stream(name) { (void)tx; (void)rx; }
+    void baud(int rate) { (void)rate; }
+    int readable(void) { return 0; }
+    int writeable(void) { return 1; }
+
+protected:
+    virtual int _putc(int c) { return std::fputc(c, stdout); }
+    virtual int _getc() { return std::fgetc(stdin); }
+};
+
+
+/// The mbed local file system, which is the working directory on the host;
+/// its files are named relative to it, as "local/name".
+///
+class LocalFileSystem
+{
+public:
+    LocalFileSystem(const char * name) { (void)name; }
+};
+
+#endif // MBED_H
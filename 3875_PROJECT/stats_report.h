@@ -4,7 +4,7 @@
  */
 
 #ifndef STATS_REPORT_H
-#define STATS_REPORT
+#define STATS_REPORT_H
 
 #include "mbed.h"
 
@@ -56,7 +56,7 @@ public:
 
     ~SystemReport(void)
     {
-        free(thread_stats);
+        delete [] thread_stats;
     }
 
     /**
@@ -129,4 +129,237 @@ public:
     }
 };
 
+/**
+ *  System Sampler. Collects the CPU, heap and stack information of
+ *  SystemReport at a fixed rate, from a low priority thread, into a ring
+ *  buffer, and prints nothing while doing so. The samples may be dumped,
+ *  or drawn as sparklines on a display, on request.
+ *
+ *  @code
+ *      SystemSampler sampler(500);     // every 500 ms
+ *
+ *      sampler.start();
+ *      ...
+ *      sampler.draw_hud(lcd, 0, 0, 120, 40);
+ *      ...
+ *      sampler.dump();
+ *  @endcode
+ */
+class SystemSampler {
+public:
+    /** The most threads whose stacks are sampled */
+    static const int MAX_THREADS = 8;
+
+    /** One sample */
+    typedef struct {
+        uint32_t time_ms;                   ///< uptime when it was taken
+        uint8_t  idle_percent;              ///< CPU idle time since the last sample
+        uint8_t  stack_percent;             ///< the fullest stack, as a percentage of its size
+        uint8_t  thread_count;              ///< threads sampled
+        uint32_t heap_current;              ///< allocated heap
+        uint32_t heap_max;                  ///< the most heap allocated since reset
+        uint16_t stack_used[MAX_THREADS];   ///< stack high-water mark of each thread, in bytes
+    } Sample_T;
+
+    /**
+     *  SystemSampler - Sample rate in ms, and the number of samples to keep
+     */
+    SystemSampler(uint32_t sample_rate, int count = 120)
+        : thread(osPriorityLow, 1024), sample_time_ms(sample_rate),
+          sample_count(count), head(0), running(false), prev_idle_time(0), prev_uptime(0)
+    {
+        samples = new Sample_T[sample_count];
+    }
+
+    ~SystemSampler(void)
+    {
+        stop();
+        delete [] samples;
+    }
+
+    /**
+     *  Start sampling
+     */
+    void start(void)
+    {
+        if (running)
+            return;
+        running = true;
+        thread.start(callback(this, &SystemSampler::run));
+        ticker.attach_us(callback(this, &SystemSampler::tick), sample_time_ms * 1000);
+    }
+
+    /**
+     *  Stop sampling. Once stopped, it cannot be started again, since the
+     *  thread has ended.
+     */
+    void stop(void)
+    {
+        if (!running)
+            return;
+        ticker.detach();
+        running = false;
+        flags.set(SAMPLE_FLAG);
+        thread.join();
+    }
+
+    /**
+     *  Copy out the samples, oldest first, and return how many were copied
+     */
+    int get_samples(Sample_T * out, int max)
+    {
+        lock.lock();
+        uint32_t first = (head > (uint32_t)sample_count) ? head - sample_count : 0;
+        if (head - first > (uint32_t)max)
+            first = head - max;
+        int n = 0;
+        for (uint32_t i = first; i < head; i++)
+            out[n++] = samples[i % sample_count];
+        lock.unlock();
+        return n;
+    }
+
+    /**
+     *  Print the samples, oldest first, as CSV
+     */
+    void dump(void)
+    {
+        Sample_T s;
+
+        printf("time_ms,idle_percent,heap_current,heap_max,stack_percent");
+        for (int t = 0; t < MAX_THREADS; t++)
+            printf(",stack_used_%d", t);
+        printf("\r\n");
+        for (uint32_t i = 0; get_sample(i, &s); i++) {
+            printf("%lu,%d,%lu,%lu,%d", s.time_ms, s.idle_percent, s.heap_current, s.heap_max,
+                s.stack_percent);
+            for (int t = 0; t < MAX_THREADS; t++)
+                printf(",%d", (t < s.thread_count) ? s.stack_used[t] : 0);
+            printf("\r\n");
+        }
+    }
+
+    /**
+     *  Draw the recent samples as sparklines, with a hardware line for each
+     *  step - CPU usage in green, heap (of the most allocated) in yellow,
+     *  and the fullest stack in red - all scaled to the height of the box.
+     *
+     *  @param lcd is the display, which offers fillrect(x1,y1,x2,y2,color)
+     *      and line(x1,y1,x2,y2,color).
+     *  @param x, y are the top left of the box.
+     *  @param w, h are the size of the box.
+     *  @param points is the most samples to draw.
+     */
+    template <class Display>
+    void draw_hud(Display & lcd, int x, int y, int w, int h, int points = 16)
+    {
+        Sample_T recent[32];
+
+        if (points > 32)
+            points = 32;
+        if (points < 2)
+            points = 2;
+        int n = get_samples(recent, points);
+        lcd.fillrect(x, y, x + w - 1, y + h - 1, 0x0000);   // Black
+        for (int i = 1; i < n; i++) {
+            int x0 = x + (i - 1) * (w - 1) / (points - 1);
+            int x1 = x + i * (w - 1) / (points - 1);
+            lcd.line(x0, scale(y, h, 100 - recent[i-1].idle_percent, 100),
+                x1, scale(y, h, 100 - recent[i].idle_percent, 100), 0x07E0);    // Green
+            lcd.line(x0, scale(y, h, recent[i-1].heap_current, recent[n-1].heap_max),
+                x1, scale(y, h, recent[i].heap_current, recent[n-1].heap_max), 0xFFE0);   // Yellow
+            lcd.line(x0, scale(y, h, recent[i-1].stack_percent, 100),
+                x1, scale(y, h, recent[i].stack_percent, 100), 0xF800);     // Red
+        }
+    }
+
+private:
+    static const uint32_t SAMPLE_FLAG = 0x01;
+
+    void tick(void)
+    {
+        flags.set(SAMPLE_FLAG);
+    }
+
+    void run(void)
+    {
+        while (running) {
+            flags.wait_any(SAMPLE_FLAG);
+            if (running)
+                take_sample();
+        }
+    }
+
+    void take_sample(void)
+    {
+        Sample_T s;
+
+        mbed_stats_cpu_get(&cpu_stats);
+        mbed_stats_heap_get(&heap_stats);
+        int count = mbed_stats_thread_get_each(thread_stats, MAX_THREADS);
+
+        uint64_t elapsed = cpu_stats.uptime - prev_uptime;
+        uint64_t idle = cpu_stats.idle_time - prev_idle_time;
+        prev_uptime = cpu_stats.uptime;
+        prev_idle_time = cpu_stats.idle_time;
+        s.time_ms = cpu_stats.uptime / 1000;
+        s.idle_percent = (elapsed) ? (idle * 100) / elapsed : 0;
+        s.heap_current = heap_stats.current_size;
+        s.heap_max = heap_stats.max_size;
+        s.thread_count = count;
+        s.stack_percent = 0;
+        for (int i = 0; i < count; i++) {
+            uint32_t used = thread_stats[i].stack_size - thread_stats[i].stack_space;
+            s.stack_used[i] = used;
+            if (thread_stats[i].stack_size) {
+                uint8_t percent = used * 100 / thread_stats[i].stack_size;
+                if (percent > s.stack_percent)
+                    s.stack_percent = percent;
+            }
+        }
+        lock.lock();
+        samples[head % sample_count] = s;
+        head++;
+        lock.unlock();
+    }
+
+    bool get_sample(uint32_t index, Sample_T * s)
+    {
+        bool ok = false;
+
+        lock.lock();
+        uint32_t first = (head > (uint32_t)sample_count) ? head - sample_count : 0;
+        if (first + index < head) {
+            *s = samples[(first + index) % sample_count];
+            ok = true;
+        }
+        lock.unlock();
+        return ok;
+    }
+
+    static int scale(int y, int h, uint32_t value, uint32_t full)
+    {
+        if (full == 0 || value > full)
+            value = full;
+        return y + h - 1 - ((full) ? (uint64_t)value * (h - 1) / full : 0);
+    }
+
+    Thread   thread;
+    Ticker   ticker;
+    EventFlags flags;
+    Mutex    lock;
+
+    mbed_stats_heap_t   heap_stats;
+    mbed_stats_cpu_t    cpu_stats;
+    mbed_stats_thread_t thread_stats[MAX_THREADS];
+
+    Sample_T *samples;
+    uint32_t  sample_time_ms;
+    int       sample_count;
+    uint32_t  head;
+    volatile bool running;
+    uint64_t  prev_idle_time;
+    uint64_t  prev_uptime;
+};
+
 #endif // STATS_REPORT_H
@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Convert a SpanTrace dump into Chrome trace_event JSON.
+
+The dump is the text written by SpanTrace::Dump, as captured from the
+serial port. Other lines in the capture are ignored, so a whole terminal
+log may be given. The output may be loaded in chrome://tracing or
+https://ui.perfetto.dev, where nested spans show as a flame timeline.
+
+    span_to_chrome.py capture.txt > frame.json
+"""
+
+import json
+import sys
+
+
+def parse(lines):
+    """Return the (name, start_us, duration_us) of each span in the dump."""
+    spans = []
+    in_dump = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("# SpanTrace"):
+            spans = []              # only the last dump in a capture is used
+            in_dump = True
+            continue
+        if not in_dump or line == "name,start_us,duration_us":
+            continue
+        fields = line.rsplit(",", 2)
+        if len(fields) != 3 or not fields[1].isdigit() or not fields[2].isdigit():
+            in_dump = False         # the end of the dump
+            continue
+        spans.append((fields[0], int(fields[1]), int(fields[2])))
+    return spans
+
+
+def to_trace_events(spans):
+    """Return the trace_event document for the spans."""
+    if not spans:
+        return {"traceEvents": []}
+    origin = min(start for _, start, _ in spans)
+    events = []
+    for name, start, duration in spans:
+        events.append({"name": name, "ph": "X", "ts": start - origin, "dur": duration,
+                       "pid": 1, "tid": 1})
+    events.sort(key=lambda e: (e["ts"], -e["dur"]))  # parents ahead of children
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main(argv):
+    if len(argv) > 2:
+        sys.stderr.write(__doc__)
+        return 2
+    source = open(argv[1]) if len(argv) == 2 else sys.stdin
+    with source:
+        spans = parse(source)
+    json.dump(to_trace_events(spans), sys.stdout, indent=1)
+    sys.stdout.write("\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))